@@ -1,6 +1,18 @@
 ﻿#include "json.h"
+#include "../src/json/json_file.h"
+#include "../src/json/json_lines.h"
+#include "../src/json/json_ondemand.h"
+#include "../src/json/json_parallel.h"
 #include "../src/json/json_parser.h"
+#include "../src/json/json_path.h"
+#include "../src/json/json_projection.h"
+#include "../src/json/json_push.h"
+#include "../src/json/json_sax.h"
 #include "../src/json/json_serializer.h"
+#include "../src/json/json_tape.h"
+#include "../src/json/json_validate.h"
+#include "../src/json/json_writer.h"
+#include <limits.h>
 
 json_value_t* json_parse(const char* json_str)
 {
@@ -8,63 +20,352 @@ json_value_t* json_parse(const char* json_str)
 		return NULL;
 	}
 
-	json_parser_t parser = {
-		.json = json_str,
-		.pos = 0,
-		.len = strlen(json_str),
-		.error = NULL
-	};
+	json_document_t* doc = json_document_create();
+	if (!doc) {
+		return NULL;
+	}
+
+	json_value_t* result = json_document_parse(doc, json_str);
+	if (!result) {
+		json_document_free(doc);
+		return NULL;
+	}
+
+	return result;
+}
 
-	json_value_t* result = parse_value(&parser);
+json_value_t* json_parse_n(const char* json, size_t length)
+{
+	if (!json) {
+		return NULL;
+	}
 
-	if (parser.error) {
-		fprintf(stderr, "JSON parse error: %s\n", parser.error);
-		free(parser.error);
-		if (result)json_free(result);
+	json_document_t* doc = json_document_create();
+	if (!doc) {
 		return NULL;
 	}
 
-	skip_whitespace(&parser);
-	if (!is_eof(&parser)) {
-		fprintf(stderr, "JSON parse error: Extra data after JSON\n");
-		if (result)json_free(result);
+	json_value_t* result = json_document_parse_n(doc, json, length);
+	if (!result) {
+		json_document_free(doc);
 		return NULL;
 	}
 
 	return result;
 }
 
-json_value_t* json_parse_file(const char* filename)
+json_value_t* json_parse_insitu(char* buffer, size_t length)
 {
-	FILE* file = fopen(filename, "rb");
-	if (!file) return NULL;
+	if (!buffer) {
+		return NULL;
+	}
 
-	fseek(file, 0, SEEK_END);
-	long file_size = ftell(file);
-	fseek(file, 0, SEEK_SET);
+	json_document_t* doc = json_document_create();
+	if (!doc) {
+		return NULL;
+	}
 
-	if (file_size <= 0) {
-		fclose(file);
+	json_value_t* result = json_document_parse_insitu(doc, buffer, length);
+	if (!result) {
+		json_document_free(doc);
 		return NULL;
 	}
 
-	char* buffer = malloc(file_size + 1);
-	if (!buffer) {
-		fclose(file);
+	return result;
+}
+
+json_value_t* json_parse_parallel(const char* json, size_t length, size_t nthreads)
+{
+	if (!json) {
+		return NULL;
+	}
+
+	json_document_t* doc = json_document_create();
+	if (!doc) {
+		return NULL;
+	}
+
+	json_value_t* result = parse_parallel(doc, json, length, nthreads);
+	if (!result) {
+		json_document_free(doc);
+		return NULL;
+	}
+
+	doc->root = *result;
+	doc->has_root = 1;
+	return &doc->root;
+}
+
+int json_validate(const char* json, size_t length, json_error_t* error)
+{
+	if (!json) {
+		if (error) {
+			error->offset = 0;
+			error->message = "No input";
+		}
+		return 0;
+	}
+
+	return validate_json(json, length, error);
+}
+
+json_document_t* json_document_create(void)
+{
+	json_document_t* doc = pool_alloc(sizeof(json_document_t));
+	if (!doc) return NULL;
+
+	document_init(doc);
+	return doc;
+}
+
+static json_value_t* document_parse(json_document_t* doc, const char* json, size_t len, char* insitu)
+{
+	// The old root points into the arena about to be reset
+	value_init(&doc->root, JSON_NULL);
+	doc->has_root = 0;
+	arena_reset(&doc->arena);
+	doc->stack_size = 0;
+
+	// Parsed trees are usually a small multiple of the text size
+	arena_reserve(&doc->arena, insitu ? len : len * 2);
+
+	json_value_t* result = parse_root(doc, json, len, insitu);
+	if (!result) {
+		return NULL;
+	}
+
+	doc->root = *result;
+	doc->has_root = 1;
+	return &doc->root;
+}
+
+json_value_t* json_document_parse(json_document_t* doc, const char* json_str)
+{
+	if (!doc || !json_str) {
+		return NULL;
+	}
+
+	return document_parse(doc, json_str, strlen(json_str), NULL);
+}
+
+json_value_t* json_document_parse_n(json_document_t* doc, const char* json, size_t length)
+{
+	if (!doc || !json) {
+		return NULL;
+	}
+
+	return document_parse(doc, json, length, NULL);
+}
+
+json_value_t* json_document_parse_insitu(json_document_t* doc, char* buffer, size_t length)
+{
+	if (!doc || !buffer) {
+		return NULL;
+	}
+
+	return document_parse(doc, buffer, length, buffer);
+}
+
+json_value_t* json_document_root(const json_document_t* doc)
+{
+	if (!doc || !doc->has_root) return NULL;
+	return (json_value_t*)&doc->root;
+}
+
+void json_document_free(json_document_t* doc)
+{
+	if (!doc) return;
+
+	document_release(doc);
+	pool_free(doc, sizeof(json_document_t));
+}
+
+void json_document_set_key_pool(json_document_t* doc, json_key_pool_t* pool)
+{
+	if (doc) {
+		doc->key_pool = pool;
+	}
+}
+
+void json_document_set_max_depth(json_document_t* doc, size_t max_depth)
+{
+	if (doc) {
+		doc->max_depth = max_depth;
+	}
+}
+
+json_key_pool_t* json_key_pool_create(void)
+{
+	json_key_pool_t* pool = malloc(sizeof(json_key_pool_t));
+	if (!pool) {
+		return NULL;
+	}
+
+	key_pool_init(pool);
+	return pool;
+}
+
+const char* json_key_pool_intern(json_key_pool_t* pool, const char* key)
+{
+	if (!pool || !key) {
 		return NULL;
 	}
+	return key_pool_intern(pool, key, strlen(key));
+}
+
+void json_key_pool_free(json_key_pool_t* pool)
+{
+	if (!pool) {
+		return;
+	}
+
+	key_pool_release(pool);
+	free(pool);
+}
+
+json_value_t* json_parse_file(const char* filename)
+{
+	if (!filename) return NULL;
+
+	json_file_view_t view;
+	if (!file_view_open(&view, filename)) return NULL;
+
+	// Strings are copied into the document, so the view can go right away
+	json_value_t* result = json_parse_n(view.data, view.length);
+
+	file_view_close(&view);
+	return result;
+}
+
+static int sax_run(json_sax_parser_t* parser)
+{
+	int result = sax_parse(parser);
+
+	// A handler that stops the parse is not an error
+	if (!result && parser->error) {
+		fprintf(stderr, "JSON parse error: %s\n", parser->error);
+	}
+
+	sax_parser_free(parser);
+	return result;
+}
+
+int json_sax_parse(const char* json, size_t length, const json_sax_handler_t* handler, void* ctx)
+{
+	if (!json || !handler) {
+		return 0;
+	}
+
+	json_sax_parser_t parser;
+	sax_parser_init(&parser, handler, ctx);
+	parser.json = json;
+	parser.len = length;
+	return sax_run(&parser);
+}
+
+int json_sax_parse_file(const char* filename, const json_sax_handler_t* handler, void* ctx)
+{
+	if (!filename || !handler) {
+		return 0;
+	}
 
-	size_t read_size = fread(buffer, 1, file_size, file);
-	buffer[read_size] = '\0';
+	FILE* file = fopen(filename, "rb");
+	if (!file) return 0;
+
+	json_sax_parser_t parser;
+	sax_parser_init(&parser, handler, ctx);
+	parser.file = file;
+	int result = sax_run(&parser);
 
 	fclose(file);
+	return result;
+}
 
-	json_value_t* result = json_parse(buffer);
+json_push_parser_t* json_push_parser_create(const json_sax_handler_t* handler, void* ctx)
+{
+	json_push_parser_t* parser = malloc(sizeof(json_push_parser_t));
+	if (!parser) {
+		return NULL;
+	}
+
+	if (handler) {
+		push_parser_init(parser, handler, ctx);
+		return parser;
+	}
+
+	json_document_t* doc = json_document_create();
+	if (!doc) {
+		free(parser);
+		return NULL;
+	}
 
-	free(buffer);
+	push_parser_init(parser, &json_builder_handler, &parser->builder);
+	parser->doc = doc;
+	parser->max_depth = doc->max_depth;
+	builder_init(&parser->builder, doc);
+	return parser;
+}
+
+static int push_report(json_push_parser_t* parser, int result)
+{
+	if (!result && parser->error) {
+		fprintf(stderr, "JSON parse error: %s\n", parser->error);
+		free(parser->error);
+		parser->error = NULL;
+	}
 	return result;
 }
 
+int json_push_feed(json_push_parser_t* parser, const char* data, size_t length)
+{
+	if (!parser || (!data && length)) {
+		return 0;
+	}
+	return push_report(parser, push_parser_feed(parser, data, length));
+}
+
+int json_push_finish(json_push_parser_t* parser)
+{
+	if (!parser) {
+		return 0;
+	}
+	return push_report(parser, push_parser_finish(parser));
+}
+
+json_value_t* json_push_take_root(json_push_parser_t* parser)
+{
+	if (!parser || !parser->doc || parser->state != PUSH_DONE) {
+		return NULL;
+	}
+
+	json_value_t* root = builder_root(&parser->builder);
+	if (root) {
+		// json_free() on the root releases the whole document
+		parser->doc = NULL;
+	}
+	return root;
+}
+
+void json_push_parser_free(json_push_parser_t* parser)
+{
+	if (!parser) {
+		return;
+	}
+
+	json_document_free(parser->doc);
+	push_parser_free(parser);
+	free(parser);
+}
+
+int json_parse_lines_parallel(const char* path, size_t nthreads, json_line_callback_t callback,
+	void* ctx, json_lines_order_t order)
+{
+	if (!path || !callback) {
+		return 0;
+	}
+	return parse_lines_parallel(path, nthreads, callback, ctx, order);
+}
+
 char* json_serialize(const json_value_t* value)
 {
 	if (!value)return NULL;
@@ -97,198 +398,1227 @@ char* json_serialize_pretty(const json_value_t* value)
 
 int json_serialize_file(const json_value_t* value, const char* filename)
 {
-	char* json_str = json_serialize(value);
-	if (!json_str) return 0;
+	if (!value) return 0;
 
 	FILE* file = fopen(filename, "w");
 	if (!file) {
-		free(json_str);
 		return 0;
 	}
 
-	fputs(json_str, file);
-	fclose(file);
-	free(json_str);
-	return 1;
+	// Streamed through the staging buffer rather than built up as one string
+	json_sink_t sink = json_sink_file(file);
+	int result = json_serialize_to_sink(value, &sink);
+	if (fclose(file) != 0) {
+		result = 0;
+	}
+	return result;
 }
 
-void json_free(json_value_t* value)
+json_sink_t json_sink_buffer(char* buffer, size_t capacity)
 {
-	if (!value) return;
-
-	free_stack_node_t* stack = NULL;
+	json_sink_t sink = { 0 };
+	sink.buffer = buffer;
+	sink.capacity = buffer ? capacity : 0;
+	return sink;
+}
 
-	free_stack_node_t* node = malloc(sizeof(free_stack_node_t));
-	node->value = value;
-	node->next = stack;
-	stack = node;
+json_sink_t json_sink_file(FILE* file)
+{
+	return json_sink_callback(sink_write_file, file);
+}
 
-	while (stack != NULL) {
-		free_stack_node_t* current = stack;
-		stack = stack->next;
+json_sink_t json_sink_fd(int fd)
+{
+	return json_sink_callback(sink_write_fd, (void*)(intptr_t)fd);
+}
 
-		json_value_t* value = current->value;
-		free(current);
+json_sink_t json_sink_callback(json_write_callback_t write, void* ctx)
+{
+	json_sink_t sink = { 0 };
+	sink.write = write;
+	sink.ctx = ctx;
+	return sink;
+}
 
-		if (!value)continue;
+int json_serialize_to_sink(const json_value_t* value, json_sink_t* sink)
+{
+	if (!value || !sink) return 0;
 
-		switch (value->type)
-		{
-		case JSON_STRING:
-			free(value->data.string);
-			break;
-		case JSON_ARRAY:
-			for (size_t i = 0; i < value->data.array.count; ++i) {
-				if (value->data.array.values[i]) {
-					free_stack_node_t* new_node = malloc(sizeof(free_stack_node_t));
-					new_node->value = value->data.array.values[i];
-					new_node->next = stack;
-					stack = new_node;
-				}
-			}
-			free(value->data.array.values);
-			break;
-		case JSON_OBJECT:
-			for (size_t i = 0; i < value->data.object.count; i++) {
-				free(value->data.object.entries[i].key);
-
-				if (value->data.object.entries[i].value) {
-					free_stack_node_t* new_node = malloc(sizeof(free_stack_node_t));
-					new_node->value = value->data.object.entries[i].value;
-					new_node->next = stack;
-					stack = new_node;
-				}
-			}
-			free(value->data.object.entries);
-			break;
-		default:
-			break;
-		}
+	json_serializer_t serializer;
+	serializer_init_sink(&serializer, sink);
 
-		free(value);
-	}
+	return serialize_value(&serializer, value) && serializer_finish(&serializer);
 }
 
-json_type_t json_get_type(const json_value_t* value)
+size_t json_serialized_size(const json_value_t* value)
 {
-	if (!value)return JSON_NULL;
-	return value->type;
+	// Without a buffer or a callback the sink only counts
+	json_sink_t sink = { 0 };
+	if (!json_serialize_to_sink(value, &sink)) {
+		return 0;
+	}
+	return sink.length;
 }
 
-const char* json_type_to_string(json_type_t type)
+json_writer_t* json_writer_create(json_sink_t* sink)
 {
-	switch (type)
-	{
-	case JSON_NULL:
-		return "null";
-	case JSON_BOOL:
-		return "boolean";
-	case JSON_STRING:
-		return "string";
-	case JSON_NUMBER:
-		return "number";
-	case JSON_ARRAY:
-		return "array";
-	case JSON_OBJECT:
-		return "object";
-	default:
-		return "unknown";
+	if (!sink) {
+		return NULL;
 	}
-}
 
-int json_get_boolean(const json_value_t* value)
-{
-	if (!value || value->type != JSON_BOOL) {
-		return 0;
+	json_writer_t* writer = malloc(sizeof(json_writer_t));
+	if (writer) {
+		writer_init(writer, sink);
 	}
-	return value->data.boolean;
+	return writer;
 }
 
-double json_get_number(const json_value_t* value)
+int json_writer_begin_object(json_writer_t* writer)
 {
-	if (!value || value->type != JSON_NUMBER) {
-		return 0.0; 
-	}
-	return value->data.number;
+	return writer ? writer_begin_object(writer) : 0;
 }
 
-const char* json_get_string(const json_value_t* value)
+int json_writer_end_object(json_writer_t* writer)
 {
-	if (!value || value->type != JSON_STRING) {
-		return NULL; 
-	}
-	return value->data.string;
+	return writer ? writer_end_object(writer) : 0;
 }
 
-size_t json_get_array_size(const json_value_t* value)
+int json_writer_begin_array(json_writer_t* writer)
 {
-	if (!value || value->type != JSON_ARRAY) {
-		return 0; 
-	}
-	return value->data.array.count;
+	return writer ? writer_begin_array(writer) : 0;
 }
 
-json_value_t* json_array_get(const json_value_t* value, size_t index)
+int json_writer_end_array(json_writer_t* writer)
 {
-	if (!value || value->type != JSON_ARRAY) {
-		return NULL;
-	}
-	if (index >= value->data.array.count) {
-		return NULL;
-	}
-	return value->data.array.values[index];
+	return writer ? writer_end_array(writer) : 0;
 }
 
-size_t json_object_size(const json_value_t* value)
+int json_writer_key(json_writer_t* writer, const char* key)
 {
-	if (!value || value->type != JSON_OBJECT) {
+	if (!writer || !key) {
 		return 0;
 	}
-	return value->data.object.count;
+	return writer_key(writer, key);
 }
 
-const char* json_object_get_key(const json_value_t* value, size_t index)
+int json_writer_write_null(json_writer_t* writer)
 {
-	if (!value || value->type != JSON_OBJECT) {
-		return NULL;
-	}
-	if (index >= value->data.object.count) {
-		return NULL;
-	}
-	return value->data.object.entries[index].key;
+	return writer ? writer_null(writer) : 0;
 }
 
-json_value_t* json_object_get_value(const json_value_t* value, size_t index)
+int json_writer_write_bool(json_writer_t* writer, int value)
 {
-	if (!value || value->type != JSON_OBJECT) {
-		return NULL;
-	}
-	if (index >= value->data.object.count) {
-		return NULL;
-	}
-	return value->data.object.entries[index].value;
+	return writer ? writer_bool(writer, value) : 0;
 }
 
-json_value_t* json_object_get(const json_value_t* value, const char* key)
+int json_writer_write_int(json_writer_t* writer, int64_t value)
 {
-	if (!value || value->type != JSON_OBJECT || !key) {
-		return NULL;
+	if (!writer) {
+		return 0;
 	}
 
-	for (size_t i = 0; i < value->data.object.count; i++) {
-		if (strcmp(value->data.object.entries[i].key, key) == 0) {
-			return value->data.object.entries[i].value;
-		}
-	}
-	return NULL;
+	json_number_t number;
+	number.integer = value;
+	number.repr = JSON_INTEGER;
+	return writer_number(writer, &number);
 }
 
-
-json_value_t* json_get_value(const json_value_t* value, size_t index){
-	if(!value || value->type != JSON_OBJECT || index < 0){
-		return NULL;
+int json_writer_write_uint(json_writer_t* writer, uint64_t value)
+{
+	if (!writer) {
+		return 0;
 	}
-	if(index >= value->data.object.count) return NULL;
 
-	return value->data.object.entries[index].value;
+	json_number_t number;
+	number.uinteger = value;
+	number.repr = JSON_UNSIGNED;
+	return writer_number(writer, &number);
+}
+
+int json_writer_write_double(json_writer_t* writer, double value)
+{
+	if (!writer) {
+		return 0;
+	}
+
+	json_number_t number;
+	number.real = value;
+	number.repr = JSON_REAL;
+	return writer_number(writer, &number);
+}
+
+int json_writer_write_string(json_writer_t* writer, const char* value)
+{
+	if (!writer) {
+		return 0;
+	}
+	return value ? writer_string(writer, value) : writer_null(writer);
+}
+
+int json_writer_finish(json_writer_t* writer)
+{
+	return writer ? writer_finish(writer) : 0;
+}
+
+void json_writer_free(json_writer_t* writer)
+{
+	free(writer);
+}
+
+void json_free(json_value_t* value)
+{
+	if (!value) return;
+
+	// Roots handed out by the parser live at the start of their document
+	json_document_free((json_document_t*)value);
+}
+
+json_type_t json_get_type(const json_value_t* value)
+{
+	if (!value)return JSON_NULL;
+	return value_type(value);
+}
+
+const char* json_type_to_string(json_type_t type)
+{
+	switch (type)
+	{
+	case JSON_NULL:
+		return "null";
+	case JSON_BOOL:
+		return "boolean";
+	case JSON_STRING:
+		return "string";
+	case JSON_NUMBER:
+		return "number";
+	case JSON_ARRAY:
+		return "array";
+	case JSON_OBJECT:
+		return "object";
+	default:
+		return "unknown";
+	}
+}
+
+int json_get_boolean(const json_value_t* value)
+{
+	if (!value || value_type(value) != JSON_BOOL) {
+		return 0;
+	}
+	return value->data.boolean;
+}
+
+static double number_to_double(const json_number_t* number)
+{
+	switch (number->repr) {
+	case JSON_INTEGER:
+		return (double)number->integer;
+	case JSON_UNSIGNED:
+		return (double)number->uinteger;
+	default:
+		return number->real;
+	}
+}
+
+double json_get_number(const json_value_t* value)
+{
+	if (!value || value_type(value) != JSON_NUMBER) {
+		return 0.0; 
+	}
+	json_number_t number = value_number(value);
+	return number_to_double(&number);
+}
+
+json_number_repr_t json_get_number_repr(const json_value_t* value)
+{
+	if (!value || value_type(value) != JSON_NUMBER) {
+		return JSON_REAL;
+	}
+	return value_number(value).repr;
+}
+
+static int number_to_int64(const json_number_t* number, int64_t* out)
+{
+	switch (number->repr) {
+	case JSON_INTEGER:
+		*out = number->integer;
+		return 1;
+	case JSON_UNSIGNED:
+		if (number->uinteger > (uint64_t)INT64_MAX) {
+			return 0;
+		}
+		*out = (int64_t)number->uinteger;
+		return 1;
+	default:
+		// 2^63 is exact as a double, so the bounds check does not round
+		if (number->real >= -9223372036854775808.0 && number->real < 9223372036854775808.0) {
+			*out = (int64_t)number->real;
+			return 1;
+		}
+		return 0;
+	}
+}
+
+int64_t json_get_int64(const json_value_t* value)
+{
+	int64_t result;
+	if (!value || value_type(value) != JSON_NUMBER) {
+		return 0;
+	}
+	json_number_t number = value_number(value);
+	if (!number_to_int64(&number, &result)) {
+		return 0;
+	}
+	return result;
+}
+
+uint64_t json_get_uint64(const json_value_t* value)
+{
+	if (!value || value_type(value) != JSON_NUMBER) {
+		return 0;
+	}
+
+	json_number_t number = value_number(value);
+	switch (number.repr) {
+	case JSON_INTEGER:
+		return number.integer >= 0 ? (uint64_t)number.integer : 0;
+	case JSON_UNSIGNED:
+		return number.uinteger;
+	default: {
+		double real = number.real;
+		if (real >= 0.0 && real < 18446744073709551616.0) {
+			return (uint64_t)real;
+		}
+		return 0;
+	}
+	}
+}
+
+const char* json_get_string(const json_value_t* value)
+{
+	if (!value || value_type(value) != JSON_STRING) {
+		return NULL; 
+	}
+	return value_string(value);
+}
+
+size_t json_get_array_size(const json_value_t* value)
+{
+	if (!value || value_type(value) != JSON_ARRAY) {
+		return 0; 
+	}
+	return value->data.array->count;
+}
+
+json_value_t* json_array_get(const json_value_t* value, size_t index)
+{
+	if (!value || value_type(value) != JSON_ARRAY) {
+		return NULL;
+	}
+	if (index >= value->data.array->count) {
+		return NULL;
+	}
+	return value->data.array->values[index];
+}
+
+size_t json_object_size(const json_value_t* value)
+{
+	if (!value || value_type(value) != JSON_OBJECT) {
+		return 0;
+	}
+	return value->data.object->count;
+}
+
+const char* json_object_get_key(const json_value_t* value, size_t index)
+{
+	if (!value || value_type(value) != JSON_OBJECT) {
+		return NULL;
+	}
+	if (index >= value->data.object->count) {
+		return NULL;
+	}
+	return value->data.object->entries[index].key;
+}
+
+json_value_t* json_object_get_value(const json_value_t* value, size_t index)
+{
+	if (!value || value_type(value) != JSON_OBJECT) {
+		return NULL;
+	}
+	if (index >= value->data.object->count) {
+		return NULL;
+	}
+	return value->data.object->entries[index].value;
+}
+
+json_value_t* json_object_get(const json_value_t* value, const char* key)
+{
+	if (!value || value_type(value) != JSON_OBJECT || !key) {
+		return NULL;
+	}
+
+	if (value->data.object->index) {
+		return object_index_find(value->data.object->index, value->data.object->entries, key,
+			json_hash_key(key, strlen(key)));
+	}
+
+	for (size_t i = 0; i < value->data.object->count; i++) {
+		if (strcmp(value->data.object->entries[i].key, key) == 0) {
+			return value->data.object->entries[i].value;
+		}
+	}
+	return NULL;
+}
+
+json_value_t* json_object_get_interned(const json_value_t* value, const char* key)
+{
+	if (!value || value_type(value) != JSON_OBJECT || !key) {
+		return NULL;
+	}
+
+	if (value->data.object->index) {
+		return object_index_find_interned(value->data.object->index, value->data.object->entries, key,
+			key_header(key)->hash);
+	}
+
+	for (size_t i = 0; i < value->data.object->count; i++) {
+		if (value->data.object->entries[i].key == key) {
+			return value->data.object->entries[i].value;
+		}
+	}
+	return NULL;
+}
+
+int json_object_build_index(json_document_t* doc, json_value_t* value)
+{
+	if (!doc || !value || value_type(value) != JSON_OBJECT) {
+		return 0;
+	}
+
+	if (!value->data.object->index) {
+		value->data.object->index = object_index_build(&doc->arena, value->data.object->entries, value->data.object->count, 0);
+	}
+	return value->data.object->index != NULL;
+}
+
+
+json_value_t* json_get_value(const json_value_t* value, size_t index){
+	if(!value || value_type(value) != JSON_OBJECT || index < 0){
+		return NULL;
+	}
+	if(index >= value->data.object->count) return NULL;
+
+	return value->data.object->entries[index].value;
+}
+
+static void od_parser_init(json_od_parser_t* parser)
+{
+	parser->json = NULL;
+	parser->len = 0;
+	parser->index.positions = NULL;
+	parser->index.count = 0;
+	parser->index.capacity = 0;
+	parser->index.has_backslash = 0;
+	arena_init(&parser->strings);
+}
+
+static void od_parser_release(json_od_parser_t* parser)
+{
+	structural_index_free(&parser->index);
+	arena_free(&parser->strings);
+}
+
+json_od_parser_t* json_od_parser_create(void)
+{
+	json_od_parser_t* parser = malloc(sizeof(json_od_parser_t));
+	if (!parser) {
+		return NULL;
+	}
+
+	od_parser_init(parser);
+	return parser;
+}
+
+int json_od_iterate(json_od_parser_t* parser, const char* json, size_t length, json_od_value_t* root)
+{
+	if (!parser || !json || !root) {
+		return 0;
+	}
+
+	if (!od_index_input(parser, json, length) || parser->index.count == 0) {
+		parser->index.count = 0;
+		return 0;
+	}
+
+	root->parser = parser;
+	root->token = 0;
+	return 1;
+}
+
+void json_od_parser_free(json_od_parser_t* parser)
+{
+	if (!parser) {
+		return;
+	}
+
+	od_parser_release(parser);
+	free(parser);
+}
+
+json_type_t json_od_get_type(const json_od_value_t* value)
+{
+	if (!value || !value->parser) {
+		return JSON_NULL;
+	}
+
+	switch (od_token_char(value->parser, value->token)) {
+	case '{':
+		return JSON_OBJECT;
+	case '[':
+		return JSON_ARRAY;
+	case '"':
+		return JSON_STRING;
+	case 't':
+	case 'f':
+		return JSON_BOOL;
+	case '-':
+	case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+		return JSON_NUMBER;
+	default:
+		return JSON_NULL;
+	}
+}
+
+int json_od_find_field(const json_od_value_t* object, const char* key, json_od_value_t* out)
+{
+	if (!object || !key || !out) {
+		return 0;
+	}
+
+	json_od_iterator_t it;
+	if (!json_od_object_begin(object, &it)) {
+		return 0;
+	}
+
+	json_od_parser_t* parser = object->parser;
+	size_t key_length = strlen(key);
+
+	while (it.token != JSON_OD_INVALID) {
+		size_t key_token = it.token;
+		json_od_value_t value;
+		if (!json_od_object_next(&it, NULL, NULL, &value)) {
+			return 0;
+		}
+		if (od_match_key(parser, key_token, key, key_length)) {
+			*out = value;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int json_od_get_double(const json_od_value_t* value, double* out)
+{
+	json_number_t number;
+	if (!value || !out || !od_read_number(value->parser, value->token, &number)) {
+		return 0;
+	}
+
+	*out = number_to_double(&number);
+	return 1;
+}
+
+int json_od_get_int64(const json_od_value_t* value, int64_t* out)
+{
+	json_number_t number;
+	if (!value || !out || !od_read_number(value->parser, value->token, &number)) {
+		return 0;
+	}
+	return number_to_int64(&number, out);
+}
+
+int json_od_get_bool(const json_od_value_t* value, int* out)
+{
+	if (!value || !out) {
+		return 0;
+	}
+
+	if (od_read_literal(value->parser, value->token, "true", 4)) {
+		*out = 1;
+		return 1;
+	}
+	if (od_read_literal(value->parser, value->token, "false", 5)) {
+		*out = 0;
+		return 1;
+	}
+	return 0;
+}
+
+int json_od_get_string(const json_od_value_t* value, const char** out, size_t* length)
+{
+	if (!value || !out) {
+		return 0;
+	}
+
+	const char* string = od_read_string(value->parser, value->token, length);
+	if (!string) {
+		return 0;
+	}
+
+	*out = string;
+	return 1;
+}
+
+int json_od_is_null(const json_od_value_t* value)
+{
+	return value && od_read_literal(value->parser, value->token, "null", 4);
+}
+
+static int od_iterator_begin(const json_od_value_t* value, json_od_iterator_t* it, char open, char close)
+{
+	if (!value || !it || od_token_char(value->parser, value->token) != open) {
+		return 0;
+	}
+
+	it->parser = value->parser;
+	it->close = close;
+	it->token = value->token + 1;
+	if (od_token_char(it->parser, it->token) == close) {
+		it->token = JSON_OD_INVALID;
+	}
+	return 1;
+}
+
+// Moves the iterator past the element that starts at token
+static int od_iterator_advance(json_od_iterator_t* it, size_t token)
+{
+	size_t end = od_skip_value(it->parser, token);
+	char c = end == JSON_OD_INVALID ? '\0' : od_token_char(it->parser, end);
+
+	if (c == ',') {
+		it->token = end + 1;
+		return 1;
+	}
+
+	it->token = JSON_OD_INVALID;
+	return c == it->close;
+}
+
+int json_od_array_begin(const json_od_value_t* array, json_od_iterator_t* it)
+{
+	return od_iterator_begin(array, it, '[', ']');
+}
+
+int json_od_array_next(json_od_iterator_t* it, json_od_value_t* out)
+{
+	if (!it || !out || it->token == JSON_OD_INVALID) {
+		return 0;
+	}
+
+	size_t token = it->token;
+	if (!od_iterator_advance(it, token)) {
+		return 0;
+	}
+
+	out->parser = it->parser;
+	out->token = token;
+	return 1;
+}
+
+int json_od_object_begin(const json_od_value_t* object, json_od_iterator_t* it)
+{
+	return od_iterator_begin(object, it, '{', '}');
+}
+
+int json_od_object_next(json_od_iterator_t* it, const char** key, size_t* key_length, json_od_value_t* value)
+{
+	if (!it || !value || it->token == JSON_OD_INVALID) {
+		return 0;
+	}
+
+	// A field is the key quote pair, the colon and the value
+	size_t token = it->token;
+	if (od_token_char(it->parser, token) != '"' || od_token_char(it->parser, token + 2) != ':') {
+		it->token = JSON_OD_INVALID;
+		return 0;
+	}
+
+	if (key) {
+		*key = od_read_string(it->parser, token, key_length);
+		if (!*key) {
+			it->token = JSON_OD_INVALID;
+			return 0;
+		}
+	}
+
+	if (!od_iterator_advance(it, token + 3)) {
+		return 0;
+	}
+
+	value->parser = it->parser;
+	value->token = token + 3;
+	return 1;
+}
+
+json_tape_t* json_tape_parse(const char* json, size_t length)
+{
+	if (!json) {
+		return NULL;
+	}
+
+	json_tape_t* tape = malloc(sizeof(json_tape_t));
+	if (!tape) {
+		return NULL;
+	}
+	tape_init(tape);
+
+	json_tape_builder_t builder;
+	int result = tape_builder_init(&builder, tape, length);
+	if (result) {
+		json_sax_parser_t parser;
+		sax_parser_init(&parser, &json_tape_handler, &builder);
+		parser.json = json;
+		parser.len = length;
+		result = sax_run(&parser);
+	}
+
+	if (!tape_builder_finish(&builder) || !result) {
+		json_tape_free(tape);
+		return NULL;
+	}
+	return tape;
+}
+
+void json_tape_free(json_tape_t* tape)
+{
+	if (!tape) return;
+
+	tape_release(tape);
+	free(tape);
+}
+
+static json_tape_value_t tape_value(const json_tape_t* tape, size_t index)
+{
+	json_tape_value_t value = { tape, index };
+	return value;
+}
+
+static const json_tape_value_t tape_missing = { NULL, 0 };
+
+json_tape_value_t json_tape_root(const json_tape_t* tape)
+{
+	if (!tape) return tape_missing;
+	return tape_value(tape, 0);
+}
+
+int json_tape_is_valid(json_tape_value_t value)
+{
+	return value.tape != NULL;
+}
+
+static char tape_value_tag(json_tape_value_t value)
+{
+	return value.tape ? tape_tag(value.tape, value.index) : '\0';
+}
+
+json_type_t json_tape_get_type(json_tape_value_t value)
+{
+	switch (tape_value_tag(value)) {
+	case 't':
+	case 'f':
+		return JSON_BOOL;
+	case 'l':
+	case 'u':
+	case 'd':
+		return JSON_NUMBER;
+	case '"':
+		return JSON_STRING;
+	case '[':
+		return JSON_ARRAY;
+	case '{':
+		return JSON_OBJECT;
+	default:
+		return JSON_NULL;
+	}
+}
+
+int json_tape_get_boolean(json_tape_value_t value)
+{
+	return tape_value_tag(value) == 't';
+}
+
+static int tape_number(json_tape_value_t value, json_number_t* number)
+{
+	uint64_t raw;
+	switch (tape_value_tag(value)) {
+	case 'l':
+		number->repr = JSON_INTEGER;
+		number->integer = (int64_t)value.tape->words[value.index + 1];
+		return 1;
+	case 'u':
+		number->repr = JSON_UNSIGNED;
+		number->uinteger = value.tape->words[value.index + 1];
+		return 1;
+	case 'd':
+		raw = value.tape->words[value.index + 1];
+		number->repr = JSON_REAL;
+		memcpy(&number->real, &raw, sizeof(raw));
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+double json_tape_get_number(json_tape_value_t value)
+{
+	json_number_t number;
+	if (!tape_number(value, &number)) {
+		return 0.0;
+	}
+	return number_to_double(&number);
+}
+
+int64_t json_tape_get_int64(json_tape_value_t value)
+{
+	json_number_t number;
+	int64_t result;
+	if (!tape_number(value, &number) || !number_to_int64(&number, &result)) {
+		return 0;
+	}
+	return result;
+}
+
+const char* json_tape_get_string(json_tape_value_t value, size_t* length)
+{
+	if (tape_value_tag(value) != '"') {
+		return NULL;
+	}
+	return tape_string(value.tape, value.index, length);
+}
+
+// Number of elements, stored in the end word of the container
+static size_t tape_container_size(json_tape_value_t value, char tag)
+{
+	if (tape_value_tag(value) != tag) {
+		return 0;
+	}
+	return (size_t)tape_payload(value.tape, tape_skip(value.tape, value.index) - 1);
+}
+
+size_t json_tape_get_array_size(json_tape_value_t value)
+{
+	return tape_container_size(value, '[');
+}
+
+size_t json_tape_object_size(json_tape_value_t value)
+{
+	return tape_container_size(value, '{');
+}
+
+json_tape_value_t json_tape_first(json_tape_value_t container)
+{
+	char tag = tape_value_tag(container);
+	if (tag != '[' && tag != '{') {
+		return tape_missing;
+	}
+
+	size_t first = container.index + 1;
+	char first_tag = tape_tag(container.tape, first);
+	if (first_tag == ']' || first_tag == '}') {
+		return tape_missing;
+	}
+
+	// Object members start with their key word
+	return tape_value(container.tape, first_tag == 'k' ? first + 1 : first);
+}
+
+json_tape_value_t json_tape_next(json_tape_value_t value)
+{
+	if (!value.tape) {
+		return tape_missing;
+	}
+
+	size_t next = tape_skip(value.tape, value.index);
+	if (next >= value.tape->count) {
+		return tape_missing;
+	}
+
+	char tag = tape_tag(value.tape, next);
+	if (tag == ']' || tag == '}') {
+		return tape_missing;
+	}
+	return tape_value(value.tape, tag == 'k' ? next + 1 : next);
+}
+
+const char* json_tape_key(json_tape_value_t member)
+{
+	if (!member.tape || member.index == 0 || tape_tag(member.tape, member.index - 1) != 'k') {
+		return NULL;
+	}
+	return tape_string(member.tape, member.index - 1, NULL);
+}
+
+json_tape_value_t json_tape_array_get(json_tape_value_t value, size_t index)
+{
+	if (tape_value_tag(value) != '[') {
+		return tape_missing;
+	}
+
+	json_tape_value_t element = json_tape_first(value);
+	while (index-- > 0 && element.tape) {
+		element = json_tape_next(element);
+	}
+	return element;
+}
+
+json_tape_value_t json_tape_get_value(json_tape_value_t value, size_t index)
+{
+	if (tape_value_tag(value) != '{') {
+		return tape_missing;
+	}
+
+	json_tape_value_t member = json_tape_first(value);
+	while (index-- > 0 && member.tape) {
+		member = json_tape_next(member);
+	}
+	return member;
+}
+
+const char* json_tape_object_get_key(json_tape_value_t value, size_t index)
+{
+	return json_tape_key(json_tape_get_value(value, index));
+}
+
+json_tape_value_t json_tape_object_get(json_tape_value_t value, const char* key)
+{
+	if (tape_value_tag(value) != '{' || !key) {
+		return tape_missing;
+	}
+
+	size_t key_length = strlen(key);
+	for (json_tape_value_t member = json_tape_first(value); member.tape; member = json_tape_next(member)) {
+		size_t length;
+		const char* name = tape_string(member.tape, member.index - 1, &length);
+		if (length == key_length && memcmp(name, key, length) == 0) {
+			return member;
+		}
+	}
+	return tape_missing;
+}
+
+json_path_t* json_path_compile(const char* expression)
+{
+	if (!expression) {
+		return NULL;
+	}
+	return path_compile(expression);
+}
+
+void json_path_free(json_path_t* path)
+{
+	path_free(path);
+}
+
+// Returns 0 once the callback asks to stop
+static int path_select_value(const json_path_t* path, size_t step, json_value_t* value,
+	json_path_callback_t callback, void* ctx, size_t* matches)
+{
+	if (step == path->count) {
+		(*matches)++;
+		return callback(ctx, value);
+	}
+
+	const json_path_step_t* current = &path->steps[step];
+	json_value_t* child;
+
+	switch (current->type) {
+	case PATH_WILDCARD:
+		if (value_type(value) == JSON_ARRAY) {
+			for (size_t i = 0; i < value->data.array->count; i++) {
+				if (!path_select_value(path, step + 1, value->data.array->values[i], callback, ctx, matches)) {
+					return 0;
+				}
+			}
+		}
+		else if (value_type(value) == JSON_OBJECT) {
+			for (size_t i = 0; i < value->data.object->count; i++) {
+				if (!path_select_value(path, step + 1, value->data.object->entries[i].value, callback, ctx, matches)) {
+					return 0;
+				}
+			}
+		}
+		return 1;
+	case PATH_INDEX:
+		child = json_array_get(value, current->index);
+		break;
+	case PATH_TOKEN:
+		if (value_type(value) == JSON_ARRAY) {
+			child = json_array_get(value, current->index);
+			break;
+		}
+		// fall through
+	default:
+		child = json_object_get(value, current->key);
+		break;
+	}
+
+	return !child || path_select_value(path, step + 1, child, callback, ctx, matches);
+}
+
+size_t json_path_select(const json_path_t* path, const json_value_t* root, json_path_callback_t callback, void* ctx)
+{
+	if (!path || !root || !callback) {
+		return 0;
+	}
+
+	size_t matches = 0;
+	path_select_value(path, 0, (json_value_t*)root, callback, ctx, &matches);
+	return matches;
+}
+
+static int path_take_first(void* ctx, json_value_t* match)
+{
+	*(json_value_t**)ctx = match;
+	return 0;
+}
+
+json_value_t* json_path_get(const json_path_t* path, const json_value_t* root)
+{
+	json_value_t* match = NULL;
+	json_path_select(path, root, path_take_first, &match);
+	return match;
+}
+
+// Cursor version of path_select_value; unselected subtrees are skipped by
+// bracket matching on the structural index instead of being parsed
+static int path_select_od(const json_path_t* path, size_t step, const json_od_value_t* value,
+	json_path_od_callback_t callback, void* ctx, size_t* matches)
+{
+	if (step == path->count) {
+		(*matches)++;
+		return callback(ctx, value);
+	}
+
+	const json_path_step_t* current = &path->steps[step];
+	json_type_t type = json_od_get_type(value);
+	json_od_iterator_t it;
+	json_od_value_t child;
+
+	if (current->type == PATH_WILDCARD) {
+		if (type == JSON_ARRAY && json_od_array_begin(value, &it)) {
+			while (json_od_array_next(&it, &child)) {
+				if (!path_select_od(path, step + 1, &child, callback, ctx, matches)) {
+					return 0;
+				}
+			}
+		}
+		else if (type == JSON_OBJECT && json_od_object_begin(value, &it)) {
+			while (json_od_object_next(&it, NULL, NULL, &child)) {
+				if (!path_select_od(path, step + 1, &child, callback, ctx, matches)) {
+					return 0;
+				}
+			}
+		}
+		return 1;
+	}
+
+	if (current->type == PATH_KEY || (current->type == PATH_TOKEN && type == JSON_OBJECT)) {
+		if (!json_od_find_field(value, current->key, &child)) {
+			return 1;
+		}
+	}
+	else {
+		if (current->index == JSON_PATH_NO_INDEX || !json_od_array_begin(value, &it)) {
+			return 1;
+		}
+		for (size_t i = 0; i <= current->index; i++) {
+			if (!json_od_array_next(&it, &child)) {
+				return 1;
+			}
+		}
+	}
+
+	return path_select_od(path, step + 1, &child, callback, ctx, matches);
+}
+
+size_t json_path_select_od(const json_path_t* path, const json_od_value_t* root, json_path_od_callback_t callback,
+	void* ctx)
+{
+	if (!path || !root || !callback) {
+		return 0;
+	}
+
+	size_t matches = 0;
+	path_select_od(path, 0, root, callback, ctx, &matches);
+	return matches;
+}
+
+static int path_take_first_od(void* ctx, const json_od_value_t* match)
+{
+	*(json_od_value_t*)ctx = *match;
+	return 0;
+}
+
+int json_path_get_od(const json_path_t* path, const json_od_value_t* root, json_od_value_t* out)
+{
+	if (!out) {
+		return 0;
+	}
+	return json_path_select_od(path, root, path_take_first_od, out) > 0;
+}
+
+json_projection_t* json_projection_compile(const char* const* paths, size_t count)
+{
+	if (!paths && count > 0) {
+		return NULL;
+	}
+	return projection_compile(paths, count);
+}
+
+void json_projection_free(json_projection_t* projection)
+{
+	projection_free(projection);
+}
+
+json_value_t* json_parse_projected(const char* json, size_t length, const json_projection_t* projection)
+{
+	if (!json || !projection) {
+		return NULL;
+	}
+
+	json_document_t* doc = json_document_create();
+	if (!doc) {
+		return NULL;
+	}
+
+	// No arena reservation: the reduced tree is usually a small part of the text
+	json_value_t* result = parse_root_projected(doc, json, length, projection);
+	if (!result) {
+		json_document_free(doc);
+		return NULL;
+	}
+
+	doc->root = *result;
+	doc->has_root = 1;
+	return &doc->root;
+}
+
+static const json_bind_field_t* bind_find_field(json_od_parser_t* parser, size_t key_token,
+	const json_bind_desc_t* desc)
+{
+	for (size_t i = 0; i < desc->count; i++) {
+		const json_bind_field_t* field = &desc->fields[i];
+		if (od_match_key(parser, key_token, field->name, strlen(field->name))) {
+			return field;
+		}
+	}
+	return NULL;
+}
+
+static int bind_object(const json_od_value_t* object, const json_bind_desc_t* desc, char* base);
+
+// Null leaves the member as it was; any other type mismatch fails
+// Integer fields only take integral numbers, where json_od_get_int64()
+// would truncate a real
+static int bind_integer(const json_od_value_t* value, int64_t* out)
+{
+	json_number_t number;
+	if (!od_read_number(value->parser, value->token, &number) || !number_to_int64(&number, out)) {
+		return 0;
+	}
+	return number.repr != JSON_REAL || (double)*out == number.real;
+}
+
+static int bind_field(const json_od_value_t* value, const json_bind_field_t* field, char* base)
+{
+	char* target = base + field->offset;
+	int boolean;
+	int narrow;
+	int64_t integer;
+	double real;
+	const char* string;
+	size_t length;
+
+	if (json_od_is_null(value)) {
+		return 1;
+	}
+
+	switch (field->type) {
+	case JSON_BIND_BOOL:
+		if (!json_od_get_bool(value, &boolean)) return 0;
+		memcpy(target, &boolean, sizeof(boolean));
+		return 1;
+	case JSON_BIND_INT:
+		if (!bind_integer(value, &integer) || integer < INT_MIN || integer > INT_MAX) return 0;
+		narrow = (int)integer;
+		memcpy(target, &narrow, sizeof(narrow));
+		return 1;
+	case JSON_BIND_INT64:
+		if (!bind_integer(value, &integer)) return 0;
+		memcpy(target, &integer, sizeof(integer));
+		return 1;
+	case JSON_BIND_DOUBLE:
+		if (!json_od_get_double(value, &real)) return 0;
+		memcpy(target, &real, sizeof(real));
+		return 1;
+	case JSON_BIND_STRING:
+		if (!json_od_get_string(value, &string, &length) || length >= field->size) return 0;
+		memcpy(target, string, length);
+		target[length] = '\0';
+		return 1;
+	case JSON_BIND_OBJECT:
+		return field->nested && bind_object(value, field->nested, target);
+	default:
+		return 0;
+	}
+}
+
+static int bind_object(const json_od_value_t* object, const json_bind_desc_t* desc, char* base)
+{
+	json_od_iterator_t it;
+	if (!json_od_object_begin(object, &it)) {
+		return 0;
+	}
+
+	while (it.token != JSON_OD_INVALID) {
+		size_t key_token = it.token;
+		json_od_value_t value;
+		if (!json_od_object_next(&it, NULL, NULL, &value)) {
+			return 0;
+		}
+
+		// Members without a field are skipped by bracket matching
+		const json_bind_field_t* field = bind_find_field(object->parser, key_token, desc);
+		if (field && !bind_field(&value, field, base)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int json_bind_value(const json_od_value_t* object, const json_bind_desc_t* desc, void* out)
+{
+	if (!object || !desc || !out) {
+		return 0;
+	}
+	return bind_object(object, desc, out);
+}
+
+int json_bind(const char* json, size_t length, const json_bind_desc_t* desc, void* out)
+{
+	if (!json || !desc || !out) {
+		return 0;
+	}
+
+	json_od_parser_t parser;
+	json_od_value_t root;
+	od_parser_init(&parser);
+
+	int result = json_od_iterate(&parser, json, length, &root) &&
+		od_skip_value(&parser, 0) == parser.index.count &&
+		bind_object(&root, desc, out);
+
+	od_parser_release(&parser);
+	return result;
 }
@@ -2,6 +2,7 @@
 #define MULTIFORMAT_JSON_H
 
 #include <stddef.h>
+#include <stdio.h>
 #include "../src/core/data_types.h"
 
 #ifdef __cplusplus
@@ -37,28 +38,1101 @@ extern "C" {
      */
     json_value_t* json_parse(const char* json_str);
 
+    /**
+     * @brief Parse a JSON text of known length
+     *
+     * @param json JSON text, not necessarily null-terminated
+     * @param length Number of bytes of JSON text
+     * @return json_value_t* Pointer to the root JSON element, NULL on error
+     *
+     * @details Same as json_parse() without the strlen() pass, so the text
+     *          can be a slice of a larger buffer or a memory-mapped file.
+     *
+     * @note Memory must be freed using json_free()
+     *
+     * @example
+     * @code
+     * json_value_t* root = json_parse_n(packet->payload, packet->size);
+     * @endcode
+     */
+    json_value_t* json_parse_n(const char* json, size_t length);
+
+    /**
+     * @brief Parse a mutable JSON buffer in place
+     *
+     * @param buffer JSON text, modified by the parser
+     * @param length Number of bytes of JSON text in the buffer
+     * @return json_value_t* Pointer to the root JSON element, NULL on error
+     *
+     * @details Strings and object keys are not copied: escape sequences are
+     *          decoded inside the buffer and each string is terminated in
+     *          place, so json_get_string() and json_object_get_key() return
+     *          pointers into the buffer. Only values and entry arrays are
+     *          allocated.
+     *
+     * @note Memory must be freed using json_free()
+     * @warning The buffer is borrowed: it must stay alive and unmodified
+     *          until the tree is freed, and its content is no longer valid
+     *          JSON after the call, even when parsing fails
+     *
+     * @example
+     * @code
+     * char* text = read_message(&length);
+     * json_value_t* root = json_parse_insitu(text, length);
+     * if (root) {
+     *     // Strings of root point into text
+     *     json_free(root);
+     * }
+     * free(text);
+     * @endcode
+     */
+    json_value_t* json_parse_insitu(char* buffer, size_t length);
+
+    /**
+     * @brief Parse a large top-level JSON array on several threads
+     *
+     * @param json JSON text, not necessarily null-terminated
+     * @param length Number of bytes of JSON text
+     * @param nthreads Number of threads including the caller, 0 for one
+     *                 per hardware thread
+     * @return json_value_t* Pointer to the root JSON element, NULL on error
+     *
+     * @details A structural pre-pass over the text finds the commas between
+     *          the elements of the top-level array and cuts it into ranges
+     *          of whole elements. Threads parse the ranges concurrently,
+     *          each into its own arena, and the elements are then gathered
+     *          into one JSON_ARRAY whose arenas the returned tree owns.
+     *          Other inputs, and arrays too small to be worth splitting,
+     *          are parsed like json_parse_n() on the calling thread.
+     *
+     * @note Memory must be freed using json_free()
+     * @note Error positions are offsets into the whole input, also for
+     *       errors found inside a range
+     *
+     * @example
+     * @code
+     * json_value_t* rows = json_parse_parallel(map, map_size, 0);
+     * @endcode
+     */
+    json_value_t* json_parse_parallel(const char* json, size_t length, size_t nthreads);
+
     /**
      * @brief Read and parse a JSON file
      *
-     * @param filename Path to the JSON file
-     * @return json_value_t* Pointer to the root JSON element, NULL on error
+     * @param filename Path to the JSON file
+     * @return json_value_t* Pointer to the root JSON element, NULL on error
+     *
+     * @details Regular files are memory-mapped read-only and parsed
+     *          straight from the mapping with a sequential access hint, so
+     *          the text is neither copied nor scanned for its length. Files
+     *          that cannot be mapped, such as pipes, are read into memory
+     *          instead. Files larger than 2 GB are supported on 64-bit
+     *          platforms.
+     *
+     * @warning Returns NULL on file read error and for empty files
+     *
+     * @example
+     * @code
+     * json_value_t* config = json_parse_file("config.json");
+     * if (config) {
+     *     // Read configuration
+     *     json_free(config);
+     * }
+     * @endcode
+     */
+    json_value_t* json_parse_file(const char* filename);
+
+    /**
+     * @brief Check that a buffer holds one valid JSON text
+     *
+     * @param json Text to check, need not be null-terminated
+     * @param length Length of the text in bytes
+     * @param error Receives the offset and reason of the first problem, may be NULL
+     * @return int 1 if the text is valid, 0 otherwise
+     *
+     * @details Runs the same 64-byte structural scan as the parser and
+     *          follows the grammar over its output without building a tree,
+     *          an index or anything else: nothing is allocated and nothing
+     *          is printed. UTF-8 is validated with AVX2 lookup tables where
+     *          the CPU supports them. Strings are checked more strictly than
+     *          json_parse() does: control characters, invalid escapes and
+     *          unpaired surrogate escapes are rejected.
+     *
+     * @note Nesting deeper than JSON_DEFAULT_MAX_DEPTH is reported as invalid
+     *
+     * @example
+     * @code
+     * json_error_t error;
+     * if (!json_validate(body, body_length, &error)) {
+     *     reply_bad_request(error.offset, error.message);
+     * }
+     * @endcode
+     */
+    int json_validate(const char* json, size_t length, json_error_t* error);
+
+    // ============================
+    // JSON DOCUMENT FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Create an empty, reusable JSON document
+     *
+     * @return json_document_t* New document, NULL on allocation failure
+     *
+     * @details A document owns a region arena from which every value, entry
+     *          array and string of a parsed tree is allocated. Freeing or
+     *          reparsing the document releases the whole tree at once
+     *          instead of walking it node by node.
+     *
+     * @note Memory must be freed using json_document_free()
+     *
+     * @example
+     * @code
+     * json_document_t* doc = json_document_create();
+     * for (size_t i = 0; i < message_count; i++) {
+     *     json_value_t* root = json_document_parse(doc, messages[i]);
+     *     if (root) {
+     *         // Work with data until the next json_document_parse()
+     *     }
+     * }
+     * json_document_free(doc);
+     * @endcode
+     */
+    json_document_t* json_document_create(void);
+
+    /**
+     * @brief Parse a JSON string into a document
+     *
+     * @param doc Document created with json_document_create()
+     * @param json_str JSON string to parse (null-terminated)
+     * @return json_value_t* Pointer to the root JSON element, NULL on error
+     *
+     * @details Discards the tree previously held by the document and parses
+     *          a new one. The largest arena block is kept between parses, so
+     *          reusing one document for many inputs avoids most calls to
+     *          malloc.
+     *
+     * @warning Values from the previous parse become invalid
+     */
+    json_value_t* json_document_parse(json_document_t* doc, const char* json_str);
+
+    /**
+     * @brief Parse a JSON text of known length into a document
+     *
+     * @param doc Document created with json_document_create()
+     * @param json JSON text, not necessarily null-terminated
+     * @param length Number of bytes of JSON text
+     * @return json_value_t* Pointer to the root JSON element, NULL on error
+     *
+     * @details Same as json_document_parse() without the strlen() pass.
+     *
+     * @warning Values from the previous parse become invalid
+     */
+    json_value_t* json_document_parse_n(json_document_t* doc, const char* json, size_t length);
+
+    /**
+     * @brief Parse a mutable JSON buffer in place into a document
+     *
+     * @param doc Document created with json_document_create()
+     * @param buffer JSON text, modified by the parser
+     * @param length Number of bytes of JSON text in the buffer
+     * @return json_value_t* Pointer to the root JSON element, NULL on error
+     *
+     * @details Same as json_parse_insitu() but reuses the document arena.
+     *          The document borrows the buffer until it is reparsed or freed.
+     */
+    json_value_t* json_document_parse_insitu(json_document_t* doc, char* buffer, size_t length);
+
+    /**
+     * @brief Get the root element of a document
+     *
+     * @param doc Document to query
+     * @return json_value_t* Root element of the last parse, NULL if nothing
+     *         has been parsed yet or the last parse failed
+     */
+    json_value_t* json_document_root(const json_document_t* doc);
+
+    /**
+     * @brief Free a document and every value parsed into it
+     *
+     * @param doc Document to free
+     *
+     * @details Releases the arena blocks of the document. The cost depends
+     *          on the number of blocks, not on the number of values.
+     *
+     * @note Safe to call with NULL
+     */
+    void json_document_free(json_document_t* doc);
+
+    /**
+     * @brief Intern the object keys of future parses into a key pool
+     *
+     * @param doc Document created with json_document_create()
+     * @param pool Pool created with json_key_pool_create(), or NULL to
+     *             store keys in the document again
+     *
+     * @details Takes effect from the next parse. Keys repeated across
+     *          records and documents are then stored once, and
+     *          json_object_get_interned() can compare them by pointer.
+     *
+     * @warning The pool must outlive every tree parsed with it
+     */
+    void json_document_set_key_pool(json_document_t* doc, json_key_pool_t* pool);
+
+    /**
+     * @brief Limit the nesting depth accepted by future parses
+     *
+     * @param doc Document created with json_document_create()
+     * @param max_depth Maximum number of nested arrays and objects,
+     *                  JSON_DEFAULT_MAX_DEPTH unless changed
+     *
+     * @details The parser keeps its open containers on a stack owned by
+     *          the document rather than on the C stack, so deeply nested
+     *          input cannot overflow the stack of the calling thread. The
+     *          limit bounds the memory of that stack; deeper input fails
+     *          with a parse error. json_parse() and json_parse_file() use
+     *          the default limit.
+     */
+    void json_document_set_max_depth(json_document_t* doc, size_t max_depth);
+
+    // ============================
+    // JSON KEY POOL FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Create a pool of interned object keys
+     *
+     * @return json_key_pool_t* New pool, NULL on allocation failure
+     *
+     * @details Each distinct key is stored once together with its hash and
+     *          length. A pool can be shared by any number of documents,
+     *          including documents parsed on different threads.
+     *
+     * @note Memory must be freed using json_key_pool_free()
+     *
+     * @example
+     * @code
+     * json_key_pool_t* pool = json_key_pool_create();
+     * json_document_t* doc = json_document_create();
+     * json_document_set_key_pool(doc, pool);
+     * const char* id_key = json_key_pool_intern(pool, "id");
+     * for (size_t i = 0; i < record_count; i++) {
+     *     json_value_t* record = json_document_parse(doc, records[i]);
+     *     json_value_t* id = json_object_get_interned(record, id_key);
+     *     // Work with id
+     * }
+     * json_document_free(doc);
+     * json_key_pool_free(pool);
+     * @endcode
+     */
+    json_key_pool_t* json_key_pool_create(void);
+
+    /**
+     * @brief Intern a key
+     *
+     * @param pool Pool to intern into
+     * @param key Null-terminated key
+     * @return const char* Stable pointer to the interned key, NULL on
+     *         allocation failure
+     *
+     * @details Returns the same pointer for equal keys, including the keys
+     *          of trees parsed with the pool.
+     */
+    const char* json_key_pool_intern(json_key_pool_t* pool, const char* key);
+
+    /**
+     * @brief Free a key pool
+     *
+     * @param pool Pool to free
+     *
+     * @warning Keys of trees parsed with the pool become invalid
+     * @note Safe to call with NULL
+     */
+    void json_key_pool_free(json_key_pool_t* pool);
+
+    // ============================
+    // JSON ON-DEMAND FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Create a reusable on-demand parser
+     *
+     * @return json_od_parser_t* New parser, NULL on allocation failure
+     *
+     * @details The on-demand API reads a document through cursors instead
+     *          of building a json_value_t tree. Only the structural index of
+     *          the input is built up front; values are decoded when they are
+     *          read and subtrees nobody reads are skipped by matching
+     *          brackets. This suits reading a few fields out of large
+     *          objects.
+     *
+     * @note Memory must be freed using json_od_parser_free()
+     *
+     * @example
+     * @code
+     * json_od_parser_t* parser = json_od_parser_create();
+     * json_od_value_t root, price;
+     * double value;
+     * if (json_od_iterate(parser, json, strlen(json), &root) &&
+     *     json_od_find_field(&root, "price", &price) &&
+     *     json_od_get_double(&price, &value)) {
+     *     printf("Price: %g\n", value);
+     * }
+     * json_od_parser_free(parser);
+     * @endcode
+     */
+    json_od_parser_t* json_od_parser_create(void);
+
+    /**
+     * @brief Start iterating a JSON buffer
+     *
+     * @param parser Parser created with json_od_parser_create()
+     * @param json JSON text, need not be null-terminated
+     * @param length Number of bytes of JSON text
+     * @param root Receives a cursor to the root element
+     * @return int 1 on success, 0 if the buffer cannot be indexed
+     *
+     * @details Builds the structural index of the buffer. Syntax errors
+     *          inside a value are only reported when that value is read.
+     *          Cursors and strings of the previous iteration become invalid.
+     *
+     * @warning The buffer must stay alive while cursors into it are used
+     */
+    int json_od_iterate(json_od_parser_t* parser, const char* json, size_t length, json_od_value_t* root);
+
+    /**
+     * @brief Free an on-demand parser
+     *
+     * @param parser Parser to free
+     *
+     * @note Safe to call with NULL
+     */
+    void json_od_parser_free(json_od_parser_t* parser);
+
+    /**
+     * @brief Get the type of the element under a cursor
+     *
+     * @param value Cursor to inspect
+     * @return json_type_t Type guessed from the first byte of the element
+     *
+     * @details The element is not validated; a getter of the matching type
+     *          fails if it is malformed.
+     */
+    json_type_t json_od_get_type(const json_od_value_t* value);
+
+    /**
+     * @brief Find a field of an object by key
+     *
+     * @param object Cursor to a JSON object
+     * @param key Property name to look up
+     * @param out Receives a cursor to the value
+     * @return int 1 if found, 0 if missing or the object is malformed
+     *
+     * @details Scans the object from its start. Keys are compared without
+     *          decoding unless they contain escapes, and the values of
+     *          other fields are skipped without being parsed.
+     */
+    int json_od_find_field(const json_od_value_t* object, const char* key, json_od_value_t* out);
+
+    /**
+     * @brief Read a JSON number as double
+     *
+     * @param value Cursor to a JSON number
+     * @param out Receives the number
+     * @return int 1 on success, 0 for type mismatch or malformed number
+     */
+    int json_od_get_double(const json_od_value_t* value, double* out);
+
+    /**
+     * @brief Read a JSON number as signed 64-bit integer
+     *
+     * @param value Cursor to a JSON number
+     * @param out Receives the number
+     * @return int 1 on success, 0 for type mismatch, malformed number or
+     *         a value outside the range of int64_t
+     *
+     * @details Same conversion rules as json_get_int64().
+     */
+    int json_od_get_int64(const json_od_value_t* value, int64_t* out);
+
+    /**
+     * @brief Read a JSON boolean
+     *
+     * @param value Cursor to a JSON boolean
+     * @param out Receives 1 for true, 0 for false
+     * @return int 1 on success, 0 for type mismatch
+     */
+    int json_od_get_bool(const json_od_value_t* value, int* out);
+
+    /**
+     * @brief Read a JSON string
+     *
+     * @param value Cursor to a JSON string
+     * @param out Receives the decoded, null-terminated string
+     * @param length Receives the decoded length in bytes, may be NULL
+     * @return int 1 on success, 0 for type mismatch or invalid escape
+     *
+     * @note The string is owned by the parser and valid until the next
+     *       json_od_iterate() or json_od_parser_free()
+     */
+    int json_od_get_string(const json_od_value_t* value, const char** out, size_t* length);
+
+    /**
+     * @brief Check whether the element under a cursor is null
+     *
+     * @param value Cursor to inspect
+     * @return int 1 for a JSON null, 0 otherwise
+     */
+    int json_od_is_null(const json_od_value_t* value);
+
+    /**
+     * @brief Start iterating the elements of an array
+     *
+     * @param array Cursor to a JSON array
+     * @param it Iterator to initialize
+     * @return int 1 on success, 0 for type mismatch
+     *
+     * @example
+     * @code
+     * json_od_iterator_t it;
+     * json_od_value_t item, price;
+     * double total = 0, value;
+     * json_od_array_begin(&items, &it);
+     * while (json_od_array_next(&it, &item)) {
+     *     if (json_od_find_field(&item, "price", &price) &&
+     *         json_od_get_double(&price, &value)) {
+     *         total += value;
+     *     }
+     * }
+     * @endcode
+     */
+    int json_od_array_begin(const json_od_value_t* array, json_od_iterator_t* it);
+
+    /**
+     * @brief Advance an array iterator
+     *
+     * @param it Iterator started with json_od_array_begin()
+     * @param out Receives a cursor to the next element
+     * @return int 1 if an element was returned, 0 at the end of the array
+     *         or on malformed input
+     *
+     * @details Elements that are not read are skipped by matching brackets.
+     */
+    int json_od_array_next(json_od_iterator_t* it, json_od_value_t* out);
+
+    /**
+     * @brief Start iterating the fields of an object
+     *
+     * @param object Cursor to a JSON object
+     * @param it Iterator to initialize
+     * @return int 1 on success, 0 for type mismatch
+     */
+    int json_od_object_begin(const json_od_value_t* object, json_od_iterator_t* it);
+
+    /**
+     * @brief Advance an object iterator
+     *
+     * @param it Iterator started with json_od_object_begin()
+     * @param key Receives the decoded key, may be NULL
+     * @param key_length Receives the key length in bytes, may be NULL
+     * @param value Receives a cursor to the field value
+     * @return int 1 if a field was returned, 0 at the end of the object
+     *         or on malformed input
+     *
+     * @note Keys follow the lifetime rules of json_od_get_string()
+     */
+    int json_od_object_next(json_od_iterator_t* it, const char** key, size_t* key_length, json_od_value_t* value);
+
+    // ============================
+    // JSON SAX FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Parse a JSON buffer into a stream of events
+     *
+     * @param json JSON text, need not be null-terminated
+     * @param length Number of bytes of JSON text
+     * @param handler Callbacks to invoke; NULL members are skipped
+     * @param ctx User pointer passed to every callback
+     * @return int 1 on success, 0 on syntax error or when a callback
+     *         returns 0
+     *
+     * @details Follows the same grammar as json_parse() but calls the
+     *          handler for every value, key and container boundary instead
+     *          of building a tree. Nesting is tracked with one bit per open
+     *          container, so memory use depends on depth only.
+     *
+     * @note Strings and keys passed to callbacks are decoded and
+     *       null-terminated, and are only valid during the callback
+     *
+     * @example
+     * @code
+     * static int count_key(void* ctx, const char* key, size_t length) {
+     *     (*(size_t*)ctx)++;
+     *     return 1;
+     * }
+     *
+     * json_sax_handler_t handler = { 0 };
+     * handler.on_key = count_key;
+     * size_t keys = 0;
+     * json_sax_parse(json, strlen(json), &handler, &keys);
+     * @endcode
+     */
+    int json_sax_parse(const char* json, size_t length, const json_sax_handler_t* handler, void* ctx);
+
+    /**
+     * @brief Parse a JSON file into a stream of events
+     *
+     * @param filename Path to the JSON file
+     * @param handler Callbacks to invoke; NULL members are skipped
+     * @param ctx User pointer passed to every callback
+     * @return int 1 on success, 0 on I/O error, syntax error or when a
+     *         callback returns 0
+     *
+     * @details Reads the file in fixed-size chunks and keeps only the
+     *          token being parsed, so files of any size are processed in
+     *          memory bounded by nesting depth and the longest string.
+     *
+     * @note Callbacks follow the rules of json_sax_parse()
+     */
+    int json_sax_parse_file(const char* filename, const json_sax_handler_t* handler, void* ctx);
+
+    // ============================
+    // JSON PUSH PARSER FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Create a parser that is fed input in chunks
+     *
+     * @param handler Callbacks to invoke, or NULL to build a document
+     * @param ctx User pointer passed to every callback
+     * @return json_push_parser_t* New parser, NULL on allocation failure
+     *
+     * @details The push parser keeps all of its state between calls to
+     *          json_push_feed(), so input can be split at any byte,
+     *          including inside strings, numbers and literals. With a
+     *          handler it reports the same events as json_sax_parse();
+     *          without one it builds a tree that json_push_take_root()
+     *          hands over once the input is finished. Either way, more
+     *          than JSON_DEFAULT_MAX_DEPTH nested arrays and objects
+     *          fail with the same error as json_parse().
+     *
+     * @note Memory must be freed using json_push_parser_free()
+     *
+     * @example
+     * @code
+     * json_push_parser_t* parser = json_push_parser_create(NULL, NULL);
+     * char chunk[4096];
+     * ssize_t n;
+     * while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+     *     if (!json_push_feed(parser, chunk, (size_t)n)) break;
+     * }
+     * json_value_t* root = json_push_finish(parser) ? json_push_take_root(parser) : NULL;
+     * json_push_parser_free(parser);
+     * // Work with root, then json_free(root)
+     * @endcode
+     */
+    json_push_parser_t* json_push_parser_create(const json_sax_handler_t* handler, void* ctx);
+
+    /**
+     * @brief Feed the next chunk of input
+     *
+     * @param parser Parser created with json_push_parser_create()
+     * @param data Next bytes of JSON text
+     * @param length Number of bytes in data
+     * @return int 1 if the input is valid so far, 0 on syntax error or
+     *         when a callback returned 0
+     *
+     * @details Events are delivered as soon as the bytes that complete
+     *          them arrive. The chunk is not referenced after the call.
+     */
+    int json_push_feed(json_push_parser_t* parser, const char* data, size_t length);
+
+    /**
+     * @brief Signal the end of input
+     *
+     * @param parser Parser created with json_push_parser_create()
+     * @return int 1 if exactly one complete JSON value was fed, 0 otherwise
+     *
+     * @details Completes a root number or literal that can only be
+     *          terminated by the end of input.
+     */
+    int json_push_finish(json_push_parser_t* parser);
+
+    /**
+     * @brief Take the document built by a parser without handler
+     *
+     * @param parser Parser created with a NULL handler
+     * @return json_value_t* Root element, NULL if the parse has not
+     *         finished successfully or the root was already taken
+     *
+     * @note The caller owns the tree and must free it using json_free()
+     */
+    json_value_t* json_push_take_root(json_push_parser_t* parser);
+
+    /**
+     * @brief Free a push parser
+     *
+     * @param parser Parser to free
+     *
+     * @details Also frees a document that was built but not taken.
+     *
+     * @note Safe to call with NULL
+     */
+    void json_push_parser_free(json_push_parser_t* parser);
+
+    // ============================
+    // JSON LINES FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Parse a JSON Lines file on several threads
+     *
+     * @param path Path to a file with one JSON text per line
+     * @param nthreads Number of threads to use, 0 for one per CPU
+     * @param callback Function receiving every record
+     * @param ctx User pointer passed to the callback
+     * @param order JSON_LINES_ORDERED to receive records in file order,
+     *              JSON_LINES_UNORDERED to receive them as soon as parsed
+     * @return int 1 if the whole file was processed, 0 on I/O error,
+     *         allocation failure or when the callback returned 0
+     *
+     * @details The file is cut into chunks of whole lines that worker
+     *          threads parse into their own arenas. The callback gets the
+     *          1-based line number and the parsed record, or NULL for a
+     *          line that is not valid JSON. Blank lines are skipped.
+     *
+     * @note Records are owned by the worker and are only valid during the
+     *       callback; they must not be passed to json_free()
+     * @warning In unordered mode the callback runs concurrently on several
+     *          threads and must be thread-safe. In ordered mode calls are
+     *          serialized.
+     *
+     * @example
+     * @code
+     * static int count_errors(void* ctx, size_t line, json_value_t* record) {
+     *     if (!record) (*(size_t*)ctx)++;
+     *     return 1;
+     * }
+     *
+     * size_t errors = 0;
+     * json_parse_lines_parallel("events.jsonl", 0, count_errors, &errors, JSON_LINES_ORDERED);
+     * @endcode
+     */
+    int json_parse_lines_parallel(const char* path, size_t nthreads, json_line_callback_t callback,
+                                  void* ctx, json_lines_order_t order);
+
+    // ============================
+    // JSON TAPE FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Parse JSON text into a compact tape
+     *
+     * @param json JSON text, need not be null-terminated
+     * @param length Number of bytes of JSON text
+     * @return json_tape_t* Parsed tape, NULL on error
+     *
+     * @details A tape is an alternative to the json_value_t tree: every
+     *          value is one or two 64-bit words of a single array in
+     *          document order, and strings live in one separate buffer.
+     *          Containers store the position after their last element, so
+     *          whole subtrees are skipped in one step. Scans over large
+     *          arrays of records walk memory sequentially instead of
+     *          chasing pointers, and the whole document is two allocations.
+     *
+     * @note Memory must be freed using json_tape_free()
+     * @note Tapes are read-only; use json_parse() to get a mutable tree
+     *
+     * @example
+     * @code
+     * json_tape_t* tape = json_tape_parse(json, length);
+     * json_tape_value_t items = json_tape_object_get(json_tape_root(tape), "items");
+     * double total = 0;
+     * for (json_tape_value_t item = json_tape_first(items); json_tape_is_valid(item);
+     *      item = json_tape_next(item)) {
+     *     total += json_tape_get_number(json_tape_object_get(item, "price"));
+     * }
+     * json_tape_free(tape);
+     * @endcode
+     */
+    json_tape_t* json_tape_parse(const char* json, size_t length);
+
+    /**
+     * @brief Free a tape
+     *
+     * @param tape Tape to free
+     *
+     * @note Safe to call with NULL
+     */
+    void json_tape_free(json_tape_t* tape);
+
+    /**
+     * @brief Get the root element of a tape
+     *
+     * @param tape Tape to query
+     * @return json_tape_value_t Root element, invalid if tape is NULL
+     *
+     * @details Tape values are small handles passed by value. Accessors
+     *          return an invalid handle where the tree API returns NULL,
+     *          and accept invalid handles like the tree API accepts NULL.
+     */
+    json_tape_value_t json_tape_root(const json_tape_t* tape);
+
+    /**
+     * @brief Check whether a tape handle refers to an element
+     *
+     * @param value Handle to check
+     * @return int 1 for an element, 0 for a missing one
+     */
+    int json_tape_is_valid(json_tape_value_t value);
+
+    /**
+     * @brief Get the type of a tape element
+     *
+     * @param value Element to query
+     * @return json_type_t Element type, JSON_NULL for invalid handles
+     */
+    json_type_t json_tape_get_type(json_tape_value_t value);
+
+    /**
+     * @brief Get the value of a boolean tape element
+     *
+     * @param value Element to query
+     * @return int 1 for true, 0 for false or a non-boolean element
+     */
+    int json_tape_get_boolean(json_tape_value_t value);
+
+    /**
+     * @brief Get a numeric tape element as a double
+     *
+     * @param value Element to query
+     * @return double Numeric value, 0.0 for non-numeric elements
+     */
+    double json_tape_get_number(json_tape_value_t value);
+
+    /**
+     * @brief Get a numeric tape element as a signed 64-bit integer
+     *
+     * @param value Element to query
+     * @return int64_t Same conversion as json_get_int64()
+     */
+    int64_t json_tape_get_int64(json_tape_value_t value);
+
+    /**
+     * @brief Get the value of a string tape element
+     *
+     * @param value Element to query
+     * @param length Receives the length in bytes, may be NULL
+     * @return const char* Null-terminated string owned by the tape, NULL
+     *         for non-string elements
+     */
+    const char* json_tape_get_string(json_tape_value_t value, size_t* length);
+
+    /**
+     * @brief Get the number of elements of a tape array
+     *
+     * @param value Array to query
+     * @return size_t Element count, 0 for non-array elements
+     *
+     * @note Constant time, the count is stored on the tape
+     */
+    size_t json_tape_get_array_size(json_tape_value_t value);
+
+    /**
+     * @brief Get an element of a tape array by index
+     *
+     * @param value Array to query
+     * @param index Zero-based element index
+     * @return json_tape_value_t Element, invalid if out of range
+     *
+     * @note Skips index siblings, so use json_tape_first() and
+     *       json_tape_next() to visit every element
+     */
+    json_tape_value_t json_tape_array_get(json_tape_value_t value, size_t index);
+
+    /**
+     * @brief Get the number of members of a tape object
+     *
+     * @param value Object to query
+     * @return size_t Member count, 0 for non-object elements
+     */
+    size_t json_tape_object_size(json_tape_value_t value);
+
+    /**
+     * @brief Get the key of a tape object member by index
+     *
+     * @param value Object to query
+     * @param index Zero-based member index
+     * @return const char* Key owned by the tape, NULL if out of range
+     */
+    const char* json_tape_object_get_key(json_tape_value_t value, size_t index);
+
+    /**
+     * @brief Get the value of a tape object member by index
+     *
+     * @param value Object to query
+     * @param index Zero-based member index
+     * @return json_tape_value_t Member value, invalid if out of range
+     */
+    json_tape_value_t json_tape_get_value(json_tape_value_t value, size_t index);
+
+    /**
+     * @brief Find a tape object member by key
+     *
+     * @param value Object to search
+     * @param key Key to look up
+     * @return json_tape_value_t First member with that key, invalid if none
+     */
+    json_tape_value_t json_tape_object_get(json_tape_value_t value, const char* key);
+
+    /**
+     * @brief Get the first element of a tape array or object
+     *
+     * @param container Array or object
+     * @return json_tape_value_t First element or member value, invalid if
+     *         the container is empty or not a container
+     */
+    json_tape_value_t json_tape_first(json_tape_value_t container);
+
+    /**
+     * @brief Get the next sibling of a tape element
+     *
+     * @param value Element of an array, or member value of an object
+     * @return json_tape_value_t Next element, invalid after the last one
+     */
+    json_tape_value_t json_tape_next(json_tape_value_t value);
+
+    /**
+     * @brief Get the key of an object member reached by iteration
+     *
+     * @param member Member value from json_tape_first() or json_tape_next()
+     * @return const char* Key owned by the tape, NULL for array elements
+     */
+    const char* json_tape_key(json_tape_value_t member);
+
+    // ============================
+    // JSON PATH FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Compile a JSONPath or JSON Pointer query
+     *
+     * @param expression Query text (null-terminated)
+     * @return json_path_t* Compiled query, NULL on syntax error
+     *
+     * @details Expressions starting with '$' are JSONPath and support
+     *          member access (".name", "['name']"), array indexes ("[0]")
+     *          and wildcards (".*", "[*]"). Any other expression is a JSON
+     *          Pointer (RFC 6901) such as "/items/0/price", where a token
+     *          is a key for objects and an index for arrays; the empty
+     *          pointer selects the root. Recursive descent, slices and
+     *          filters are not supported.
      *
-     * @details This function reads the entire file content into memory and
-     *          parses it as JSON. Automatically detects file encoding (UTF-8).
+     *          The query is parsed once into a list of steps, so one
+     *          compiled path can be evaluated any number of times, against
+     *          trees with json_path_select() or directly against on-demand
+     *          cursors with json_path_select_od().
      *
-     * @note Maximum file size is limited by available memory
-     * @warning Returns NULL on file read error
+     * @note Memory must be freed using json_path_free()
      *
      * @example
      * @code
-     * json_value_t* config = json_parse_file("config.json");
-     * if (config) {
-     *     // Read configuration
-     *     json_free(config);
+     * json_path_t* prices = json_path_compile("$.items[*].price");
+     * for (size_t i = 0; i < message_count; i++) {
+     *     json_path_select(prices, messages[i], add_price, &total);
      * }
+     * json_path_free(prices);
      * @endcode
      */
-    json_value_t* json_parse_file(const char* filename);
+    json_path_t* json_path_compile(const char* expression);
+
+    /**
+     * @brief Free a compiled query
+     *
+     * @param path Query to free
+     *
+     * @note Safe to call with NULL
+     */
+    void json_path_free(json_path_t* path);
+
+    /**
+     * @brief Evaluate a compiled query against a tree
+     *
+     * @param path Query created with json_path_compile()
+     * @param root Element the query starts from
+     * @param callback Called with each match in document order; return 0
+     *                 to stop the evaluation
+     * @param ctx User context passed to the callback
+     * @return size_t Number of matches passed to the callback
+     *
+     * @details Only the branches selected by the query are visited. Object
+     *          members are looked up with json_object_get(), so indexed
+     *          objects answer in constant time.
+     */
+    size_t json_path_select(const json_path_t* path, const json_value_t* root, json_path_callback_t callback, void* ctx);
+
+    /**
+     * @brief Get the first match of a compiled query in a tree
+     *
+     * @param path Query created with json_path_compile()
+     * @param root Element the query starts from
+     * @return json_value_t* First match, NULL if nothing matches
+     */
+    json_value_t* json_path_get(const json_path_t* path, const json_value_t* root);
+
+    /**
+     * @brief Evaluate a compiled query against an on-demand cursor
+     *
+     * @param path Query created with json_path_compile()
+     * @param root Cursor the query starts from, see json_od_iterate()
+     * @param callback Called with a cursor to each match in document
+     *                 order; return 0 to stop the evaluation
+     * @param ctx User context passed to the callback
+     * @return size_t Number of matches passed to the callback
+     *
+     * @details Works on the raw text without building a tree: subtrees the
+     *          query does not select are skipped by bracket matching and
+     *          never decoded. Evaluation stops quietly at malformed input.
+     */
+    size_t json_path_select_od(const json_path_t* path, const json_od_value_t* root, json_path_od_callback_t callback,
+                               void* ctx);
+
+    /**
+     * @brief Get the first match of a compiled query from a cursor
+     *
+     * @param path Query created with json_path_compile()
+     * @param root Cursor the query starts from
+     * @param out Receives a cursor to the first match
+     * @return int 1 if something matched, 0 otherwise
+     */
+    int json_path_get_od(const json_path_t* path, const json_od_value_t* root, json_od_value_t* out);
+
+    // ============================
+    // JSON PROJECTION FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Compile the set of paths a projected parse should keep
+     *
+     * @param paths Queries in json_path_compile() syntax
+     * @param count Number of queries
+     * @return json_projection_t* Compiled projection, NULL if a query is invalid
+     *
+     * @details The queries are merged into one tree, so paths sharing a
+     *          prefix are followed together. Wildcards are allowed at any
+     *          step; a path that ends selects its value with everything
+     *          below it.
+     *
+     * @note Memory must be freed using json_projection_free()
+     */
+    json_projection_t* json_projection_compile(const char* const* paths, size_t count);
+
+    /**
+     * @brief Free a compiled projection
+     *
+     * @param projection Projection to free
+     *
+     * @note Safe to call with NULL
+     */
+    void json_projection_free(json_projection_t* projection);
+
+    /**
+     * @brief Parse only the parts of a document a projection selects
+     *
+     * @param json JSON text, need not be null-terminated
+     * @param length Number of bytes of JSON text
+     * @param projection Paths to keep, see json_projection_compile()
+     * @return json_value_t* Root of the reduced tree, NULL on error
+     *
+     * @details Builds a tree with the same shape as json_parse_n() would,
+     *          but containing only the selected values and the containers
+     *          on the way to them. Every other member or element is skipped
+     *          by bracket matching on the structural index: its key is
+     *          never copied and nothing under it is decoded or allocated.
+     *          Containers on a selected path are kept even when none of
+     *          their children match, and selected paths that do not exist
+     *          in the document are simply missing from the result.
+     *
+     * @note Memory must be freed using json_free()
+     * @warning Skipped values are not validated, so some malformed inputs
+     *          are accepted
+     *
+     * @example
+     * @code
+     * const char* fields[] = { "$.invoice.id", "$.invoice.total", "$.lines[*].sku" };
+     * json_projection_t* billing = json_projection_compile(fields, 3);
+     *
+     * json_value_t* invoice = json_parse_projected(payload, payload_length, billing);
+     * double total = json_get_number(json_object_get(json_object_get(invoice, "invoice"), "total"));
+     * json_free(invoice);
+     *
+     * json_projection_free(billing);
+     * @endcode
+     */
+    json_value_t* json_parse_projected(const char* json, size_t length, const json_projection_t* projection);
+
+    // ============================
+    // JSON BINDING FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Parse a JSON object straight into a C struct
+     *
+     * @param json JSON text, need not be null-terminated
+     * @param length Number of bytes of JSON text
+     * @param desc Field table describing the struct
+     * @param out Struct to fill
+     * @return int 1 on success, 0 on malformed input or a type mismatch
+     *
+     * @details Members are matched to fields by name and written at their
+     *          offset: JSON_BIND_BOOL and JSON_BIND_INT into an int,
+     *          JSON_BIND_INT64 into an int64_t, JSON_BIND_DOUBLE into a
+     *          double, JSON_BIND_STRING into a char array of the field's
+     *          size, and JSON_BIND_OBJECT into a nested struct described
+     *          by the field's nested table. Members without a field are
+     *          skipped by bracket matching on the structural index and
+     *          never decoded. No json_value_t is allocated. Integer
+     *          fields reject numbers with a fraction and numbers outside
+     *          the range of their type.
+     *
+     * @note Fields that are missing or null keep their previous value, so
+     *       initialize the struct with its defaults first
+     * @warning On failure the struct may be partially filled; skipped
+     *          members are not validated
+     *
+     * @example
+     * @code
+     * typedef struct { char host[64]; int port; int tls; } endpoint_t;
+     *
+     * static const json_bind_field_t endpoint_fields[] = {
+     *     { "host", offsetof(endpoint_t, host), JSON_BIND_STRING, sizeof(((endpoint_t*)0)->host), NULL },
+     *     { "port", offsetof(endpoint_t, port), JSON_BIND_INT, 0, NULL },
+     *     { "tls", offsetof(endpoint_t, tls), JSON_BIND_BOOL, 0, NULL }
+     * };
+     * static const json_bind_desc_t endpoint_desc = { endpoint_fields, 3 };
+     *
+     * endpoint_t endpoint = { "localhost", 80, 0 };
+     * if (json_bind(body, body_length, &endpoint_desc, &endpoint)) {
+     *     connect_to(endpoint.host, endpoint.port);
+     * }
+     * @endcode
+     */
+    int json_bind(const char* json, size_t length, const json_bind_desc_t* desc, void* out);
+
+    /**
+     * @brief Bind the object under an on-demand cursor into a C struct
+     *
+     * @param object Cursor to a JSON object
+     * @param desc Field table describing the struct
+     * @param out Struct to fill
+     * @return int 1 on success, 0 on malformed input or a type mismatch
+     *
+     * @details Same as json_bind() for a cursor, so a reusable on-demand
+     *          parser can be kept across requests and parts of a larger
+     *          document can be bound on their own.
+     */
+    int json_bind_value(const json_od_value_t* object, const json_bind_desc_t* desc, void* out);
 
     // ============================
     // JSON SERIALIZATION FUNCTIONS
@@ -109,8 +1183,9 @@ extern "C" {
      * @param filename Path to the output file
      * @return int 0 on success, non-zero error code on failure
      *
-     * @details Serializes JSON data and writes it to a file. Uses pretty
-     *          printing for better readability. Overwrites existing file.
+     * @details Serializes JSON data in compact form and streams it to the
+     *          file through json_sink_file(), so no copy of the whole text is
+     *          built in memory. Overwrites existing file.
      *
      * @note Creates file if it doesn't exist
      * @warning Returns error if file cannot be written
@@ -124,6 +1199,274 @@ extern "C" {
      */
     int json_serialize_file(const json_value_t* value, const char* filename);
 
+    /**
+     * @brief Sink that writes into a caller buffer
+     *
+     * @param buffer Destination buffer
+     * @param capacity Size of buffer in bytes, terminator included
+     * @return json_sink_t Sink for json_serialize_to_sink()
+     *
+     * @details Output is written in place with no intermediate string and is
+     *          null-terminated. When it does not fit, serialization fails,
+     *          the buffer keeps a null-terminated prefix of the output and
+     *          the sink's length field still gives the full size.
+     *
+     * @note A NULL buffer only counts the output, like json_serialized_size()
+     */
+    json_sink_t json_sink_buffer(char* buffer, size_t capacity);
+
+    /**
+     * @brief Sink that writes to an open stdio stream
+     *
+     * @param file Stream opened for writing; it is neither flushed nor closed
+     * @return json_sink_t Sink for json_serialize_to_sink()
+     *
+     * @details Output is staged in a fixed 16 KiB buffer and passed to
+     *          fwrite() each time it fills.
+     */
+    json_sink_t json_sink_file(FILE* file);
+
+    /**
+     * @brief Sink that writes to a file descriptor
+     *
+     * @param fd Descriptor opened for writing; it is not closed
+     * @return json_sink_t Sink for json_serialize_to_sink()
+     *
+     * @details Like json_sink_file(), with write() taking each full staging
+     *          buffer. Interrupted and partial writes are retried.
+     */
+    json_sink_t json_sink_fd(int fd);
+
+    /**
+     * @brief Sink that passes the output to a callback
+     *
+     * @param write Called with each piece of output; returns 0 to abort
+     * @param ctx User context passed to the callback
+     * @return json_sink_t Sink for json_serialize_to_sink()
+     *
+     * @details Pieces are at most 16 KiB, are not null-terminated and are
+     *          only valid during the call.
+     */
+    json_sink_t json_sink_callback(json_write_callback_t write, void* ctx);
+
+    /**
+     * @brief Serialize JSON structure into a sink
+     *
+     * @param value Pointer to the root JSON element
+     * @param sink Sink made by one of the json_sink_* functions
+     * @return int 1 on success, 0 when the sink fails or a buffer is too small
+     *
+     * @details Produces the same text as json_serialize(), or as
+     *          json_serialize_pretty() when sink->pretty is set, without
+     *          ever holding all of it in memory: output beyond the staging
+     *          buffer is handed to the sink as it is produced. On return
+     *          sink->length holds the number of bytes produced.
+     *
+     * @example
+     * @code
+     * json_sink_t sink = json_sink_file(stdout);
+     * sink.pretty = 1;
+     * if (!json_serialize_to_sink(root, &sink)) {
+     *     fprintf(stderr, "Write failed\n");
+     * }
+     * @endcode
+     */
+    int json_serialize_to_sink(const json_value_t* value, json_sink_t* sink);
+
+    /**
+     * @brief Length of the compact serialization of a JSON structure
+     *
+     * @param value Pointer to the root JSON element
+     * @return size_t Length of the json_serialize() text without its
+     *         terminator, 0 on error
+     *
+     * @details Runs the serializer without storing its output, so a buffer
+     *          of exactly the right size can be allocated once up front.
+     *
+     * @example
+     * @code
+     * size_t size = json_serialized_size(root);
+     * char* text = malloc(size + 1);
+     * json_sink_t sink = json_sink_buffer(text, size + 1);
+     * json_serialize_to_sink(root, &sink);
+     * @endcode
+     */
+    size_t json_serialized_size(const json_value_t* value);
+
+    // ============================
+    // JSON WRITER FUNCTIONS
+    // ============================
+
+    /**
+     * @brief Create a writer that produces JSON text without building a tree
+     *
+     * @param sink Sink made by one of the json_sink_* functions
+     * @return json_writer_t* New writer, NULL on allocation failure
+     *
+     * @details Values are written one call at a time straight into the
+     *          sink's buffer, which is handed on whenever it fills, so
+     *          millions of records can be exported without allocating per
+     *          field. The writer checks that the calls form exactly one
+     *          well-nested value, up to JSON_DEFAULT_MAX_DEPTH levels deep,
+     *          with a key before every object member; the first misuse or
+     *          sink failure makes every later call return 0. Output is
+     *          indented when sink->pretty is set.
+     *
+     * @note The sink must stay valid until the writer is freed
+     * @note Memory must be freed using json_writer_free()
+     *
+     * @example
+     * @code
+     * json_sink_t sink = json_sink_file(stdout);
+     * json_writer_t* writer = json_writer_create(&sink);
+     * json_writer_begin_array(writer);
+     * for (size_t i = 0; i < count; i++) {
+     *     json_writer_begin_object(writer);
+     *     json_writer_key(writer, "id");
+     *     json_writer_write_int(writer, records[i].id);
+     *     json_writer_key(writer, "name");
+     *     json_writer_write_string(writer, records[i].name);
+     *     json_writer_end_object(writer);
+     * }
+     * json_writer_end_array(writer);
+     * if (!json_writer_finish(writer)) {
+     *     fprintf(stderr, "Export failed\n");
+     * }
+     * json_writer_free(writer);
+     * @endcode
+     */
+    json_writer_t* json_writer_create(json_sink_t* sink);
+
+    /**
+     * @brief Open an object
+     *
+     * @param writer Writer created with json_writer_create()
+     * @return int 1 on success, 0 if a value is not allowed here
+     *
+     * @details Members are written as a json_writer_key() call followed by
+     *          one value.
+     */
+    int json_writer_begin_object(json_writer_t* writer);
+
+    /**
+     * @brief Close the innermost object
+     *
+     * @param writer Writer created with json_writer_create()
+     * @return int 1 on success, 0 if the innermost container is not an
+     *         object or its last key has no value
+     */
+    int json_writer_end_object(json_writer_t* writer);
+
+    /**
+     * @brief Open an array
+     *
+     * @param writer Writer created with json_writer_create()
+     * @return int 1 on success, 0 if a value is not allowed here
+     */
+    int json_writer_begin_array(json_writer_t* writer);
+
+    /**
+     * @brief Close the innermost array
+     *
+     * @param writer Writer created with json_writer_create()
+     * @return int 1 on success, 0 if the innermost container is not an array
+     */
+    int json_writer_end_array(json_writer_t* writer);
+
+    /**
+     * @brief Write the key of the next object member
+     *
+     * @param writer Writer created with json_writer_create()
+     * @param key Member name, escaped as needed
+     * @return int 1 on success, 0 outside an object or when the previous
+     *         key still has no value
+     */
+    int json_writer_key(json_writer_t* writer, const char* key);
+
+    /**
+     * @brief Write null
+     *
+     * @param writer Writer created with json_writer_create()
+     * @return int 1 on success, 0 on failure
+     */
+    int json_writer_write_null(json_writer_t* writer);
+
+    /**
+     * @brief Write true or false
+     *
+     * @param writer Writer created with json_writer_create()
+     * @param value Non-zero for true
+     * @return int 1 on success, 0 on failure
+     */
+    int json_writer_write_bool(json_writer_t* writer, int value);
+
+    /**
+     * @brief Write a signed integer exactly
+     *
+     * @param writer Writer created with json_writer_create()
+     * @param value Integer to write
+     * @return int 1 on success, 0 on failure
+     */
+    int json_writer_write_int(json_writer_t* writer, int64_t value);
+
+    /**
+     * @brief Write an unsigned integer exactly
+     *
+     * @param writer Writer created with json_writer_create()
+     * @param value Integer to write
+     * @return int 1 on success, 0 on failure
+     */
+    int json_writer_write_uint(json_writer_t* writer, uint64_t value);
+
+    /**
+     * @brief Write a floating point number
+     *
+     * @param writer Writer created with json_writer_create()
+     * @param value Number to write
+     * @return int 1 on success, 0 on failure
+     *
+     * @details Uses a short text that reads back as the same double, as
+     *          json_serialize() does; it is usually but not always the
+     *          shortest possible. NaN and infinities, which JSON cannot
+     *          represent, are written as null.
+     */
+    int json_writer_write_double(json_writer_t* writer, double value);
+
+    /**
+     * @brief Write a string
+     *
+     * @param writer Writer created with json_writer_create()
+     * @param value Null-terminated UTF-8 text, escaped as needed; NULL
+     *        writes null
+     * @return int 1 on success, 0 on failure
+     */
+    int json_writer_write_string(json_writer_t* writer, const char* value);
+
+    /**
+     * @brief Flush the rest of the output to the sink
+     *
+     * @param writer Writer created with json_writer_create()
+     * @return int 1 if one complete value was written and the sink accepted
+     *         all of it, 0 otherwise
+     *
+     * @details Call once, after the last value. For a buffer sink, 0 also
+     *          means the output did not fit; sink->length then gives the
+     *          size that is needed.
+     */
+    int json_writer_finish(json_writer_t* writer);
+
+    /**
+     * @brief Free a writer
+     *
+     * @param writer Writer to free
+     *
+     * @details Does not flush; output not yet passed on by
+     *          json_writer_finish() is lost.
+     *
+     * @note Safe to call with NULL
+     */
+    void json_writer_free(json_writer_t* writer);
+
     // ============================
     // UTILITY FUNCTIONS
     // ============================
@@ -133,10 +1476,13 @@ extern "C" {
      *
      * @param value Pointer to the root JSON element
      *
-     * @details Recursively frees all memory associated with the JSON structure,
-     *          including nested objects and arrays.
+     * @details Frees the document that owns the tree, including nested
+     *          objects and arrays. Equivalent to calling json_document_free()
+     *          on the document the root belongs to.
      *
      * @note Safe to call with NULL
+     * @warning Only roots returned by the parsing functions may be passed;
+     *          nested elements are released together with their root
      * @warning Pointer becomes invalid after this call
      *
      * @example
@@ -215,7 +1561,8 @@ extern "C" {
      * @return double Numeric value, 0.0 for type mismatch or NULL
      *
      * @details Extracts double-precision floating point value from JSON
-     *          number element. JSON numbers are always parsed as doubles.
+     *          number element. Integers are converted, which rounds values
+     *          beyond 2^53; use json_get_int64() to read them exactly.
      *
      * @warning Check element type before calling
      *
@@ -229,6 +1576,50 @@ extern "C" {
      */
     double json_get_number(const json_value_t* value);
 
+    /**
+     * @brief Get the representation of a JSON number
+     *
+     * @param value Pointer to JSON number element
+     * @return json_number_repr_t JSON_INTEGER, JSON_UNSIGNED or JSON_REAL
+     *
+     * @details Numbers without fraction or exponent are kept as exact
+     *          integers: JSON_INTEGER when they fit in int64_t, JSON_UNSIGNED
+     *          when they only fit in uint64_t. All other numbers are
+     *          JSON_REAL doubles.
+     *
+     * @note Returns JSON_REAL for type mismatch or NULL
+     */
+    json_number_repr_t json_get_number_repr(const json_value_t* value);
+
+    /**
+     * @brief Get signed integer value from JSON element
+     *
+     * @param value Pointer to JSON number element
+     * @return int64_t Integer value, 0 for type mismatch, NULL or out of range
+     *
+     * @details Returns integers exactly, including those above 2^53 that a
+     *          double cannot hold. JSON_REAL values are truncated toward zero.
+     *
+     * @example
+     * @code
+     * json_value_t* id = json_object_get(record, "id");
+     * if (json_get_number_repr(id) == JSON_INTEGER) {
+     *     printf("ID: %" PRId64 "\n", json_get_int64(id));
+     * }
+     * @endcode
+     */
+    int64_t json_get_int64(const json_value_t* value);
+
+    /**
+     * @brief Get unsigned integer value from JSON element
+     *
+     * @param value Pointer to JSON number element
+     * @return uint64_t Integer value, 0 for type mismatch, NULL or out of range
+     *
+     * @details Same as json_get_int64() for the range of uint64_t.
+     */
+    uint64_t json_get_uint64(const json_value_t* value);
+
     /**
      * @brief Get string value from JSON element
      *
@@ -346,7 +1737,9 @@ extern "C" {
      * @return json_value_t* Pointer to value, NULL if key not found
      *
      * @details Searches for a property with the specified key name in the
-     *          JSON object. Key comparison is case-sensitive.
+     *          JSON object. Key comparison is case-sensitive. Objects with
+     *          a hash index are searched in constant expected time, others
+     *          are scanned in order. With duplicate keys the first one wins.
      *
      * @note Returns NULL if key doesn't exist
      * @example
@@ -359,6 +1752,40 @@ extern "C" {
      */
     json_value_t* json_object_get(const json_value_t* value, const char* key);
 
+    /**
+     * @brief Get value from JSON object by interned key
+     *
+     * @param value Pointer to JSON object element parsed with a key pool
+     * @param key Key returned by json_key_pool_intern() for the same pool
+     * @return json_value_t* Pointer to value, NULL if key not found
+     *
+     * @details Compares key pointers instead of strings and takes the key
+     *          hash from the pool, so nothing is hashed or compared byte by
+     *          byte.
+     *
+     * @warning Objects parsed without the pool of key never match
+     */
+    json_value_t* json_object_get_interned(const json_value_t* value, const char* key);
+
+    /**
+     * @brief Build the hash index of a JSON object
+     *
+     * @param doc Document the object was parsed into
+     * @param value Pointer to JSON object element of that document
+     * @return int 1 if the object is indexed, 0 for type mismatch, an
+     *         empty object or allocation failure
+     *
+     * @details Objects with at least JSON_OBJECT_INDEX_THRESHOLD entries
+     *          are indexed while parsing; this builds the index for a
+     *          smaller object that is looked up many times. With an index
+     *          json_object_get() hashes the key once instead of comparing
+     *          it with every entry. The entry order seen by
+     *          json_object_get_key() does not change.
+     *
+     * @note The index is allocated from the document arena
+     */
+    int json_object_build_index(json_document_t* doc, json_value_t* value);
+
 #ifdef __cplusplus
 }
 #endif
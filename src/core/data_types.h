@@ -2,6 +2,7 @@
 #define DATA_TYPES_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef enum{
     DT_JSON,
@@ -24,36 +25,170 @@ typedef enum {
     JSON_OBJECT
 } json_type_t;
 
+typedef enum {
+    JSON_REAL,
+    JSON_INTEGER,
+    JSON_UNSIGNED
+} json_number_repr_t;
+
+typedef struct {
+    union {
+        double real;
+        int64_t integer;
+        uint64_t uinteger;
+    };
+    json_number_repr_t repr;
+} json_number_t;
+
 typedef struct json_value json_value_t;
 
+struct json_object_index;
+
 struct json_object_entry {
     char* key;
     json_value_t* value;
 };
 
+// Containers point at an arena header that holds the children inline
+typedef struct json_array {
+    size_t count;
+    json_value_t* values[];
+} json_array_t;
+
+typedef struct json_object {
+    size_t count;
+    struct json_object_index* index;
+    struct json_object_entry entries[];
+} json_object_t;
+
+// Longest string stored inside the value itself, without the terminator
+#define JSON_INLINE_STRING_MAX 14
+
+// 16 bytes: an 8-byte payload and a tag byte holding the json_type_t, the
+// json_number_repr_t of numbers and whether a string is stored inline.
+// Inline strings overlay everything but the tag. Use the json_get_*
+// accessors rather than reading the fields directly.
 struct json_value {
-    json_type_t type;
     union {
-        int boolean;
-        double number;
-        char* string;
-        struct {
-            json_value_t** values;
-            size_t count;
-            size_t capacity;
-        } array;
         struct {
-            struct json_object_entry* entries;
-            size_t count;
-            size_t capacity;
-        } object;
-    } data;
+            union {
+                int boolean;
+                double real;
+                int64_t integer;
+                uint64_t uinteger;
+                char* string;
+                json_array_t* array;
+                json_object_t* object;
+            } data;
+            char reserved[7];
+            uint8_t tag;
+        };
+        char inline_string[JSON_INLINE_STRING_MAX + 1];
+    };
 };
 
-typedef struct free_stack_node {
-    json_value_t* value;
-    struct free_stack_node* next;
-}free_stack_node_t;
+typedef struct json_document json_document_t;
+
+#define JSON_DEFAULT_MAX_DEPTH 1024
+
+typedef struct {
+    size_t offset;
+    const char* message;
+} json_error_t;
+
+typedef struct json_key_pool json_key_pool_t;
+
+typedef struct json_od_parser json_od_parser_t;
+
+typedef struct {
+    json_od_parser_t* parser;
+    size_t token;
+} json_od_value_t;
+
+typedef struct {
+    json_od_parser_t* parser;
+    size_t token;
+    char close;
+} json_od_iterator_t;
+
+typedef struct {
+    int (*on_null)(void* ctx);
+    int (*on_bool)(void* ctx, int value);
+    int (*on_number)(void* ctx, const json_number_t* number);
+    int (*on_string)(void* ctx, const char* value, size_t length);
+    int (*on_start_object)(void* ctx);
+    int (*on_key)(void* ctx, const char* key, size_t length);
+    int (*on_end_object)(void* ctx);
+    int (*on_start_array)(void* ctx);
+    int (*on_end_array)(void* ctx);
+} json_sax_handler_t;
+
+typedef struct json_push_parser json_push_parser_t;
+
+typedef enum {
+    JSON_LINES_UNORDERED,
+    JSON_LINES_ORDERED
+} json_lines_order_t;
+
+typedef int (*json_line_callback_t)(void* ctx, size_t line, json_value_t* record);
+
+typedef struct json_tape json_tape_t;
+
+typedef struct json_path json_path_t;
+
+typedef struct json_projection json_projection_t;
+
+typedef enum {
+    JSON_BIND_BOOL,
+    JSON_BIND_INT,
+    JSON_BIND_INT64,
+    JSON_BIND_DOUBLE,
+    JSON_BIND_STRING,
+    JSON_BIND_OBJECT
+} json_bind_type_t;
+
+typedef struct json_bind_desc json_bind_desc_t;
+
+typedef struct {
+    const char* name;
+    size_t offset;
+    json_bind_type_t type;
+    // Capacity of a JSON_BIND_STRING char array, terminator included
+    size_t size;
+    // Layout of a JSON_BIND_OBJECT member
+    const json_bind_desc_t* nested;
+} json_bind_field_t;
+
+struct json_bind_desc {
+    const json_bind_field_t* fields;
+    size_t count;
+};
+
+typedef int (*json_path_callback_t)(void* ctx, json_value_t* match);
+typedef int (*json_path_od_callback_t)(void* ctx, const json_od_value_t* match);
+
+typedef struct {
+    const json_tape_t* tape;
+    size_t index;
+} json_tape_value_t;
+
+// Receives serialized output piece by piece; returns 0 to stop serializing
+typedef int (*json_write_callback_t)(void* ctx, const char* data, size_t length);
+
+// Destination of json_serialize_to_sink(), made by the json_sink_* functions
+typedef struct {
+    json_write_callback_t write;
+    void* ctx;
+    // Caller buffer filled in place when there is no write callback
+    char* buffer;
+    size_t capacity;
+    // Bytes of output produced, including any that did not fit the buffer
+    size_t length;
+    // Indent the output the way json_serialize_pretty() does
+    int pretty;
+} json_sink_t;
+
+typedef struct json_writer json_writer_t;
 
 
 typedef struct {
@@ -0,0 +1,99 @@
+﻿#include "json_arena.h"
+#include "json_pool.h"
+
+void arena_init(json_arena_t* arena)
+{
+	arena->blocks = NULL;
+	arena->ptr = NULL;
+	arena->avail = 0;
+	arena->next_size = JSON_ARENA_MIN_BLOCK_SIZE;
+}
+
+void arena_reserve(json_arena_t* arena, size_t size_hint)
+{
+	if (size_hint > JSON_ARENA_MAX_BLOCK_SIZE) {
+		size_hint = JSON_ARENA_MAX_BLOCK_SIZE;
+	}
+	if (size_hint > arena->next_size) {
+		arena->next_size = size_hint;
+	}
+}
+
+void* arena_alloc_slow(json_arena_t* arena, size_t size)
+{
+	// next_size counts the header too, so small blocks fill a pool class
+	// exactly and come back from other arenas once freed
+	size_t total = arena->next_size;
+	if (total < sizeof(json_arena_block_t) + size) {
+		total = sizeof(json_arena_block_t) + size;
+	}
+	total = pool_size(total);
+
+	// The header size is a multiple of JSON_ARENA_ALIGN on every platform we build for
+	json_arena_block_t* block = pool_alloc(total);
+	if (!block) return NULL;
+
+	block->size = total - sizeof(json_arena_block_t);
+	block->next = arena->blocks;
+	arena->blocks = block;
+
+	if (arena->next_size < JSON_ARENA_MAX_BLOCK_SIZE) {
+		arena->next_size *= 2;
+	}
+
+	arena->ptr = (char*)(block + 1) + size;
+	arena->avail = block->size - size;
+	return block + 1;
+}
+
+void arena_reset(json_arena_t* arena)
+{
+	json_arena_block_t* block = arena->blocks;
+	if (!block) return;
+
+	// Keep only the newest block: it is the largest one, so a document of
+	// similar size parsed next usually fits without touching malloc again
+	json_arena_block_t* rest = block->next;
+	while (rest) {
+		json_arena_block_t* next = rest->next;
+		pool_free(rest, sizeof(json_arena_block_t) + rest->size);
+		rest = next;
+	}
+
+	block->next = NULL;
+	arena->ptr = (char*)(block + 1);
+	arena->avail = block->size;
+}
+
+// Moves every block of other into arena and leaves other empty
+void arena_adopt(json_arena_t* arena, json_arena_t* other)
+{
+	json_arena_block_t* first = other->blocks;
+	if (!first) return;
+
+	json_arena_block_t* last = first;
+	while (last->next) {
+		last = last->next;
+	}
+
+	// The current block stays at the head so allocation continues in it
+	if (arena->blocks) {
+		last->next = arena->blocks->next;
+		arena->blocks->next = first;
+	}
+	else {
+		arena->blocks = first;
+	}
+	arena_init(other);
+}
+
+void arena_free(json_arena_t* arena)
+{
+	json_arena_block_t* block = arena->blocks;
+	while (block) {
+		json_arena_block_t* next = block->next;
+		pool_free(block, sizeof(json_arena_block_t) + block->size);
+		block = next;
+	}
+	arena_init(arena);
+}
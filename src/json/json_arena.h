@@ -0,0 +1,55 @@
+﻿#ifndef MULTIFORMAT_JSON_ARENA_H
+#define MULTIFORMAT_JSON_ARENA_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_ARENA_MIN_BLOCK_SIZE (4 * 1024)
+#define JSON_ARENA_MAX_BLOCK_SIZE (16 * 1024 * 1024)
+#define JSON_ARENA_ALIGN 8
+
+// Blocks are chained newest-first; the usable memory follows the header.
+typedef struct json_arena_block {
+	struct json_arena_block* next;
+	size_t size;
+}json_arena_block_t;
+
+typedef struct {
+	json_arena_block_t* blocks;
+	char* ptr;
+	size_t avail;
+	size_t next_size;
+}json_arena_t;
+
+void arena_init(json_arena_t* arena);
+void arena_reserve(json_arena_t* arena, size_t size_hint);
+void* arena_alloc_slow(json_arena_t* arena, size_t size);
+void arena_reset(json_arena_t* arena);
+void arena_adopt(json_arena_t* arena, json_arena_t* other);
+void arena_free(json_arena_t* arena);
+
+static inline void* arena_alloc(json_arena_t* arena, size_t size)
+{
+	size = (size + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1);
+	if (size > arena->avail) {
+		return arena_alloc_slow(arena, size);
+	}
+
+	void* result = arena->ptr;
+	arena->ptr += size;
+	arena->avail -= size;
+	return result;
+}
+
+static inline char* arena_strndup(json_arena_t* arena, const char* str, size_t length)
+{
+	char* copy = arena_alloc(arena, length + 1);
+	if (copy) {
+		memcpy(copy, str, length);
+		copy[length] = '\0';
+	}
+	return copy;
+}
+
+#endif // MULTIFORMAT_JSON_ARENA_H
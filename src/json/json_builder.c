@@ -0,0 +1,178 @@
+﻿#include "json_builder.h"
+
+void builder_init(json_builder_t* builder, json_document_t* doc)
+{
+	arena_reset(&doc->arena);
+	doc->stack_size = 0;
+	value_init(&doc->root, JSON_NULL);
+	doc->has_root = 0;
+
+	builder->doc = doc;
+	builder->key = NULL;
+	builder->open_base = 0;
+	builder->depth = 0;
+}
+
+json_value_t* builder_root(json_builder_t* builder)
+{
+	json_document_t* doc = builder->doc;
+	if (builder->depth != 0 || doc->stack_size != 1) {
+		return NULL;
+	}
+
+	doc->root = *doc->stack[0].value;
+	doc->has_root = 1;
+	doc->stack_size = 0;
+	return &doc->root;
+}
+
+static json_value_t* builder_add(json_builder_t* builder, json_type_t type)
+{
+	json_document_t* doc = builder->doc;
+	if (doc->stack_size >= doc->stack_capacity) {
+		size_t new_capacity = doc->stack_capacity ? doc->stack_capacity * 2 : JSON_PARSE_STACK_INIT_SIZE;
+		struct json_object_entry* new_stack = pool_realloc(doc->stack,
+			sizeof(struct json_object_entry) * doc->stack_capacity, sizeof(struct json_object_entry) * new_capacity);
+		if (!new_stack) {
+			return NULL;
+		}
+		doc->stack = new_stack;
+		doc->stack_capacity = new_capacity;
+	}
+
+	json_value_t* value = arena_alloc(&doc->arena, sizeof(json_value_t));
+	if (!value) {
+		return NULL;
+	}
+	value_init(value, type);
+
+	doc->stack[doc->stack_size].key = builder->key;
+	doc->stack[doc->stack_size].value = value;
+	doc->stack_size++;
+	builder->key = NULL;
+	return value;
+}
+
+static int builder_on_null(void* ctx)
+{
+	return builder_add(ctx, JSON_NULL) != NULL;
+}
+
+static int builder_on_bool(void* ctx, int boolean)
+{
+	json_value_t* value = builder_add(ctx, JSON_BOOL);
+	if (!value) return 0;
+	value->data.boolean = boolean;
+	return 1;
+}
+
+static int builder_on_number(void* ctx, const json_number_t* number)
+{
+	json_value_t* value = builder_add(ctx, JSON_NUMBER);
+	if (!value) return 0;
+	value_set_number(value, number);
+	return 1;
+}
+
+static int builder_on_string(void* ctx, const char* string, size_t length)
+{
+	json_builder_t* builder = ctx;
+	json_value_t* value = builder_add(builder, JSON_STRING);
+	if (!value) return 0;
+	return value_set_string(&builder->doc->arena, value, string, length);
+}
+
+static int builder_on_key(void* ctx, const char* key, size_t length)
+{
+	json_builder_t* builder = ctx;
+	json_document_t* doc = builder->doc;
+	builder->key = doc->key_pool ? (char*)key_pool_intern(doc->key_pool, key, length) :
+		arena_strndup(&doc->arena, key, length);
+	return builder->key != NULL;
+}
+
+// Open containers keep the first-child index of their parent in their
+// payload until they are closed, so no separate frame stack is needed
+static int builder_open(json_builder_t* builder, json_type_t type)
+{
+	if (builder->depth >= builder->doc->max_depth) return 0;
+
+	json_value_t* container = builder_add(builder, type);
+	if (!container) return 0;
+
+	container->data.uinteger = builder->open_base;
+	builder->open_base = builder->doc->stack_size;
+	builder->depth++;
+	return 1;
+}
+
+static json_value_t* builder_close(json_builder_t* builder, size_t* base, size_t* count)
+{
+	json_document_t* doc = builder->doc;
+	json_value_t* container = doc->stack[builder->open_base - 1].value;
+
+	*base = builder->open_base;
+	*count = doc->stack_size - *base;
+	builder->open_base = (size_t)container->data.uinteger;
+	builder->depth--;
+	doc->stack_size = *base;
+	return container;
+}
+
+static int builder_on_start_object(void* ctx)
+{
+	return builder_open(ctx, JSON_OBJECT);
+}
+
+static int builder_on_end_object(void* ctx)
+{
+	json_builder_t* builder = ctx;
+	size_t base, count;
+	json_value_t* object = builder_close(builder, &base, &count);
+	struct json_object_entry* entries = value_make_object(&builder->doc->arena, object, count);
+	if (!entries) {
+		return 0;
+	}
+
+	if (count) {
+		memcpy(entries, builder->doc->stack + base, sizeof(struct json_object_entry) * count);
+	}
+	if (count >= JSON_OBJECT_INDEX_THRESHOLD) {
+		object->data.object->index = object_index_build(&builder->doc->arena, entries, count,
+			builder->doc->key_pool != NULL);
+	}
+	return 1;
+}
+
+static int builder_on_start_array(void* ctx)
+{
+	return builder_open(ctx, JSON_ARRAY);
+}
+
+static int builder_on_end_array(void* ctx)
+{
+	json_builder_t* builder = ctx;
+	size_t base, count;
+	json_value_t* array = builder_close(builder, &base, &count);
+	json_value_t** values = value_make_array(&builder->doc->arena, array, count);
+	if (!values) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		values[i] = builder->doc->stack[base + i].value;
+	}
+	return 1;
+}
+
+const json_sax_handler_t json_builder_handler = {
+	.on_null = builder_on_null,
+	.on_bool = builder_on_bool,
+	.on_number = builder_on_number,
+	.on_string = builder_on_string,
+	.on_start_object = builder_on_start_object,
+	.on_key = builder_on_key,
+	.on_end_object = builder_on_end_object,
+	.on_start_array = builder_on_start_array,
+	.on_end_array = builder_on_end_array
+};
@@ -0,0 +1,23 @@
+﻿#ifndef MULTIFORMAT_JSON_BUILDER_H
+#define MULTIFORMAT_JSON_BUILDER_H
+
+#include "json_parser.h"
+
+// SAX handler that builds a tree into a document, for parsers that produce
+// events rather than values. Children are collected on the document entry
+// stack and copied into exactly sized arena headers when their container
+// closes, the same way parse_value() does it.
+typedef struct {
+	json_document_t* doc;
+	char* key;
+	// Stack index of the first child of the innermost open container
+	size_t open_base;
+	size_t depth;
+}json_builder_t;
+
+extern const json_sax_handler_t json_builder_handler;
+
+void builder_init(json_builder_t* builder, json_document_t* doc);
+json_value_t* builder_root(json_builder_t* builder);
+
+#endif // MULTIFORMAT_JSON_BUILDER_H
@@ -0,0 +1,168 @@
+﻿#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#if !defined(_WIN32) && !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "json_file.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Used for pipes and other files that cannot be mapped
+static int file_view_read(json_file_view_t* view, const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file) return 0;
+
+	size_t capacity = 64 * 1024;
+	size_t length = 0;
+	char* buffer = malloc(capacity);
+
+	while (buffer) {
+		length += fread(buffer + length, 1, capacity - length, file);
+		if (length < capacity) {
+			break;
+		}
+
+		char* new_buffer = capacity <= SIZE_MAX / 2 ? realloc(buffer, capacity * 2) : NULL;
+		if (!new_buffer) {
+			free(buffer);
+			buffer = NULL;
+			break;
+		}
+		buffer = new_buffer;
+		capacity *= 2;
+	}
+
+	int failed = ferror(file);
+	fclose(file);
+	if (!buffer || failed || length == 0) {
+		free(buffer);
+		return 0;
+	}
+
+	view->data = buffer;
+	view->length = length;
+	view->mapped = 0;
+	return 1;
+}
+
+#ifdef _WIN32
+
+int file_view_open(json_file_view_t* view, const char* path)
+{
+	view->data = NULL;
+	view->length = 0;
+	view->mapped = 0;
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return 0;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || GetFileType(file) != FILE_TYPE_DISK) {
+		CloseHandle(file);
+		return file_view_read(view, path);
+	}
+	if (size.QuadPart <= 0 || (unsigned long long)size.QuadPart > SIZE_MAX) {
+		CloseHandle(file);
+		return 0;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const char* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+	// The view keeps the file open on its own
+	if (mapping) CloseHandle(mapping);
+	CloseHandle(file);
+
+	if (!data) {
+		return file_view_read(view, path);
+	}
+
+	view->data = data;
+	view->length = (size_t)size.QuadPart;
+	view->mapped = 1;
+	return 1;
+}
+
+void file_view_close(json_file_view_t* view)
+{
+	if (view->mapped) {
+		UnmapViewOfFile(view->data);
+	}
+	else {
+		free((char*)view->data);
+	}
+	view->data = NULL;
+	view->length = 0;
+}
+
+#else
+
+int file_view_open(json_file_view_t* view, const char* path)
+{
+	view->data = NULL;
+	view->length = 0;
+	view->mapped = 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return 0;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+		close(fd);
+		return file_view_read(view, path);
+	}
+	if (info.st_size <= 0 || (uintmax_t)info.st_size > SIZE_MAX) {
+		close(fd);
+		return 0;
+	}
+
+	size_t length = (size_t)info.st_size;
+	void* data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping keeps the file open on its own
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		return file_view_read(view, path);
+	}
+
+#ifdef POSIX_MADV_SEQUENTIAL
+	posix_madvise(data, length, POSIX_MADV_SEQUENTIAL);
+#endif
+
+	view->data = data;
+	view->length = length;
+	view->mapped = 1;
+	return 1;
+}
+
+void file_view_close(json_file_view_t* view)
+{
+	if (view->mapped) {
+		munmap((void*)view->data, view->length);
+	}
+	else {
+		free((char*)view->data);
+	}
+	view->data = NULL;
+	view->length = 0;
+}
+
+#endif
@@ -0,0 +1,16 @@
+﻿#ifndef MULTIFORMAT_JSON_FILE_H
+#define MULTIFORMAT_JSON_FILE_H
+
+#include <stddef.h>
+
+// Read-only view of a whole file, memory-mapped when the platform allows it
+typedef struct {
+	const char* data;
+	size_t length;
+	int mapped;
+}json_file_view_t;
+
+int file_view_open(json_file_view_t* view, const char* path);
+void file_view_close(json_file_view_t* view);
+
+#endif // MULTIFORMAT_JSON_FILE_H
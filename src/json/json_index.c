@@ -0,0 +1,104 @@
+﻿#include "json_index.h"
+#include "json_key_pool.h"
+
+// Eight bytes per multiply; keys are short, so there is no separate tail loop
+uint32_t json_hash_key(const char* key, size_t length)
+{
+	uint64_t hash = 0x9E3779B97F4A7C15ull ^ length;
+
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, key, 8);
+		hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 32;
+		key += 8;
+		length -= 8;
+	}
+
+	if (length > 0) {
+		uint64_t word = 0;
+		memcpy(&word, key, length);
+		hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+	return (uint32_t)hash;
+}
+
+struct json_object_index* object_index_build(json_arena_t* arena, const struct json_object_entry* entries, size_t count,
+	int interned)
+{
+	if (count == 0 || count >= UINT32_MAX / 2) {
+		return NULL;
+	}
+
+	// At most half full keeps probe sequences short
+	size_t slot_count = 16;
+	while (slot_count < count * 2) {
+		slot_count *= 2;
+	}
+
+	struct json_object_index* index = arena_alloc(arena,
+		sizeof(struct json_object_index) + sizeof(uint32_t) * (count + slot_count));
+	if (!index) {
+		return NULL;
+	}
+
+	index->mask = slot_count - 1;
+	index->hashes = (uint32_t*)(index + 1);
+	index->slots = index->hashes + count;
+	memset(index->slots, 0, sizeof(uint32_t) * slot_count);
+
+	for (size_t i = 0; i < count; i++) {
+		const char* key = entries[i].key;
+		uint32_t hash = interned ? key_header(key)->hash : json_hash_key(key, strlen(key));
+		index->hashes[i] = hash;
+
+		// Lookups return the first of duplicate keys, like the linear scan
+		size_t slot = hash & index->mask;
+		for (;;) {
+			uint32_t position = index->slots[slot];
+			if (position == 0) {
+				index->slots[slot] = (uint32_t)(i + 1);
+				break;
+			}
+			if (index->hashes[position - 1] == hash && strcmp(entries[position - 1].key, key) == 0) {
+				break;
+			}
+			slot = (slot + 1) & index->mask;
+		}
+	}
+
+	return index;
+}
+
+json_value_t* object_index_find(const struct json_object_index* index, const struct json_object_entry* entries,
+	const char* key, uint32_t hash)
+{
+	for (size_t slot = hash & index->mask;; slot = (slot + 1) & index->mask) {
+		uint32_t position = index->slots[slot];
+		if (position == 0) {
+			return NULL;
+		}
+		if (index->hashes[position - 1] == hash && strcmp(entries[position - 1].key, key) == 0) {
+			return entries[position - 1].value;
+		}
+	}
+}
+
+// Keys from one pool are equal exactly when their pointers are
+json_value_t* object_index_find_interned(const struct json_object_index* index, const struct json_object_entry* entries,
+	const char* key, uint32_t hash)
+{
+	for (size_t slot = hash & index->mask;; slot = (slot + 1) & index->mask) {
+		uint32_t position = index->slots[slot];
+		if (position == 0) {
+			return NULL;
+		}
+		if (entries[position - 1].key == key) {
+			return entries[position - 1].value;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+﻿#ifndef MULTIFORMAT_JSON_INDEX_H
+#define MULTIFORMAT_JSON_INDEX_H
+
+#include "../core/data_types.h"
+#include "json_arena.h"
+
+// Objects with at least this many entries get a hash index while parsing
+#define JSON_OBJECT_INDEX_THRESHOLD 16
+
+// Open-addressing table over the entries of one object. Entries keep their
+// order; the table only maps key hashes to entry positions.
+struct json_object_index {
+	size_t mask;
+	// Hash of every entry key, in entry order, computed once
+	uint32_t* hashes;
+	// Entry position + 1; 0 marks an empty slot
+	uint32_t* slots;
+};
+
+uint32_t json_hash_key(const char* key, size_t length);
+// With interned keys the hashes are read from the key headers
+struct json_object_index* object_index_build(json_arena_t* arena, const struct json_object_entry* entries, size_t count,
+	int interned);
+json_value_t* object_index_find(const struct json_object_index* index, const struct json_object_entry* entries,
+	const char* key, uint32_t hash);
+json_value_t* object_index_find_interned(const struct json_object_index* index, const struct json_object_entry* entries,
+	const char* key, uint32_t hash);
+
+#endif // MULTIFORMAT_JSON_INDEX_H
@@ -0,0 +1,101 @@
+﻿#include "json_key_pool.h"
+#include "json_index.h"
+
+void key_pool_init(json_key_pool_t* pool)
+{
+	mutex_init(&pool->lock);
+	arena_init(&pool->arena);
+	pool->slots = NULL;
+	pool->mask = 0;
+	pool->count = 0;
+}
+
+void key_pool_release(json_key_pool_t* pool)
+{
+	arena_free(&pool->arena);
+	free((void*)pool->slots);
+	pool->slots = NULL;
+	pool->mask = 0;
+	pool->count = 0;
+	mutex_destroy(&pool->lock);
+}
+
+static int key_pool_grow(json_key_pool_t* pool)
+{
+	size_t slot_count = pool->slots ? (pool->mask + 1) * 2 : JSON_KEY_POOL_INIT_SLOTS;
+	const char** slots = calloc(slot_count, sizeof(const char*));
+	if (!slots) {
+		return 0;
+	}
+
+	size_t mask = slot_count - 1;
+	if (pool->slots) {
+		for (size_t i = 0; i <= pool->mask; i++) {
+			const char* key = pool->slots[i];
+			if (!key) continue;
+
+			size_t slot = key_header(key)->hash & mask;
+			while (slots[slot]) {
+				slot = (slot + 1) & mask;
+			}
+			slots[slot] = key;
+		}
+		free((void*)pool->slots);
+	}
+
+	pool->slots = slots;
+	pool->mask = mask;
+	return 1;
+}
+
+const char* key_pool_intern(json_key_pool_t* pool, const char* key, size_t length)
+{
+	if (length > UINT32_MAX) {
+		return NULL;
+	}
+
+	// Hashing happens outside the lock
+	uint32_t hash = json_hash_key(key, length);
+	const char* result = NULL;
+
+	mutex_lock(&pool->lock);
+
+	// At most half full
+	if ((pool->count + 1) * 2 > pool->mask + 1 && !key_pool_grow(pool)) {
+		mutex_unlock(&pool->lock);
+		return NULL;
+	}
+
+	size_t slot = hash & pool->mask;
+	for (;;) {
+		const char* candidate = pool->slots[slot];
+		if (!candidate) {
+			break;
+		}
+		const json_key_header_t* header = key_header(candidate);
+		if (header->hash == hash && header->length == length && memcmp(candidate, key, length) == 0) {
+			result = candidate;
+			break;
+		}
+		slot = (slot + 1) & pool->mask;
+	}
+
+	if (!result) {
+		json_key_header_t* header = arena_alloc(&pool->arena, sizeof(json_key_header_t) + length + 1);
+		if (header) {
+			header->hash = hash;
+			header->length = (uint32_t)length;
+
+			char* copy = (char*)(header + 1);
+			memcpy(copy, key, length);
+			copy[length] = '\0';
+
+			pool->slots[slot] = copy;
+			pool->count++;
+			result = copy;
+		}
+	}
+
+	mutex_unlock(&pool->lock);
+	return result;
+}
@@ -0,0 +1,35 @@
+﻿#ifndef MULTIFORMAT_JSON_KEY_POOL_H
+#define MULTIFORMAT_JSON_KEY_POOL_H
+
+#include "../core/data_types.h"
+#include "json_arena.h"
+#include "json_thread.h"
+
+#define JSON_KEY_POOL_INIT_SLOTS 256
+
+// Every interned key is preceded by its header, so the hash and length of
+// a key taken from a parsed tree are available without touching the pool
+typedef struct {
+	uint32_t hash;
+	uint32_t length;
+}json_key_header_t;
+
+// Pools may be shared by documents parsed on different threads
+struct json_key_pool {
+	json_mutex_t lock;
+	json_arena_t arena;
+	const char** slots;
+	size_t mask;
+	size_t count;
+};
+
+void key_pool_init(json_key_pool_t* pool);
+void key_pool_release(json_key_pool_t* pool);
+const char* key_pool_intern(json_key_pool_t* pool, const char* key, size_t length);
+
+static inline const json_key_header_t* key_header(const char* key)
+{
+	return (const json_key_header_t*)key - 1;
+}
+
+#endif // MULTIFORMAT_JSON_KEY_POOL_H
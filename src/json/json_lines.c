@@ -0,0 +1,338 @@
+﻿#include "json_lines.h"
+#include "json_parser.h"
+#include "json_thread.h"
+
+typedef struct {
+	size_t line;
+	json_value_t* value;
+}json_line_record_t;
+
+typedef struct json_lines_job json_lines_job_t;
+
+typedef struct {
+	json_lines_job_t* job;
+	json_document_t doc;
+	char* buffer;
+	size_t capacity;
+	size_t length;
+	size_t chunk;
+	size_t first_line;
+	// Records of the current chunk waiting for their turn in ordered mode
+	json_line_record_t* records;
+	size_t record_count;
+	size_t record_capacity;
+	int failed;
+}json_lines_worker_t;
+
+struct json_lines_job {
+	json_line_callback_t callback;
+	void* ctx;
+	json_lines_order_t order;
+
+	// Reader state, guarded by lock
+	json_mutex_t lock;
+	FILE* file;
+	char* carry;
+	size_t carry_length;
+	size_t carry_capacity;
+	size_t next_chunk;
+	size_t next_line;
+	int eof;
+	int stop;
+	int failed;
+
+	// Delivery turn in ordered mode, guarded by order_lock
+	json_mutex_t order_lock;
+	json_cond_t order_cond;
+	size_t next_delivery;
+	int order_stop;
+};
+
+static int reserve_buffer(char** buffer, size_t* capacity, size_t needed)
+{
+	if (needed <= *capacity) {
+		return 1;
+	}
+
+	size_t new_capacity = *capacity ? *capacity * 2 : JSON_LINES_CHUNK_SIZE;
+	while (new_capacity < needed) {
+		new_capacity *= 2;
+	}
+
+	char* new_buffer = realloc(*buffer, new_capacity);
+	if (!new_buffer) {
+		return 0;
+	}
+	*buffer = new_buffer;
+	*capacity = new_capacity;
+	return 1;
+}
+
+static void job_stop(json_lines_job_t* job, int failed)
+{
+	mutex_lock(&job->lock);
+	job->stop = 1;
+	job->failed |= failed;
+	mutex_unlock(&job->lock);
+
+	mutex_lock(&job->order_lock);
+	job->order_stop = 1;
+	cond_broadcast(&job->order_cond);
+	mutex_unlock(&job->order_lock);
+}
+
+// Fills the worker buffer with the next run of whole lines; the partial
+// line at the end is carried over to the next chunk. Called under lock.
+static int read_chunk(json_lines_job_t* job, json_lines_worker_t* worker)
+{
+	if (job->stop || (job->eof && job->carry_length == 0)) {
+		return 0;
+	}
+
+	if (!reserve_buffer(&worker->buffer, &worker->capacity, job->carry_length + JSON_LINES_CHUNK_SIZE)) {
+		job->stop = job->failed = 1;
+		return 0;
+	}
+
+	// No carry has been allocated before the first chunk
+	if (job->carry_length) {
+		memcpy(worker->buffer, job->carry, job->carry_length);
+	}
+	size_t length = job->carry_length;
+	size_t scanned = 0;
+	size_t cut = 0;
+
+	for (;;) {
+		if (!job->eof) {
+			size_t wanted = worker->capacity - length;
+			size_t read = fread(worker->buffer + length, 1, wanted, job->file);
+			length += read;
+			if (read < wanted) {
+				job->eof = 1;
+				job->failed |= ferror(job->file) != 0;
+			}
+		}
+
+		size_t i = length;
+		while (i > scanned && worker->buffer[i - 1] != '\n') {
+			i--;
+		}
+		if (i > scanned || job->eof) {
+			cut = i > scanned ? i : length;
+			break;
+		}
+
+		// A line longer than the buffer
+		scanned = length;
+		if (!reserve_buffer(&worker->buffer, &worker->capacity, worker->capacity + 1)) {
+			job->stop = job->failed = 1;
+			return 0;
+		}
+	}
+
+	job->carry_length = 0;
+	if (cut < length) {
+		if (!reserve_buffer(&job->carry, &job->carry_capacity, length - cut)) {
+			job->stop = job->failed = 1;
+			return 0;
+		}
+		memcpy(job->carry, worker->buffer + cut, length - cut);
+		job->carry_length = length - cut;
+	}
+
+	worker->length = cut;
+	worker->chunk = job->next_chunk++;
+	worker->first_line = job->next_line;
+	for (const char* p = worker->buffer; (p = memchr(p, '\n', worker->buffer + cut - p)) != NULL; p++) {
+		job->next_line++;
+	}
+	return cut > 0;
+}
+
+static int is_blank(const char* start, const char* end)
+{
+	for (; start < end; start++) {
+		if (json_char_class[(unsigned char)*start] != JSON_CLASS_WHITESPACE) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int push_record(json_lines_worker_t* worker, size_t line, json_value_t* value)
+{
+	if (worker->record_count == worker->record_capacity) {
+		size_t new_capacity = worker->record_capacity ? worker->record_capacity * 2 : 1024;
+		json_line_record_t* new_records = realloc(worker->records, sizeof(json_line_record_t) * new_capacity);
+		if (!new_records) {
+			return 0;
+		}
+		worker->records = new_records;
+		worker->record_capacity = new_capacity;
+	}
+
+	worker->records[worker->record_count].line = line;
+	worker->records[worker->record_count].value = value;
+	worker->record_count++;
+	return 1;
+}
+
+static void reset_document(json_document_t* doc)
+{
+	arena_reset(&doc->arena);
+	doc->stack_size = 0;
+}
+
+static int parse_chunk(json_lines_worker_t* worker)
+{
+	json_lines_job_t* job = worker->job;
+	const char* p = worker->buffer;
+	const char* end = worker->buffer + worker->length;
+	size_t line = worker->first_line;
+
+	worker->record_count = 0;
+	for (; p < end; line++) {
+		const char* newline = memchr(p, '\n', (size_t)(end - p));
+		const char* line_end = newline ? newline : end;
+
+		// Invalid lines are reported as NULL records
+		if (!is_blank(p, line_end)) {
+			json_value_t* value = parse_root(&worker->doc, p, (size_t)(line_end - p), NULL);
+			if (job->order == JSON_LINES_ORDERED) {
+				if (!push_record(worker, line, value)) {
+					worker->failed = 1;
+					return 0;
+				}
+			}
+			else {
+				if (!job->callback(job->ctx, line, value)) {
+					return 0;
+				}
+				reset_document(&worker->doc);
+			}
+		}
+
+		p = newline ? newline + 1 : end;
+	}
+	return 1;
+}
+
+// Waits for the turn of the chunk and hands its records over. The turn is
+// passed on even when there is nothing to deliver, so no worker waits forever.
+static int deliver_chunk(json_lines_worker_t* worker, int deliver)
+{
+	json_lines_job_t* job = worker->job;
+	int ok = deliver;
+
+	mutex_lock(&job->order_lock);
+	while (job->next_delivery != worker->chunk && !job->order_stop) {
+		cond_wait(&job->order_cond, &job->order_lock);
+	}
+
+	if (deliver && !job->order_stop) {
+		for (size_t i = 0; i < worker->record_count && ok; i++) {
+			ok = job->callback(job->ctx, worker->records[i].line, worker->records[i].value);
+		}
+	}
+
+	job->next_delivery++;
+	cond_broadcast(&job->order_cond);
+	mutex_unlock(&job->order_lock);
+	return ok;
+}
+
+static void lines_worker(void* arg)
+{
+	json_lines_worker_t* worker = arg;
+	json_lines_job_t* job = worker->job;
+
+	for (;;) {
+		mutex_lock(&job->lock);
+		int have_chunk = read_chunk(job, worker);
+		mutex_unlock(&job->lock);
+		if (!have_chunk) {
+			break;
+		}
+
+		int ok = parse_chunk(worker);
+		if (job->order == JSON_LINES_ORDERED) {
+			ok = deliver_chunk(worker, ok);
+		}
+		reset_document(&worker->doc);
+
+		if (!ok) {
+			// A callback returning 0 is a plain stop, not a failure
+			job_stop(job, worker->failed);
+			break;
+		}
+	}
+}
+
+int parse_lines_parallel(const char* path, size_t nthreads, json_line_callback_t callback,
+	void* ctx, json_lines_order_t order)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		return 0;
+	}
+
+	if (nthreads == 0) {
+		nthreads = thread_hardware_concurrency();
+	}
+	if (nthreads > JSON_LINES_MAX_THREADS) {
+		nthreads = JSON_LINES_MAX_THREADS;
+	}
+
+	json_lines_worker_t* workers = calloc(nthreads, sizeof(json_lines_worker_t));
+	json_thread_t* threads = calloc(nthreads, sizeof(json_thread_t));
+	if (!workers || !threads) {
+		free(workers);
+		free(threads);
+		fclose(file);
+		return 0;
+	}
+
+	json_lines_job_t job;
+	memset(&job, 0, sizeof(job));
+	job.callback = callback;
+	job.ctx = ctx;
+	job.order = order;
+	job.file = file;
+	job.next_line = 1;
+	mutex_init(&job.lock);
+	mutex_init(&job.order_lock);
+	cond_init(&job.order_cond);
+
+	for (size_t i = 0; i < nthreads; i++) {
+		workers[i].job = &job;
+		document_init(&workers[i].doc);
+	}
+
+	// The calling thread works as well, so one thread means no extra thread
+	size_t started = 1;
+	for (; started < nthreads; started++) {
+		if (!thread_create(&threads[started], lines_worker, &workers[started])) {
+			break;
+		}
+	}
+	lines_worker(&workers[0]);
+	for (size_t i = 1; i < started; i++) {
+		thread_join(threads[i]);
+	}
+
+	int result = !job.stop && !job.failed;
+
+	for (size_t i = 0; i < nthreads; i++) {
+		document_release(&workers[i].doc);
+		free(workers[i].buffer);
+		free(workers[i].records);
+	}
+	free(workers);
+	free(threads);
+	free(job.carry);
+	cond_destroy(&job.order_cond);
+	mutex_destroy(&job.order_lock);
+	mutex_destroy(&job.lock);
+	fclose(file);
+	return result;
+}
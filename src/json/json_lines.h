@@ -0,0 +1,13 @@
+﻿#ifndef MULTIFORMAT_JSON_LINES_H
+#define MULTIFORMAT_JSON_LINES_H
+
+#include "../core/data_types.h"
+
+// Lines are handed to workers in chunks of about this size, cut after a newline
+#define JSON_LINES_CHUNK_SIZE (1024 * 1024)
+#define JSON_LINES_MAX_THREADS 256
+
+int parse_lines_parallel(const char* path, size_t nthreads, json_line_callback_t callback,
+	void* ctx, json_lines_order_t order);
+
+#endif // MULTIFORMAT_JSON_LINES_H
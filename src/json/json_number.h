@@ -0,0 +1,23 @@
+﻿#ifndef MULTIFORMAT_JSON_NUMBER_H
+#define MULTIFORMAT_JSON_NUMBER_H
+
+#include "../core/data_types.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Range of decimal exponents covered by the 128-bit power-of-five table
+#define JSON_NUMBER_MIN_EXPONENT (-342)
+#define JSON_NUMBER_MAX_EXPONENT 308
+
+// Longest text format_json_number() and format_double() write
+#define JSON_NUMBER_MAX_CHARS 32
+
+size_t parse_json_number(const char* json, size_t len, json_number_t* number);
+
+// Write a short text that parses back to the same number, without a
+// terminating null, and return its length. Doubles are usually, but not
+// always, written in their shortest form. Infinities and NaN become null.
+size_t format_json_number(const json_number_t* number, char* out);
+size_t format_double(double value, char* out);
+
+#endif // MULTIFORMAT_JSON_NUMBER_H
@@ -0,0 +1,124 @@
+﻿#include "json_ondemand.h"
+#include "json_parser.h"
+
+int od_index_input(json_od_parser_t* parser, const char* json, size_t len)
+{
+	parser->json = json;
+	parser->len = len;
+	arena_reset(&parser->strings);
+	return build_structural_index(json, len, &parser->index);
+}
+
+// Index of the token following the value that starts at token, or
+// JSON_OD_INVALID if the value is truncated or its brackets do not match
+size_t od_skip_value(const json_od_parser_t* parser, size_t token)
+{
+	char c = od_token_char(parser, token);
+
+	if (c == '"') {
+		return token + 2;
+	}
+	if (c != '[' && c != '{') {
+		if (c == '\0' || json_char_class[(unsigned char)c] == JSON_CLASS_OP) {
+			return JSON_OD_INVALID;
+		}
+		return token + 1;
+	}
+
+	// Only brackets change the depth, string quotes come in pairs
+	size_t depth = 0;
+	const uint32_t* positions = parser->index.positions;
+	for (size_t i = token; i < parser->index.count; i++) {
+		switch (parser->json[positions[i]]) {
+		case '[':
+		case '{':
+			depth++;
+			break;
+		case ']':
+		case '}':
+			if (--depth == 0) {
+				return i + 1;
+			}
+			break;
+		case '"':
+			i++;
+			break;
+		default:
+			break;
+		}
+	}
+	return JSON_OD_INVALID;
+}
+
+int od_match_key(json_od_parser_t* parser, size_t token, const char* key, size_t key_length)
+{
+	size_t start = od_token_pos(parser, token) + 1;
+	size_t raw_length = od_token_pos(parser, token + 1) - start;
+	const char* raw = parser->json + start;
+
+	if (!memchr(raw, '\\', raw_length)) {
+		return raw_length == key_length && memcmp(raw, key, key_length) == 0;
+	}
+
+	// Escaped keys decode to at most their raw length
+	if (key_length > raw_length) {
+		return 0;
+	}
+
+	size_t length;
+	const char* decoded = od_read_string(parser, token, &length);
+	return decoded && length == key_length && memcmp(decoded, key, key_length) == 0;
+}
+
+const char* od_read_string(json_od_parser_t* parser, size_t token, size_t* length)
+{
+	if (od_token_char(parser, token) != '"') {
+		return NULL;
+	}
+
+	size_t start = od_token_pos(parser, token) + 1;
+	size_t raw_length = od_token_pos(parser, token + 1) - start;
+
+	char* string = arena_alloc(&parser->strings, raw_length + 1);
+	if (!string) {
+		return NULL;
+	}
+
+	size_t decoded = unescape_string(string, parser->json + start, raw_length);
+	if (decoded == JSON_INVALID_ESCAPE) {
+		return NULL;
+	}
+
+	string[decoded] = '\0';
+	if (length) *length = decoded;
+	return string;
+}
+
+static int od_at_value_end(const json_od_parser_t* parser, size_t pos)
+{
+	return pos >= parser->len || json_char_class[(unsigned char)parser->json[pos]] != 0;
+}
+
+int od_read_number(const json_od_parser_t* parser, size_t token, json_number_t* number)
+{
+	char c = od_token_char(parser, token);
+	if (c != '-' && (c < '0' || c > '9')) {
+		return 0;
+	}
+
+	size_t pos = od_token_pos(parser, token);
+	size_t consumed = parse_json_number(parser->json + pos, parser->len - pos, number);
+	return consumed > 0 && od_at_value_end(parser, pos + consumed);
+}
+
+int od_read_literal(const json_od_parser_t* parser, size_t token, const char* literal, size_t length)
+{
+	if (token >= parser->index.count) {
+		return 0;
+	}
+
+	size_t pos = od_token_pos(parser, token);
+	return pos + length <= parser->len &&
+		memcmp(parser->json + pos, literal, length) == 0 &&
+		od_at_value_end(parser, pos + length);
+}
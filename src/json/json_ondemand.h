@@ -0,0 +1,41 @@
+﻿#ifndef MULTIFORMAT_JSON_ONDEMAND_H
+#define MULTIFORMAT_JSON_ONDEMAND_H
+
+#include "../core/data_types.h"
+#include "json_arena.h"
+#include "json_number.h"
+#include "json_stage1.h"
+
+// Cursor state shared by every json_od_value_t of one input. Values are
+// positions in the structural index; nothing is materialized until read.
+struct json_od_parser {
+	const char* json;
+	size_t len;
+	json_structural_index_t index;
+	// Decoded strings handed out since the last json_od_iterate()
+	json_arena_t strings;
+};
+
+#define JSON_OD_INVALID ((size_t)-1)
+
+int od_index_input(json_od_parser_t* parser, const char* json, size_t len);
+size_t od_skip_value(const json_od_parser_t* parser, size_t token);
+int od_match_key(json_od_parser_t* parser, size_t token, const char* key, size_t key_length);
+const char* od_read_string(json_od_parser_t* parser, size_t token, size_t* length);
+int od_read_number(const json_od_parser_t* parser, size_t token, json_number_t* number);
+int od_read_literal(const json_od_parser_t* parser, size_t token, const char* literal, size_t length);
+
+static inline char od_token_char(const json_od_parser_t* parser, size_t token)
+{
+	if (token >= parser->index.count) {
+		return '\0';
+	}
+	return parser->json[parser->index.positions[token]];
+}
+
+static inline size_t od_token_pos(const json_od_parser_t* parser, size_t token)
+{
+	return parser->index.positions[token];
+}
+
+#endif // MULTIFORMAT_JSON_ONDEMAND_H
@@ -0,0 +1,289 @@
+﻿#include "json_parallel.h"
+#include "json_thread.h"
+
+typedef struct {
+	size_t start;
+	size_t end;
+	json_value_t* elements;
+}json_element_range_t;
+
+typedef struct {
+	json_element_range_t* items;
+	size_t count;
+	size_t capacity;
+}json_range_list_t;
+
+typedef struct {
+	const char* json;
+	json_range_list_t* ranges;
+	json_mutex_t lock;
+	size_t next_range;
+	int failed;
+}json_parallel_job_t;
+
+typedef struct {
+	json_parallel_job_t* job;
+	json_document_t doc;
+}json_parallel_worker_t;
+
+static int range_list_push(json_range_list_t* list, size_t start, size_t end)
+{
+	if (list->count == list->capacity) {
+		size_t new_capacity = list->capacity ? list->capacity * 2 : 64;
+		json_element_range_t* new_items = realloc(list->items, sizeof(json_element_range_t) * new_capacity);
+		if (!new_items) {
+			return 0;
+		}
+		list->items = new_items;
+		list->capacity = new_capacity;
+	}
+
+	list->items[list->count].start = start;
+	list->items[list->count].end = end;
+	list->items[list->count].elements = NULL;
+	list->count++;
+	return 1;
+}
+
+typedef struct {
+	const char* json;
+	size_t len;
+	size_t target;
+	json_range_list_t* ranges;
+	size_t depth;
+	size_t range_start;
+	// Position of the bracket closing the top-level array, 0 until found
+	size_t end;
+}json_split_state_t;
+
+// Returns 0 to stop: at the end of the array, on malformed nesting and on
+// allocation failure (told apart by the caller)
+static int split_structurals(json_split_state_t* split, size_t base, uint64_t bits)
+{
+	while (bits) {
+		size_t pos = base + (size_t)stage1_trailing_zeros(bits);
+		bits &= bits - 1;
+		if (pos >= split->len) {
+			return 1;
+		}
+
+		switch (split->json[pos]) {
+		case '[':
+		case '{':
+			if (split->depth++ == 0) {
+				if (split->json[pos] != '[') {
+					return 0;
+				}
+				split->range_start = pos + 1;
+			}
+			break;
+		case ']':
+		case '}':
+			if (split->depth == 0) {
+				return 0;
+			}
+			if (--split->depth == 0) {
+				split->end = pos;
+				return 0;
+			}
+			break;
+		case ',':
+			if (split->depth == 1 && pos - split->range_start >= split->target) {
+				if (!range_list_push(split->ranges, split->range_start, pos)) {
+					return 0;
+				}
+				split->range_start = pos + 1;
+			}
+			break;
+		default:
+			// A scalar outside the array means the input is not an array
+			if (split->depth == 0) {
+				return 0;
+			}
+			break;
+		}
+	}
+	return 1;
+}
+
+static int is_whitespace_tail(const char* p, const char* end)
+{
+	for (; p < end; p++) {
+		if (json_char_class[(unsigned char)*p] != JSON_CLASS_WHITESPACE) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Structural pre-pass over the whole input: tracks the nesting depth with
+// the stage 1 masks and cuts the top-level array at commas into ranges of
+// about target bytes. Nothing is stored per structural, so inputs beyond
+// the 4 GB limit of the structural index are fine.
+static int split_array(const char* json, size_t len, size_t target, json_range_list_t* ranges)
+{
+	json_split_state_t split = { json, len, target, ranges, 0, 0, 0 };
+	json_stage1_state_t state;
+	json_block_masks_t masks;
+	size_t pos = 0;
+	int more = 1;
+
+	stage1_state_init(&state);
+	for (; more && pos + JSON_STAGE1_BLOCK_SIZE <= len; pos += JSON_STAGE1_BLOCK_SIZE) {
+		stage1_classify_block((const uint8_t*)json + pos, &masks);
+		more = split_structurals(&split, pos, stage1_structurals(&masks, &state));
+	}
+
+	if (more && pos < len) {
+		uint8_t tail[JSON_STAGE1_BLOCK_SIZE];
+		memset(tail, ' ', sizeof(tail));
+		memcpy(tail, json + pos, len - pos);
+		stage1_classify_block(tail, &masks);
+		split_structurals(&split, pos, stage1_structurals(&masks, &state));
+	}
+
+	if (split.end == 0 || !is_whitespace_tail(json + split.end + 1, json + len)) {
+		return 0;
+	}
+	return range_list_push(ranges, split.range_start, split.end);
+}
+
+static void parallel_worker(void* arg)
+{
+	json_parallel_worker_t* worker = arg;
+	json_parallel_job_t* job = worker->job;
+
+	for (;;) {
+		mutex_lock(&job->lock);
+		size_t index = job->next_range++;
+		int stop = job->failed || index >= job->ranges->count;
+		mutex_unlock(&job->lock);
+		if (stop) {
+			break;
+		}
+
+		// Ranges of one worker share its arena; parse_root_elements()
+		// does not reset it
+		json_element_range_t* range = &job->ranges->items[index];
+		range->elements = parse_root_elements(&worker->doc, job->json + range->start, range->end - range->start,
+			range->start);
+		if (!range->elements) {
+			mutex_lock(&job->lock);
+			job->failed = 1;
+			mutex_unlock(&job->lock);
+			break;
+		}
+	}
+}
+
+// Concatenates the elements of every range into one array owned by doc
+static json_value_t* stitch_ranges(json_document_t* doc, const json_range_list_t* ranges)
+{
+	size_t total = 0;
+	for (size_t i = 0; i < ranges->count; i++) {
+		total += ranges->items[i].elements->data.array->count;
+	}
+
+	json_value_t* array = arena_alloc(&doc->arena, sizeof(json_value_t));
+	if (!array) {
+		return NULL;
+	}
+	value_init(array, JSON_ARRAY);
+
+	json_value_t** values = value_make_array(&doc->arena, array, total);
+	if (!values) {
+		return NULL;
+	}
+
+	size_t count = 0;
+	for (size_t i = 0; i < ranges->count; i++) {
+		const json_array_t* elements = ranges->items[i].elements->data.array;
+		memcpy(values + count, elements->values, sizeof(json_value_t*) * elements->count);
+		count += elements->count;
+	}
+
+	return array;
+}
+
+static json_value_t* parse_serial(json_document_t* doc, const char* json, size_t len)
+{
+	arena_reserve(&doc->arena, len * 2);
+	return parse_root(doc, json, len, NULL);
+}
+
+json_value_t* parse_parallel(json_document_t* doc, const char* json, size_t len, size_t nthreads)
+{
+	if (nthreads == 0) {
+		nthreads = thread_hardware_concurrency();
+	}
+	if (nthreads > JSON_PARALLEL_MAX_THREADS) {
+		nthreads = JSON_PARALLEL_MAX_THREADS;
+	}
+
+	size_t target = len / (nthreads * JSON_PARALLEL_RANGES_PER_THREAD);
+	if (target < JSON_PARALLEL_MIN_RANGE) {
+		target = JSON_PARALLEL_MIN_RANGE;
+	}
+
+	// Malformed input is left to the serial parser, which reports the error
+	json_range_list_t ranges = { NULL, 0, 0 };
+	if (nthreads < 2 || !split_array(json, len, target, &ranges) || ranges.count < 2) {
+		free(ranges.items);
+		return parse_serial(doc, json, len);
+	}
+
+	if (nthreads > ranges.count) {
+		nthreads = ranges.count;
+	}
+
+	json_parallel_worker_t* workers = calloc(nthreads, sizeof(json_parallel_worker_t));
+	json_thread_t* threads = calloc(nthreads, sizeof(json_thread_t));
+	if (!workers || !threads) {
+		free(workers);
+		free(threads);
+		free(ranges.items);
+		return NULL;
+	}
+
+	json_parallel_job_t job;
+	job.json = json;
+	job.ranges = &ranges;
+	job.next_range = 0;
+	job.failed = 0;
+	mutex_init(&job.lock);
+
+	for (size_t i = 0; i < nthreads; i++) {
+		workers[i].job = &job;
+		document_init(&workers[i].doc);
+		arena_reserve(&workers[i].doc.arena, target * 2);
+	}
+
+	// The calling thread works as well
+	size_t started = 1;
+	for (; started < nthreads; started++) {
+		if (!thread_create(&threads[started], parallel_worker, &workers[started])) {
+			break;
+		}
+	}
+	parallel_worker(&workers[0]);
+	for (size_t i = 1; i < started; i++) {
+		thread_join(threads[i]);
+	}
+
+	json_value_t* result = job.failed ? NULL : stitch_ranges(doc, &ranges);
+
+	// The elements stay where the workers parsed them: their arenas are
+	// handed over to the document as a whole
+	for (size_t i = 0; i < nthreads; i++) {
+		if (result) {
+			arena_adopt(&doc->arena, &workers[i].doc.arena);
+		}
+		document_release(&workers[i].doc);
+	}
+
+	free(workers);
+	free(threads);
+	free(ranges.items);
+	mutex_destroy(&job.lock);
+	return result;
+}
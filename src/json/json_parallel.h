@@ -0,0 +1,16 @@
+﻿#ifndef MULTIFORMAT_JSON_PARALLEL_H
+#define MULTIFORMAT_JSON_PARALLEL_H
+
+#include "json_parser.h"
+
+// A top-level array is cut into element ranges of at least this size,
+// about this many per thread so that uneven ranges balance out
+#define JSON_PARALLEL_MIN_RANGE (256 * 1024)
+#define JSON_PARALLEL_RANGES_PER_THREAD 4
+#define JSON_PARALLEL_MAX_THREADS 256
+
+// Parses json into doc, splitting a top-level array across threads; other
+// inputs, and arrays too small to split, are parsed on the calling thread
+json_value_t* parse_parallel(json_document_t* doc, const char* json, size_t len, size_t nthreads);
+
+#endif // MULTIFORMAT_JSON_PARALLEL_H
@@ -1,40 +1,72 @@
 ﻿#include "json_parser.h"
 
-void skip_whitespace(json_parser_t* parser) {
-	while (parser->pos < parser->len && isspace(parser->json[parser->pos])) {
-		parser->pos++;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_PARSER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void set_error(json_parser_t* parser, const char* message) {
+	if (parser->error == NULL) {
+		parser->error = malloc(256);
+		snprintf(parser->error, 256, "%s at position %zu", message, parser->offset + parser->pos);
 	}
 }
 
-int is_eof(json_parser_t* parser) {
-	return parser->pos >= parser->len;
+void document_init(json_document_t* doc) {
+	value_init(&doc->root, JSON_NULL);
+	doc->has_root = 0;
+	arena_init(&doc->arena);
+	doc->stack = NULL;
+	doc->stack_size = 0;
+	doc->stack_capacity = 0;
+	doc->frames = NULL;
+	doc->frame_capacity = 0;
+	doc->max_depth = JSON_DEFAULT_MAX_DEPTH;
+	doc->index.positions = NULL;
+	doc->index.count = 0;
+	doc->index.capacity = 0;
+	doc->index.has_backslash = 0;
+	doc->key_pool = NULL;
 }
 
-char current_char(json_parser_t* parser) {
-	return parser->json[parser->pos];
+void document_release(json_document_t* doc) {
+	arena_free(&doc->arena);
+	pool_free(doc->stack, sizeof(struct json_object_entry) * doc->stack_capacity);
+	doc->stack = NULL;
+	doc->stack_size = 0;
+	doc->stack_capacity = 0;
+	pool_free(doc->frames, sizeof(json_parse_frame_t) * doc->frame_capacity);
+	doc->frames = NULL;
+	doc->frame_capacity = 0;
+	structural_index_free(&doc->index);
 }
 
-char next_char(json_parser_t* parser) {
-	if (parser->pos < parser->len) {
-		return parser->json[parser->pos++];
+json_value_t* create_value(json_parser_t* parser, json_type_t type) {
+	json_value_t* value = arena_alloc(&parser->doc->arena, sizeof(json_value_t));
+	if (value) {
+		value_init(value, type);
 	}
-	return '\0';
+	return value;
 }
 
-void set_error(json_parser_t* parser, const char* message) {
-	if (parser->error == NULL) {
-		parser->error = malloc(256);
-		snprintf(parser->error, 256, "%s at position %zu", message, parser->pos);
+int parser_push_entry(json_parser_t* parser, char* key, json_value_t* value) {
+	json_document_t* doc = parser->doc;
+	if (doc->stack_size >= doc->stack_capacity) {
+		size_t new_capacity = doc->stack_capacity ? doc->stack_capacity * 2 : JSON_PARSE_STACK_INIT_SIZE;
+		struct json_object_entry* new_stack = pool_realloc(doc->stack,
+			sizeof(struct json_object_entry) * doc->stack_capacity, sizeof(struct json_object_entry) * new_capacity);
+		if (!new_stack) {
+			set_error(parser, "Out of memory");
+			return 0;
+		}
+		doc->stack = new_stack;
+		doc->stack_capacity = new_capacity;
 	}
-}
 
-json_value_t* create_value(json_type_t type) {
-	json_value_t* value = malloc(sizeof(json_value_t));
-	if (value) {
-		value->type = type;
-		memset(&value->data, 0, sizeof(value->data));
-	}
-	return value;
+	doc->stack[doc->stack_size].key = key;
+	doc->stack[doc->stack_size].value = value;
+	doc->stack_size++;
+	return 1;
 }
 
 json_value_t* parse_null(json_parser_t* parser) {
@@ -44,7 +76,9 @@ json_value_t* parse_null(json_parser_t* parser) {
 		parser->json[parser->pos + 2] == 'l' &&
 		parser->json[parser->pos + 3] == 'l') {
 		parser->pos += 4;
-		return create_value(JSON_NULL);
+		if (at_value_end(parser)) {
+			return create_value(parser, JSON_NULL);
+		}
 	}
 	set_error(parser, "Expected 'null'");
 	return NULL;
@@ -57,21 +91,24 @@ json_value_t* parse_boolean(json_parser_t* parser) {
 		parser->json[parser->pos + 2] == 'u' &&
 		parser->json[parser->pos + 3] == 'e') {
 		parser->pos += 4;
-		json_value_t* value = create_value(JSON_BOOL);
-		if (value) value->data.boolean = 1;
-		return value;
+		if (at_value_end(parser)) {
+			json_value_t* value = create_value(parser, JSON_BOOL);
+			if (value) value->data.boolean = 1;
+			return value;
+		}
 	}
-
-	if (parser->pos + 4 < parser->len &&
+	else if (parser->pos + 4 < parser->len &&
 		parser->json[parser->pos] == 'f' &&
 		parser->json[parser->pos + 1] == 'a' &&
 		parser->json[parser->pos + 2] == 'l' &&
 		parser->json[parser->pos + 3] == 's' &&
 		parser->json[parser->pos + 4] == 'e') {
 		parser->pos += 5;
-		json_value_t* value = create_value(JSON_BOOL);
-		if (value) value->data.boolean = 0;
-		return value;
+		if (at_value_end(parser)) {
+			json_value_t* value = create_value(parser, JSON_BOOL);
+			if (value) value->data.boolean = 0;
+			return value;
+		}
 	}
 
 	set_error(parser, "Expected 'true' or 'false'");
@@ -79,253 +116,701 @@ json_value_t* parse_boolean(json_parser_t* parser) {
 }
 
 json_value_t* parse_number(json_parser_t* parser) {
-	char* endptr;
-	const char* start = parser->json + parser->pos;
-	double number = strtod(start, &endptr);
+	json_value_t* value = create_value(parser, JSON_NUMBER);
+	if (!value) return NULL;
 
-	if (endptr == start) {
+	json_number_t number;
+	size_t consumed = parse_json_number(parser->json + parser->pos, parser->len - parser->pos, &number);
+	if (consumed == 0) {
 		set_error(parser, "Expected number");
 		return NULL;
 	}
 
-	parser->pos += (endptr - start);
-	json_value_t* value = create_value(JSON_NUMBER);
-	if (value)value->data.number = number;
+	parser->pos += consumed;
+	if (!at_value_end(parser)) {
+		set_error(parser, "Invalid number");
+		return NULL;
+	}
 
+	value_set_number(value, &number);
 	return value;
 }
 
-json_value_t* parse_string(json_parser_t* parser) {
+static int hex_digit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+static long read_hex4(const char* src) {
+	long code = 0;
+	for (int i = 0; i < 4; i++) {
+		int digit = hex_digit(src[i]);
+		if (digit < 0) return -1;
+		code = (code << 4) | digit;
+	}
+	return code;
+}
+
+static size_t encode_utf8(char* dst, unsigned long code) {
+	if (code < 0x80) {
+		dst[0] = (char)code;
+		return 1;
+	}
+	if (code < 0x800) {
+		dst[0] = (char)(0xC0 | (code >> 6));
+		dst[1] = (char)(0x80 | (code & 0x3F));
+		return 2;
+	}
+	if (code < 0x10000) {
+		dst[0] = (char)(0xE0 | (code >> 12));
+		dst[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+		dst[2] = (char)(0x80 | (code & 0x3F));
+		return 3;
+	}
+	dst[0] = (char)(0xF0 | (code >> 18));
+	dst[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+	dst[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+	dst[3] = (char)(0x80 | (code & 0x3F));
+	return 4;
+}
+
+size_t string_run_length(const char* src, size_t length) {
+	size_t i = 0;
+#ifdef JSON_PARSER_SSE2
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	for (; i + 16 <= length; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(src + i));
+		unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+			_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+		if (mask) {
+			return i + (size_t)stage1_trailing_zeros(mask);
+		}
+	}
+#endif
+	while (i < length && src[i] != '"' && src[i] != '\\') {
+		i++;
+	}
+	return i;
+}
+
+size_t unescape_string(char* dst, const char* src, size_t length) {
+	size_t in = 0;
+	size_t out = 0;
+
+	while (in < length) {
+		// Runs without escapes are copied in bulk, and not at all while
+		// decoding in place has not shifted anything yet
+		size_t run = string_run_length(src + in, length - in);
+		if (dst + out != src + in) {
+			memmove(dst + out, src + in, run);
+		}
+		in += run;
+		out += run;
+		if (in >= length) break;
+
+		if (src[in] != '\\') {
+			dst[out++] = src[in++];
+			continue;
+		}
+
+		if (in + 1 >= length) return JSON_INVALID_ESCAPE;
+
+		switch (src[in + 1]) {
+		case '"':  dst[out++] = '"';  break;
+		case '\\': dst[out++] = '\\'; break;
+		case '/':  dst[out++] = '/';  break;
+		case 'b':  dst[out++] = '\b'; break;
+		case 'f':  dst[out++] = '\f'; break;
+		case 'n':  dst[out++] = '\n'; break;
+		case 'r':  dst[out++] = '\r'; break;
+		case 't':  dst[out++] = '\t'; break;
+		case 'u': {
+			if (in + 6 > length) return JSON_INVALID_ESCAPE;
+			long code = read_hex4(src + in + 2);
+			if (code < 0 || (code >= 0xDC00 && code <= 0xDFFF)) return JSON_INVALID_ESCAPE;
+
+			if (code >= 0xD800 && code <= 0xDBFF) {
+				// A high surrogate must be followed by an escaped low one
+				if (in + 12 > length || src[in + 6] != '\\' || src[in + 7] != 'u') {
+					return JSON_INVALID_ESCAPE;
+				}
+				long low = read_hex4(src + in + 8);
+				if (low < 0xDC00 || low > 0xDFFF) return JSON_INVALID_ESCAPE;
+
+				code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				in += 6;
+			}
+
+			out += encode_utf8(dst + out, (unsigned long)code);
+			in += 6;
+			continue;
+		}
+		default:
+			return JSON_INVALID_ESCAPE;
+		}
+		in += 2;
+	}
+
+	return out;
+}
+
+static char* intern_key(json_parser_t* parser, const char* key, size_t length) {
+	const char* interned = key_pool_intern(parser->doc->key_pool, key, length);
+	if (!interned) {
+		set_error(parser, "Out of memory");
+	}
+	return (char*)interned;
+}
+
+static char* store_string(json_parser_t* parser, size_t start, size_t length, int is_key) {
+	int intern = is_key && parser->doc->key_pool;
+	const char* raw = parser->json + start;
+	char* string;
+
+	if (!has_escapes(parser, raw, length)) {
+		if (!parser->insitu) {
+			if (intern) {
+				return intern_key(parser, raw, length);
+			}
+			return arena_strndup(&parser->doc->arena, raw, length);
+		}
+		string = parser->insitu + start;
+	}
+	else {
+		// Decoding never grows a string, so in-situ strings are decoded over
+		// their source bytes and others into an arena copy of the raw size
+		string = parser->insitu ? parser->insitu + start : arena_alloc(&parser->doc->arena, length + 1);
+		if (!string) {
+			set_error(parser, "Out of memory");
+			return NULL;
+		}
+		length = unescape_string(string, raw, length);
+		if (length == JSON_INVALID_ESCAPE) {
+			set_error(parser, "Invalid escape sequence");
+			return NULL;
+		}
+	}
+	string[length] = '\0';
+	return intern ? intern_key(parser, string, length) : string;
+}
+
+// Moves past a string and reports where its raw contents start and end
+static int scan_string(json_parser_t* parser, size_t* start, size_t* length) {
 	if (current_char(parser) != '"') {
 		set_error(parser, "Expected string");
-		return NULL;
+		return 0;
 	}
 
 	parser->pos++;
 
-	size_t start = parser->pos;
+	*start = parser->pos;
 
-	while (parser->pos < parser->len && current_char(parser) != '"') {
-		if (current_char(parser) == '\\')parser->pos++; 
+	if (parser->structurals) {
+		// Stage 1 indexes the closing quote right after the opening one
+		parser->pos = parser->structurals[parser->next_structural + 1];
+		parser->next_structural += 2;
+		*length = parser->pos - *start;
 		parser->pos++;
+		return 1;
+	}
+
+	while (parser->pos < parser->len) {
+		parser->pos += string_run_length(parser->json + parser->pos, parser->len - parser->pos);
+		if (parser->pos >= parser->len || current_char(parser) == '"') break;
+		// Skip the backslash together with the byte it escapes
+		parser->pos += 2;
 	}
 
 	if (parser->pos >= parser->len) {
 		set_error(parser, "Untermitated string");
-		return NULL;
+		return 0;
 	}
 
-	size_t length = parser->pos - start;
+	*length = parser->pos - *start;
 	parser->pos++;
+	return 1;
+}
 
-	json_value_t* value = create_value(JSON_STRING);
-
-	if (!value)return NULL;
-
-	value->data.string = malloc(length + 1);
-	if (!value->data.string) {
-		free(value);
+char* parse_string_data(json_parser_t* parser, int is_key) {
+	size_t start, length;
+	if (!scan_string(parser, &start, &length)) {
 		return NULL;
 	}
-
-	strncpy(value->data.string, parser->json + start, length);
-	value->data.string[length] = '\0';
-	
-	return value;
+	return store_string(parser, start, length, is_key);
 }
 
-json_value_t* parse_array(json_parser_t* parser) {
-	if (current_char(parser) != '[') {
-		set_error(parser, "Expected array");
+json_value_t* parse_string(json_parser_t* parser) {
+	size_t start, length;
+	if (!scan_string(parser, &start, &length)) {
 		return NULL;
 	}
 
-	parser->pos++;
-	skip_whitespace(parser);
+	json_value_t* value = create_value(parser, JSON_STRING);
+	if (!value) return NULL;
+
+	// Short strings go straight into the value; in-situ strings are left
+	// in the caller's buffer
+	if (!parser->insitu && length <= JSON_INLINE_STRING_MAX) {
+		const char* raw = parser->json + start;
+		char decoded[JSON_INLINE_STRING_MAX];
+		if (has_escapes(parser, raw, length)) {
+			length = unescape_string(decoded, raw, length);
+			if (length == JSON_INVALID_ESCAPE) {
+				set_error(parser, "Invalid escape sequence");
+				return NULL;
+			}
+			raw = decoded;
+		}
+		value_set_inline_string(value, raw, length);
+		return value;
+	}
 
-	json_value_t* array = create_value(JSON_ARRAY);
-	if (!array)return NULL;
+	char* string = store_string(parser, start, length, 0);
+	if (!string) return NULL;
 
-	array->data.array.capacity = 8;
-	array->data.array.values = malloc(sizeof(json_value_t*) * array->data.array.capacity);
-	array->data.array.count = 0;
+	value->data.string = string;
+	return value;
+}
 
-	if (!array->data.array.values) {
-		free(array);
-		return NULL;
+static int push_frame(json_parser_t* parser, json_value_t* container, size_t depth,
+	const json_projection_node_t* projection) {
+	json_document_t* doc = parser->doc;
+	if (depth >= doc->max_depth) {
+		set_error(parser, "Maximum nesting depth exceeded");
+		return 0;
 	}
 
-	if (current_char(parser) == ']') {
-		parser->pos++;
-		return array;
+	if (depth == doc->frame_capacity) {
+		size_t new_capacity = doc->frame_capacity ? doc->frame_capacity * 2 : JSON_PARSE_FRAMES_INIT_SIZE;
+		json_parse_frame_t* new_frames = pool_realloc(doc->frames,
+			sizeof(json_parse_frame_t) * doc->frame_capacity, sizeof(json_parse_frame_t) * new_capacity);
+		if (!new_frames) {
+			set_error(parser, "Out of memory");
+			return 0;
+		}
+		doc->frames = new_frames;
+		doc->frame_capacity = new_capacity;
 	}
 
-	while (!is_eof(parser)) {
-		skip_whitespace(parser);
-
-		json_value_t* element = parse_value(parser);
+	doc->frames[depth].container = container;
+	doc->frames[depth].base = doc->stack_size;
+	doc->frames[depth].projection = projection;
+	doc->frames[depth].index = 0;
+	return 1;
+}
 
-		if (!element) {
-			json_free(array);
-			return NULL;
+// Moves the children of a closed container into an exactly sized arena header
+static int close_frame(json_parser_t* parser, const json_parse_frame_t* frame) {
+	json_document_t* doc = parser->doc;
+	json_value_t* container = frame->container;
+	size_t count = doc->stack_size - frame->base;
+
+	if (value_type(container) == JSON_ARRAY) {
+		json_value_t** values = value_make_array(&doc->arena, container, count);
+		if (!values) {
+			set_error(parser, "Out of memory");
+			return 0;
 		}
 
-		if (array->data.array.count >= array->data.array.capacity) {
-			size_t new_capacity = array->data.array.capacity * 2;
-			json_value_t** new_values = realloc(array->data.array.values,
-				sizeof(json_value_t*) * new_capacity);
-			if (!new_values) {
-				json_free(element);
-				json_free(array);
-				return NULL;
-			}
-			array->data.array.values = new_values;
-			array->data.array.capacity = new_capacity;
+		for (size_t i = 0; i < count; i++) {
+			values[i] = doc->stack[frame->base + i].value;
 		}
-
-		array->data.array.values[array->data.array.count++] = element;
-
-		skip_whitespace(parser);
-
-		if (current_char(parser) == ']') {
-			parser->pos++;
-			break;
+	}
+	else {
+		struct json_object_entry* entries = value_make_object(&doc->arena, container, count);
+		if (!entries) {
+			set_error(parser, "Out of memory");
+			return 0;
 		}
 
-		if (current_char(parser) != ',') {
-			set_error(parser, "Expected ',' or ']'");
-			json_free(array);
-			return NULL;
+		// The stack is still unallocated when nothing has been pushed yet
+		if (count) {
+			memcpy(entries, doc->stack + frame->base, sizeof(struct json_object_entry) * count);
+		}
+		if (count >= JSON_OBJECT_INDEX_THRESHOLD) {
+			container->data.object->index = object_index_build(&doc->arena, entries, count, doc->key_pool != NULL);
 		}
-
-		parser->pos++;		
 	}
-	return array;
+
+	doc->stack_size = frame->base;
+	return 1;
 }
 
-json_value_t* parse_value(json_parser_t* parser) {
+// Moves past a member key and its colon, leaving the position on the value
+static int scan_member_key(json_parser_t* parser, size_t* start, size_t* length) {
 	skip_whitespace(parser);
 
-	if (is_eof(parser)) {
-		set_error(parser, "Unexpected end of input");
-		return NULL;
+	if (current_char(parser) != '"') {
+		set_error(parser, "Expected string key");
+		return 0;
 	}
 
-	char c = current_char(parser);
-
-	switch (c)
-	{
-	case 'n':return parse_null(parser);
-	case 't':
-	case 'f':return parse_boolean(parser);
-	case '"':return parse_string(parser);
-	case '[':return parse_array(parser);
-	case '{':return parse_object(parser);
-	default:
-		if (isdigit(c) || c == '-') {
-			return parse_number(parser);
-		}
-		set_error(parser, "Unexpected character");
-		return NULL;
+	if (!scan_string(parser, start, length)) {
+		return 0;
 	}
-}
 
-json_value_t* parse_object(json_parser_t* parser) {
-	if(current_char(parser) != '{'){
-		set_error(parser, "Expected Object");
-		return NULL;
+	skip_whitespace(parser);
+
+	if (current_char(parser) != ':') {
+		set_error(parser, "Expected ':' after key");
+		return 0;
 	}
 
 	parser->pos++;
+	return 1;
+}
+
+// Same as skip_value() walking the structural index directly
+static int skip_indexed_value(json_parser_t* parser) {
 	skip_whitespace(parser);
 
-	json_value_t* object = create_value(JSON_OBJECT);
-	if (!object) return NULL;
+	const uint32_t* next = parser->structurals + parser->next_structural;
+	size_t depth = 0;
 
-	object->data.object.capacity = 8;
-	object->data.object.entries = malloc(sizeof(struct json_object_entry) * object->data.object.capacity);
-	object->data.object.count = 0;
+	do {
+		if (*next >= parser->len) {
+			parser->pos = parser->len;
+			set_error(parser, "Unexpected end of input");
+			return 0;
+		}
 
-	if (!object->data.object.entries) {
-		free(object);
+		char c = parser->json[*next];
+		if (c == '"') {
+			// The closing quote is always the next entry
+			next++;
+		}
+		else if (c == '[' || c == '{') {
+			depth++;
+		}
+		else if (c == ']' || c == '}' || c == ',' || c == ':') {
+			if (depth == 0) {
+				parser->pos = *next;
+				set_error(parser, "Unexpected character");
+				return 0;
+			}
+			if (c == ']' || c == '}') {
+				depth--;
+			}
+		}
+		next++;
+	} while (depth > 0);
+
+	parser->next_structural = (size_t)(next - parser->structurals);
+	parser->pos = next[-1] + 1;
+	return 1;
+}
+
+// Parses a member key and its colon, leaving the position on the value
+static char* parse_member_key(json_parser_t* parser) {
+	size_t start, length;
+	if (!scan_member_key(parser, &start, &length)) {
 		return NULL;
 	}
+	return store_string(parser, start, length, 1);
+}
 
-	if (current_char(parser) == '}') {
-		parser->pos++;
-		return object;
+// Skips one value by matching brackets without decoding or allocating
+static int skip_value(json_parser_t* parser) {
+	if (parser->structurals) {
+		return skip_indexed_value(parser);
 	}
 
-	while (!is_eof(parser)) {
+	size_t depth = 0;
+
+	do {
 		skip_whitespace(parser);
+		if (is_eof(parser)) {
+			set_error(parser, "Unexpected end of input");
+			return 0;
+		}
 
-		if (current_char(parser) != '"') {
-			set_error(parser, "Expected string key");
-			json_free(object);
-			return NULL;
+		size_t start, length;
+		char c = current_char(parser);
+		switch (c)
+		{
+		case '"':
+			if (!scan_string(parser, &start, &length)) {
+				return 0;
+			}
+			break;
+		case '[':
+		case '{':
+			depth++;
+			parser->pos++;
+			break;
+		case ']':
+		case '}':
+		case ',':
+		case ':':
+			if (depth == 0) {
+				set_error(parser, "Unexpected character");
+				return 0;
+			}
+			if (c == ']' || c == '}') {
+				depth--;
+			}
+			parser->pos++;
+			break;
+		default:
+			// Scalars end at whitespace, a structural character or a quote
+			do {
+				parser->pos++;
+			} while (parser->pos < parser->len && json_char_class[(unsigned char)current_char(parser)] == 0 &&
+				current_char(parser) != '"');
+			break;
 		}
+	} while (depth > 0);
 
-		json_value_t* key_value = parse_string(parser);
-		if (!key_value) {
-			json_free(object);
-			return NULL;
+	return 1;
+}
+
+// Works out whether the next element of a container in a projected parse is
+// wanted: *skip is set when it is not, and *selection to the part of it that
+// is, NULL meaning all of it. Keys are only copied once they are known to be
+// wanted, unless they have to be decoded to be compared.
+static int begin_projected_element(json_parser_t* parser, json_parse_frame_t* frame, char** key,
+	const json_projection_node_t** selection, int* skip) {
+	const json_projection_node_t* node;
+	*key = NULL;
+
+	if (value_type(frame->container) != JSON_OBJECT) {
+		node = projection_find_index(frame->projection, frame->index++);
+	}
+	else {
+		size_t start, length;
+		if (!scan_member_key(parser, &start, &length)) {
+			return 0;
 		}
 
-		skip_whitespace(parser);
+		const char* raw = parser->json + start;
+		if (has_escapes(parser, raw, length)) {
+			if (!(*key = store_string(parser, start, length, 1))) {
+				return 0;
+			}
+			raw = *key;
+			length = strlen(*key);
+		}
+
+		node = projection_find_key(frame->projection, raw, length);
+		if (node && !*key && !(*key = store_string(parser, start, length, 1))) {
+			return 0;
+		}
+	}
+
+	*skip = node == NULL;
+	*selection = node && !node->whole ? node : NULL;
+	return 1;
+}
+
+// Reads the key of the next member when the innermost container is an
+// object. Outside a projected parse *selection and *skip are left alone,
+// staying NULL and 0.
+static inline int begin_element(json_parser_t* parser, size_t depth, char** key,
+	const json_projection_node_t** selection, int* skip) {
+	json_parse_frame_t* frame = &parser->doc->frames[depth - 1];
+	if (frame->projection) {
+		return begin_projected_element(parser, frame, key, selection, skip);
+	}
 
-		if (current_char(parser) != ':') {
-			set_error(parser, "Expected ':' after key");
-			json_free(key_value);
-			json_free(object);
+	if (value_type(frame->container) != JSON_OBJECT) {
+		*key = NULL;
+		return 1;
+	}
+
+	*key = parse_member_key(parser);
+	return *key != NULL;
+}
+
+// Iterative descent: open containers live on doc->frames instead of the C
+// stack, and each container's children are collected on doc->stack above
+// the base recorded in its frame. A container is pushed into its parent's
+// slice when it opens, so closing it only has to move its own children.
+json_value_t* parse_value(json_parser_t* parser) {
+	json_document_t* doc = parser->doc;
+	json_value_t* root = NULL;
+	char* key = NULL;
+	size_t depth = 0;
+	const json_projection_node_t* selection = parser->projection;
+	int skip = 0;
+
+	// The input is the inside of an array whose brackets are implied
+	if (parser->elements) {
+		root = create_value(parser, JSON_ARRAY);
+		if (!root || !push_frame(parser, root, 0, NULL)) {
 			return NULL;
 		}
+		depth = 1;
+	}
 
-		parser->pos++;
+	for (;;) {
 		skip_whitespace(parser);
 
-		json_value_t* value = parse_value(parser);
-		if (!value) {
-			json_free(key_value);
-			json_free(object);
+		if (is_eof(parser)) {
+			set_error(parser, "Unexpected end of input");
 			return NULL;
 		}
 
-		if (object->data.object.count >= object->data.object.capacity) {
-			size_t new_capacity = object->data.object.capacity * 2;
-			struct json_object_entry* new_entries = realloc(object->data.object.entries,
-				sizeof(struct json_object_entry) * new_capacity);
-			if (!new_entries) {
-				json_free(key_value);
-				json_free(value);
-				json_free(object);
+		json_value_t* value = NULL;
+		char c = current_char(parser);
+
+		if (skip) {
+			// Elements a projected parse does not want leave nothing behind
+			if (!skip_value(parser)) {
 				return NULL;
 			}
-			object->data.object.entries = new_entries;
-			object->data.object.capacity = new_capacity;
+			c = '\0';
 		}
+		else {
+			switch (c)
+			{
+			case 'n': value = parse_null(parser); break;
+			case 't':
+			case 'f': value = parse_boolean(parser); break;
+			case '"': value = parse_string(parser); break;
+			case '[': value = create_value(parser, JSON_ARRAY); break;
+			case '{': value = create_value(parser, JSON_OBJECT); break;
+			default:
+				if ((c >= '0' && c <= '9') || c == '-') {
+					value = parse_number(parser);
+					break;
+				}
+				set_error(parser, "Unexpected character");
+				return NULL;
+			}
 
-		object->data.object.entries[object->data.object.count].key = key_value->data.string;
-		object->data.object.entries[object->data.object.count].value = value;
-		object->data.object.count++;
+			if (!value) {
+				return NULL;
+			}
 
-		free(key_value);
+			if (depth == 0) {
+				root = value;
+			}
+			else if (!parser_push_entry(parser, key, value)) {
+				return NULL;
+			}
+		}
 
-		skip_whitespace(parser);
+		if (c == '[' || c == '{') {
+			if (!push_frame(parser, value, depth, selection)) {
+				return NULL;
+			}
+			depth++;
 
-		if (current_char(parser) == '}') {
 			parser->pos++;
-			break;
+			skip_whitespace(parser);
+
+			if (current_char(parser) != (c == '[' ? ']' : '}')) {
+				if (!begin_element(parser, depth, &key, &selection, &skip)) {
+					return NULL;
+				}
+				continue;
+			}
+
+			// Empty containers fall through to the close below
 		}
 
-		if (current_char(parser) != ',') {
-			set_error(parser, "Expected ',' or '}'");
-			json_free(object);
+		// Close every container that ends after this value
+		for (;;) {
+			if (depth == 0) {
+				return root;
+			}
+
+			json_parse_frame_t* frame = &doc->frames[depth - 1];
+			int is_array = value_type(frame->container) == JSON_ARRAY;
+
+			skip_whitespace(parser);
+			c = current_char(parser);
+
+			if (c == ',') {
+				parser->pos++;
+				break;
+			}
+
+			if (depth == 1 && parser->elements) {
+				// The implied closing bracket is the end of input
+				if (!is_eof(parser)) {
+					set_error(parser, "Expected ','");
+					return NULL;
+				}
+			}
+			else {
+				if (c != (is_array ? ']' : '}')) {
+					set_error(parser, is_array ? "Expected ',' or ']'" : "Expected ',' or '}'");
+					return NULL;
+				}
+				parser->pos++;
+			}
+
+			if (!close_frame(parser, frame)) {
+				return NULL;
+			}
+			depth--;
+		}
+
+		if (!begin_element(parser, depth, &key, &selection, &skip)) {
 			return NULL;
 		}
+	}
+}
 
-		parser->pos++;
+static json_value_t* parse_text(json_document_t* doc, const char* json, size_t len, char* insitu, int elements,
+	const json_projection_node_t* projection, size_t offset)
+{
+	json_parser_t parser = {
+		.json = json,
+		.pos = 0,
+		.len = len,
+		.error = NULL,
+		.doc = doc,
+		.insitu = insitu,
+		.structurals = NULL,
+		.next_structural = 0,
+		.escapes = 1,
+		.elements = elements,
+		.projection = projection,
+		.offset = offset
+	};
+
+	// Inputs stage 1 cannot index (too large, unterminated strings) are
+	// parsed byte by byte, which also reports the precise error
+	if (build_structural_index(json, len, &doc->index)) {
+		parser.structurals = doc->index.positions;
+		parser.escapes = doc->index.has_backslash;
 	}
-	return object;
+
+	json_value_t* result = parse_value(&parser);
+
+	if (parser.error) {
+		fprintf(stderr, "JSON parse error: %s\n", parser.error);
+		free(parser.error);
+		return NULL;
+	}
+
+	skip_whitespace(&parser);
+	if (!is_eof(&parser)) {
+		fprintf(stderr, "JSON parse error: Extra data after JSON\n");
+		return NULL;
+	}
+
+	return result;
+}
+
+json_value_t* parse_root(json_document_t* doc, const char* json, size_t len, char* insitu)
+{
+	return parse_text(doc, json, len, insitu, 0, NULL, 0);
 }
 
+json_value_t* parse_root_elements(json_document_t* doc, const char* json, size_t len, size_t offset)
+{
+	return parse_text(doc, json, len, NULL, 1, NULL, offset);
+}
 
+json_value_t* parse_root_projected(json_document_t* doc, const char* json, size_t len,
+	const json_projection_t* projection)
+{
+	const json_projection_node_t* root = projection->root;
+	return parse_text(doc, json, len, NULL, 0, root->whole ? NULL : root, 0);
+}
@@ -2,34 +2,159 @@
 #define MULTIFORMAT_JSON_PARSER_H
 
 #include "../core/data_types.h"
+#include "json_arena.h"
+#include "json_index.h"
+#include "json_key_pool.h"
+#include "json_number.h"
+#include "json_pool.h"
+#include "json_projection.h"
+#include "json_stage1.h"
+#include "json_value.h"
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
 
 #define JSON_PARSE_STACK_INIT_SIZE 256
+#define JSON_PARSE_FRAMES_INIT_SIZE 32
+#define JSON_INVALID_ESCAPE ((size_t)-1)
+
+// Open container and the document stack index of its first child. In a
+// projected parse, projection selects its children (NULL keeps them all)
+// and index counts the elements seen so far.
+typedef struct {
+	json_value_t* container;
+	size_t base;
+	const json_projection_node_t* projection;
+	size_t index;
+}json_parse_frame_t;
+
+// Owns every allocation made while parsing. The root is stored inline as the
+// first member so that json_free() can get back to the document from it.
+struct json_document {
+	json_value_t root;
+	// root holds the result of a successful parse into the current arena
+	int has_root;
+	json_arena_t arena;
+	// Children of the containers being parsed; each container copies its
+	// slice into an exactly sized arena header once it is closed
+	struct json_object_entry* stack;
+	size_t stack_size;
+	size_t stack_capacity;
+	// Containers being parsed, innermost last; kept between parses
+	json_parse_frame_t* frames;
+	size_t frame_capacity;
+	size_t max_depth;
+	json_structural_index_t index;
+	// Interns object keys when set; not owned by the document
+	json_key_pool_t* key_pool;
+};
 
 typedef struct {
 	const char* json;
 	size_t pos;
 	size_t len;
 	char* error;
+	json_document_t* doc;
+	// Writable alias of json in in-situ mode: strings are decoded and
+	// terminated in place instead of being copied into the arena
+	char* insitu;
+	// Positions found by stage 1 plus a sentinel at len; NULL when the
+	// input is scanned byte by byte
+	const uint32_t* structurals;
+	size_t next_structural;
+	// Cleared when stage 1 saw no backslash, so no string needs decoding
+	int escapes;
+	// Parse a comma-separated list of values as one array, see
+	// parse_root_elements()
+	int elements;
+	// Parts of the root to build, NULL for all of it; see parse_root_projected()
+	const json_projection_node_t* projection;
+	// Where json starts within the whole input, added to error positions
+	size_t offset;
 }json_parser_t;
 
-void skip_whitespace(json_parser_t* parser);
-int is_eof(json_parser_t* parser);
-char current_char(json_parser_t* parser);
-char next_char(json_parser_t* parser);
+static inline int is_eof(json_parser_t* parser) {
+	return parser->pos >= parser->len;
+}
+
+static inline char current_char(json_parser_t* parser) {
+	if (parser->pos < parser->len) {
+		return parser->json[parser->pos];
+	}
+	return '\0';
+}
+
+static inline char next_char(json_parser_t* parser) {
+	if (parser->pos < parser->len) {
+		return parser->json[parser->pos++];
+	}
+	return '\0';
+}
+
+// Whether raw string contents need decoding
+static inline int has_escapes(json_parser_t* parser, const char* raw, size_t length) {
+	return parser->escapes && memchr(raw, '\\', length) != NULL;
+}
+
+static inline void skip_whitespace(json_parser_t* parser) {
+	if (parser->structurals) {
+		// Everything between two structurals is whitespace or string content
+		const uint32_t* next = parser->structurals + parser->next_structural;
+		while (*next < parser->pos) {
+			next++;
+		}
+		parser->next_structural = (size_t)(next - parser->structurals);
+		parser->pos = *next;
+		return;
+	}
+
+	while (parser->pos < parser->len &&
+		json_char_class[(unsigned char)parser->json[parser->pos]] == JSON_CLASS_WHITESPACE) {
+		parser->pos++;
+	}
+}
+
+// Scalars must be followed by whitespace, a structural character or the end
+// of input; stage 1 only indexes their first byte
+static inline int at_value_end(json_parser_t* parser) {
+	return parser->pos >= parser->len ||
+		json_char_class[(unsigned char)parser->json[parser->pos]] != 0;
+}
+
+void document_init(json_document_t* doc);
+void document_release(json_document_t* doc);
+
 void set_error(json_parser_t* parser, const char* message);
-json_value_t* create_value(json_type_t type);
+json_value_t* create_value(json_parser_t* parser, json_type_t type);
 json_value_t* parse_null(json_parser_t* parser);
 json_value_t* parse_boolean(json_parser_t* parser);
 json_value_t* parse_number(json_parser_t* parser);
+// Length of the run before the first quote or backslash in src, or length
+// when there is neither
+size_t string_run_length(const char* src, size_t length);
+// Decodes the escapes in raw string contents into dst, which may be src;
+// returns the decoded length or JSON_INVALID_ESCAPE
+size_t unescape_string(char* dst, const char* src, size_t length);
+char* parse_string_data(json_parser_t* parser, int is_key);
 json_value_t* parse_string(json_parser_t* parser);
-json_value_t* parse_array(json_parser_t* parser);
 json_value_t* parse_value(json_parser_t* parser);
-json_value_t* parse_object(json_parser_t* parser);
+int parser_push_entry(json_parser_t* parser, char* key, json_value_t* value);
+
+// Parses one complete JSON text into the document arena without resetting
+// it, so several texts can share one arena; errors are printed to stderr
+json_value_t* parse_root(json_document_t* doc, const char* json, size_t len, char* insitu);
+
+// Same as parse_root() for the elements of an array without its brackets,
+// such as one slice of a large top-level array starting at offset in the
+// whole input
+json_value_t* parse_root_elements(json_document_t* doc, const char* json, size_t len, size_t offset);
+
+// Same as parse_root() building only what projection selects. Everything
+// else is skipped by bracket matching without being decoded or validated.
+json_value_t* parse_root_projected(json_document_t* doc, const char* json, size_t len,
+	const json_projection_t* projection);
 
 
 
-#endif // MULTIFORMAT_JSON_PARSER_H
\ No newline at end of file
+#endif // MULTIFORMAT_JSON_PARSER_H
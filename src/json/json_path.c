@@ -0,0 +1,205 @@
+﻿#include "json_path.h"
+#include <stdint.h>
+
+typedef struct {
+	const char* pos;
+	json_path_t* path;
+	// Next free byte of path->keys
+	char* keys;
+}json_path_compiler_t;
+
+static json_path_step_t* path_add_step(json_path_compiler_t* compiler, json_path_step_type_t type)
+{
+	json_path_step_t* step = &compiler->path->steps[compiler->path->count++];
+	step->type = type;
+	step->key = NULL;
+	step->index = JSON_PATH_NO_INDEX;
+	return step;
+}
+
+// Parses a decimal array index; returns 0 on overflow or leading zeros
+static int path_parse_index(const char* digits, size_t length, size_t* out)
+{
+	if (length == 0 || (length > 1 && digits[0] == '0')) {
+		return 0;
+	}
+
+	size_t value = 0;
+	for (size_t i = 0; i < length; i++) {
+		if (digits[i] < '0' || digits[i] > '9') {
+			return 0;
+		}
+		size_t digit = (size_t)(digits[i] - '0');
+		if (value > (SIZE_MAX - 1 - digit) / 10) {
+			return 0;
+		}
+		value = value * 10 + digit;
+	}
+
+	*out = value;
+	return 1;
+}
+
+// JSON Pointer (RFC 6901): "/items/0/price", "~0" is '~' and "~1" is '/'
+static int path_compile_pointer(json_path_compiler_t* compiler)
+{
+	const char* p = compiler->pos;
+
+	while (*p == '/') {
+		p++;
+		const char* start = p;
+		char* key = compiler->keys;
+
+		while (*p && *p != '/') {
+			if (*p == '~') {
+				if (p[1] != '0' && p[1] != '1') {
+					return 0;
+				}
+				*compiler->keys++ = p[1] == '0' ? '~' : '/';
+				p += 2;
+			}
+			else {
+				*compiler->keys++ = *p++;
+			}
+		}
+		*compiler->keys++ = '\0';
+
+		// Tokens that are not array indexes keep JSON_PATH_NO_INDEX
+		json_path_step_t* step = path_add_step(compiler, PATH_TOKEN);
+		step->key = key;
+		path_parse_index(start, (size_t)(p - start), &step->index);
+	}
+	return *p == '\0';
+}
+
+static int path_compile_bracket(json_path_compiler_t* compiler)
+{
+	const char* p = compiler->pos;
+
+	if (*p == '*') {
+		path_add_step(compiler, PATH_WILDCARD);
+		p++;
+	}
+	else if (*p == '\'' || *p == '"') {
+		char quote = *p++;
+		char* key = compiler->keys;
+
+		while (*p && *p != quote) {
+			if (*p == '\\') {
+				if (p[1] != '\\' && p[1] != '\'' && p[1] != '"') {
+					return 0;
+				}
+				p++;
+			}
+			*compiler->keys++ = *p++;
+		}
+		if (*p != quote) {
+			return 0;
+		}
+		*compiler->keys++ = '\0';
+		p++;
+
+		path_add_step(compiler, PATH_KEY)->key = key;
+	}
+	else {
+		const char* start = p;
+		while (*p >= '0' && *p <= '9') {
+			p++;
+		}
+		if (!path_parse_index(start, (size_t)(p - start), &path_add_step(compiler, PATH_INDEX)->index)) {
+			return 0;
+		}
+	}
+
+	if (*p != ']') {
+		return 0;
+	}
+	compiler->pos = p + 1;
+	return 1;
+}
+
+// JSONPath subset: "$", ".name", ".*", "['name']", "[0]" and "[*]"
+static int path_compile_jsonpath(json_path_compiler_t* compiler)
+{
+	const char* p = compiler->pos + 1;
+
+	while (*p) {
+		if (*p == '[') {
+			compiler->pos = p + 1;
+			if (!path_compile_bracket(compiler)) {
+				return 0;
+			}
+			p = compiler->pos;
+			continue;
+		}
+		if (*p != '.') {
+			return 0;
+		}
+
+		p++;
+		if (*p == '*') {
+			path_add_step(compiler, PATH_WILDCARD);
+			p++;
+			continue;
+		}
+
+		// Recursive descent ("..") is not supported
+		const char* start = p;
+		while (*p && *p != '.' && *p != '[') {
+			p++;
+		}
+		if (p == start) {
+			return 0;
+		}
+
+		char* key = compiler->keys;
+		memcpy(key, start, (size_t)(p - start));
+		compiler->keys += p - start;
+		*compiler->keys++ = '\0';
+		path_add_step(compiler, PATH_KEY)->key = key;
+	}
+	return 1;
+}
+
+json_path_t* path_compile(const char* expression)
+{
+	size_t length = strlen(expression);
+	json_path_t* path = malloc(sizeof(json_path_t));
+	if (!path) {
+		return NULL;
+	}
+
+	// Every step consumes at least one byte, and decoded keys plus their
+	// terminators never outgrow the expression
+	path->count = 0;
+	path->steps = malloc(sizeof(json_path_step_t) * (length + 1));
+	path->keys = malloc(length + 1);
+	if (!path->steps || !path->keys) {
+		path_free(path);
+		return NULL;
+	}
+
+	json_path_compiler_t compiler = { expression, path, path->keys };
+	int result;
+	if (expression[0] == '$') {
+		result = path_compile_jsonpath(&compiler);
+	}
+	else {
+		result = path_compile_pointer(&compiler);
+	}
+
+	if (!result) {
+		path_free(path);
+		return NULL;
+	}
+	return path;
+}
+
+void path_free(json_path_t* path)
+{
+	if (!path) return;
+
+	free(path->steps);
+	free(path->keys);
+	free(path);
+}
@@ -0,0 +1,34 @@
+﻿#ifndef MULTIFORMAT_JSON_PATH_H
+#define MULTIFORMAT_JSON_PATH_H
+
+#include "../core/data_types.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	PATH_KEY,
+	PATH_INDEX,
+	PATH_WILDCARD,
+	// JSON Pointer reference token: a key for objects, an index for arrays
+	PATH_TOKEN
+}json_path_step_type_t;
+
+#define JSON_PATH_NO_INDEX ((size_t)-1)
+
+typedef struct {
+	json_path_step_type_t type;
+	const char* key;
+	size_t index;
+}json_path_step_t;
+
+// Compiled query; keys point into one buffer owned by the path
+struct json_path {
+	json_path_step_t* steps;
+	size_t count;
+	char* keys;
+};
+
+json_path_t* path_compile(const char* expression);
+void path_free(json_path_t* path);
+
+#endif // MULTIFORMAT_JSON_PATH_H
@@ -0,0 +1,181 @@
+﻿#include "json_pool.h"
+#include "json_thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Free blocks are chained through their first bytes
+typedef struct pool_block {
+	struct pool_block* next;
+}pool_block_t;
+
+typedef struct {
+	pool_block_t* blocks[JSON_POOL_CLASSES];
+	size_t counts[JSON_POOL_CLASSES];
+}pool_lists_t;
+
+static json_once_t pool_once = JSON_ONCE_INIT;
+static json_mutex_t pool_lock;
+static json_tls_key_t pool_key;
+static int pool_ready;
+// Shared by every thread, guarded by pool_lock
+static pool_lists_t pool_global;
+
+static int pool_class(size_t size)
+{
+	if (size > JSON_POOL_MAX_SIZE) {
+		return -1;
+	}
+
+	int shift = JSON_POOL_MIN_SHIFT;
+	while (((size_t)1 << shift) < size) {
+		shift++;
+	}
+	return shift - JSON_POOL_MIN_SHIFT;
+}
+
+static size_t class_size(int cls)
+{
+	return (size_t)1 << (cls + JSON_POOL_MIN_SHIFT);
+}
+
+static pool_block_t* list_pop(pool_lists_t* lists, int cls)
+{
+	pool_block_t* block = lists->blocks[cls];
+	if (block) {
+		lists->blocks[cls] = block->next;
+		lists->counts[cls]--;
+	}
+	return block;
+}
+
+static void list_push(pool_lists_t* lists, int cls, pool_block_t* block)
+{
+	block->next = lists->blocks[cls];
+	lists->blocks[cls] = block;
+	lists->counts[cls]++;
+}
+
+// Moves up to count blocks of a class from a thread to the global pool and
+// frees what it has no room for
+static void return_blocks(pool_lists_t* local, int cls, size_t count)
+{
+	pool_block_t* overflow = NULL;
+
+	mutex_lock(&pool_lock);
+	while (count-- > 0 && local->blocks[cls]) {
+		pool_block_t* block = list_pop(local, cls);
+		if (pool_global.counts[cls] < JSON_POOL_GLOBAL_LIMIT) {
+			list_push(&pool_global, cls, block);
+		}
+		else {
+			block->next = overflow;
+			overflow = block;
+		}
+	}
+	mutex_unlock(&pool_lock);
+
+	while (overflow) {
+		pool_block_t* next = overflow->next;
+		free(overflow);
+		overflow = next;
+	}
+}
+
+static void JSON_TLS_CALLBACK release_thread_lists(void* value)
+{
+	pool_lists_t* local = value;
+	for (int cls = 0; cls < JSON_POOL_CLASSES; cls++) {
+		return_blocks(local, cls, local->counts[cls]);
+	}
+	free(local);
+}
+
+static void pool_init(void)
+{
+	mutex_init(&pool_lock);
+	pool_ready = tls_key_create(&pool_key, release_thread_lists);
+}
+
+// NULL when thread-local storage is unavailable, in which case blocks go
+// straight to malloc and free
+static pool_lists_t* thread_lists(void)
+{
+	thread_once(&pool_once, pool_init);
+	if (!pool_ready) {
+		return NULL;
+	}
+
+	pool_lists_t* local = tls_get(pool_key);
+	if (!local) {
+		local = calloc(1, sizeof(pool_lists_t));
+		if (local) {
+			tls_set(pool_key, local);
+		}
+	}
+	return local;
+}
+
+size_t pool_size(size_t size)
+{
+	int cls = pool_class(size);
+	return cls < 0 ? size : class_size(cls);
+}
+
+void* pool_alloc(size_t size)
+{
+	int cls = pool_class(size);
+	pool_lists_t* local = cls < 0 ? NULL : thread_lists();
+	if (!local) {
+		return malloc(cls < 0 ? size : class_size(cls));
+	}
+
+	if (!local->blocks[cls]) {
+		// Refill in a batch so the lock is taken once per several blocks
+		mutex_lock(&pool_lock);
+		for (size_t i = 0; i < JSON_POOL_BATCH && pool_global.blocks[cls]; i++) {
+			list_push(local, cls, list_pop(&pool_global, cls));
+		}
+		mutex_unlock(&pool_lock);
+
+		if (!local->blocks[cls]) {
+			return malloc(class_size(cls));
+		}
+	}
+	return list_pop(local, cls);
+}
+
+void pool_free(void* block, size_t size)
+{
+	if (!block) return;
+
+	int cls = pool_class(size);
+	pool_lists_t* local = cls < 0 ? NULL : thread_lists();
+	if (!local) {
+		free(block);
+		return;
+	}
+
+	list_push(local, cls, block);
+	if (local->counts[cls] > JSON_POOL_LOCAL_LIMIT) {
+		return_blocks(local, cls, JSON_POOL_BATCH);
+	}
+}
+
+void* pool_realloc(void* block, size_t old_size, size_t new_size)
+{
+	if (!block) {
+		return pool_alloc(new_size);
+	}
+	if (pool_size(old_size) == pool_size(new_size)) {
+		return block;
+	}
+
+	void* result = pool_alloc(new_size);
+	if (!result) {
+		return NULL;
+	}
+
+	memcpy(result, block, old_size < new_size ? old_size : new_size);
+	pool_free(block, old_size);
+	return result;
+}
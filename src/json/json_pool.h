@@ -0,0 +1,32 @@
+﻿#ifndef MULTIFORMAT_JSON_POOL_H
+#define MULTIFORMAT_JSON_POOL_H
+
+#include <stddef.h>
+
+// Size classes are powers of two from 256 bytes to 64 KiB; larger requests
+// go straight to malloc
+#define JSON_POOL_MIN_SHIFT 8
+#define JSON_POOL_MAX_SHIFT 16
+#define JSON_POOL_CLASSES (JSON_POOL_MAX_SHIFT - JSON_POOL_MIN_SHIFT + 1)
+#define JSON_POOL_MAX_SIZE ((size_t)1 << JSON_POOL_MAX_SHIFT)
+
+// Blocks each thread keeps per class before returning a batch to the
+// global pool, and blocks the global pool keeps per class before freeing
+#define JSON_POOL_LOCAL_LIMIT 16
+#define JSON_POOL_BATCH 8
+#define JSON_POOL_GLOBAL_LIMIT 64
+
+// Arena blocks, documents and parse stacks are recycled through per-thread
+// free lists, so parsing on many threads at once rarely reaches malloc.
+// A thread's free lists are handed to the global pool when it exits.
+
+// Size actually reserved for a request; allocating that much costs nothing extra
+size_t pool_size(size_t size);
+
+void* pool_alloc(size_t size);
+// size must be the size the block was allocated with
+void pool_free(void* block, size_t size);
+// Same as realloc() with the old size given; NULL leaves block untouched
+void* pool_realloc(void* block, size_t old_size, size_t new_size);
+
+#endif // MULTIFORMAT_JSON_POOL_H
@@ -0,0 +1,187 @@
+﻿#include "json_projection.h"
+
+static json_projection_node_t* projection_new_node(json_arena_t* arena)
+{
+	json_projection_node_t* node = arena_alloc(arena, sizeof(json_projection_node_t));
+	if (node) {
+		node->whole = 0;
+		node->children = NULL;
+		node->any = NULL;
+	}
+	return node;
+}
+
+// Child with the given key or index, created if missing; target is the node
+// a new child gets, NULL for a fresh one
+static json_projection_node_t* projection_add_child(json_arena_t* arena, json_projection_node_t* node,
+	const char* key, size_t key_length, size_t index, json_projection_node_t* target)
+{
+	json_projection_child_t** link = &node->children;
+	for (; *link; link = &(*link)->next) {
+		json_projection_child_t* child = *link;
+		int same_key = key ? child->key && child->key_length == key_length && memcmp(child->key, key, key_length) == 0
+			: child->key == NULL;
+		if (same_key && child->index == index) {
+			return child->node;
+		}
+	}
+
+	json_projection_child_t* child = arena_alloc(arena, sizeof(json_projection_child_t));
+	if (!child) {
+		return NULL;
+	}
+	child->next = NULL;
+	child->key = key ? arena_strndup(arena, key, key_length) : NULL;
+	child->key_length = key_length;
+	child->index = index;
+	child->node = target ? target : projection_new_node(arena);
+	if ((key && !child->key) || !child->node) {
+		return NULL;
+	}
+
+	*link = child;
+	return child->node;
+}
+
+// Selection of a single path. A JSON Pointer token such as /0 names both a
+// member and an element, so it becomes a key child and an index child that
+// share the rest of the path; merging the tree into the projection then
+// gives each its own copy.
+static json_projection_node_t* projection_path_tree(json_arena_t* arena, const json_path_t* path)
+{
+	json_projection_node_t* tree = projection_new_node(arena);
+	json_projection_node_t* node = tree;
+
+	for (size_t i = 0; i < path->count && node; i++) {
+		const json_path_step_t* step = &path->steps[i];
+		switch (step->type)
+		{
+		case PATH_WILDCARD:
+			node = node->any = projection_new_node(arena);
+			break;
+		case PATH_INDEX:
+			node = projection_add_child(arena, node, NULL, 0, step->index, NULL);
+			break;
+		default: {
+			json_projection_node_t* member = projection_add_child(arena, node, step->key, strlen(step->key),
+				JSON_PATH_NO_INDEX, NULL);
+			if (member && step->index != JSON_PATH_NO_INDEX
+				&& !projection_add_child(arena, node, NULL, 0, step->index, member)) {
+				member = NULL;
+			}
+			node = member;
+			break;
+		}
+		}
+	}
+
+	if (!node) {
+		return NULL;
+	}
+	node->whole = 1;
+	return tree;
+}
+
+// Adds everything src selects to dst
+static int projection_merge(json_arena_t* arena, json_projection_node_t* dst, const json_projection_node_t* src)
+{
+	if (dst->whole) {
+		return 1;
+	}
+	if (src->whole) {
+		dst->whole = 1;
+		return 1;
+	}
+
+	for (const json_projection_child_t* child = src->children; child; child = child->next) {
+		json_projection_node_t* node = projection_add_child(arena, dst, child->key, child->key_length, child->index, NULL);
+		if (!node || !projection_merge(arena, node, child->node)) {
+			return 0;
+		}
+	}
+
+	if (src->any) {
+		if (!dst->any && !(dst->any = projection_new_node(arena))) {
+			return 0;
+		}
+		return projection_merge(arena, dst->any, src->any);
+	}
+	return 1;
+}
+
+static int projection_spread_wildcards(json_arena_t* arena, json_projection_node_t* node)
+{
+	if (node->whole) {
+		return 1;
+	}
+
+	for (json_projection_child_t* child = node->children; child; child = child->next) {
+		if (node->any && !projection_merge(arena, child->node, node->any)) {
+			return 0;
+		}
+		if (!projection_spread_wildcards(arena, child->node)) {
+			return 0;
+		}
+	}
+	return !node->any || projection_spread_wildcards(arena, node->any);
+}
+
+json_projection_t* projection_compile(const char* const* paths, size_t count)
+{
+	json_projection_t* projection = malloc(sizeof(json_projection_t));
+	if (!projection) {
+		return NULL;
+	}
+
+	arena_init(&projection->arena);
+	projection->root = projection_new_node(&projection->arena);
+	if (!projection->root) {
+		projection_free(projection);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		json_path_t* path = paths[i] ? path_compile(paths[i]) : NULL;
+		json_projection_node_t* tree = path ? projection_path_tree(&projection->arena, path) : NULL;
+		int added = tree && projection_merge(&projection->arena, projection->root, tree);
+		path_free(path);
+		if (!added) {
+			projection_free(projection);
+			return NULL;
+		}
+	}
+
+	if (!projection_spread_wildcards(&projection->arena, projection->root)) {
+		projection_free(projection);
+		return NULL;
+	}
+	return projection;
+}
+
+void projection_free(json_projection_t* projection)
+{
+	if (!projection) return;
+
+	arena_free(&projection->arena);
+	free(projection);
+}
+
+const json_projection_node_t* projection_find_key(const json_projection_node_t* node, const char* key, size_t length)
+{
+	for (const json_projection_child_t* child = node->children; child; child = child->next) {
+		if (child->key && child->key_length == length && memcmp(child->key, key, length) == 0) {
+			return child->node;
+		}
+	}
+	return node->any;
+}
+
+const json_projection_node_t* projection_find_index(const json_projection_node_t* node, size_t index)
+{
+	for (const json_projection_child_t* child = node->children; child; child = child->next) {
+		if (child->index == index) {
+			return child->node;
+		}
+	}
+	return node->any;
+}
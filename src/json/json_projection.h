@@ -0,0 +1,47 @@
+﻿#ifndef MULTIFORMAT_JSON_PROJECTION_H
+#define MULTIFORMAT_JSON_PROJECTION_H
+
+#include "../core/data_types.h"
+#include "json_arena.h"
+#include "json_path.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct json_projection_node json_projection_node_t;
+
+typedef struct json_projection_child {
+	struct json_projection_child* next;
+	// Member name, NULL when the child names an array element
+	const char* key;
+	size_t key_length;
+	// Element index, JSON_PATH_NO_INDEX when the child names a member
+	size_t index;
+	json_projection_node_t* node;
+}json_projection_child_t;
+
+// One level of the selected paths merged into a tree. A whole node keeps its
+// value entirely; any other keeps only the members and elements it names,
+// with any applying to those no child names.
+struct json_projection_node {
+	int whole;
+	json_projection_child_t* children;
+	json_projection_node_t* any;
+};
+
+// Nodes and keys live in one arena owned by the projection
+struct json_projection {
+	json_projection_node_t* root;
+	json_arena_t arena;
+};
+
+// Paths use the json_path_compile() syntax; wildcard selections are copied
+// into their named siblings so a lookup never has to combine two nodes
+json_projection_t* projection_compile(const char* const* paths, size_t count);
+void projection_free(json_projection_t* projection);
+
+// Selection for a member or element of a container selected by node, NULL
+// when it is not wanted
+const json_projection_node_t* projection_find_key(const json_projection_node_t* node, const char* key, size_t length);
+const json_projection_node_t* projection_find_index(const json_projection_node_t* node, size_t index);
+
+#endif // MULTIFORMAT_JSON_PROJECTION_H
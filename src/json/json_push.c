@@ -0,0 +1,399 @@
+﻿#include "json_push.h"
+
+void push_parser_init(json_push_parser_t* parser, const json_sax_handler_t* handler, void* ctx)
+{
+	memset(parser, 0, sizeof(*parser));
+	parser->state = PUSH_VALUE;
+	parser->handler = handler;
+	parser->ctx = ctx;
+	parser->max_depth = JSON_DEFAULT_MAX_DEPTH;
+}
+
+void push_parser_free(json_push_parser_t* parser)
+{
+	free(parser->token);
+	free(parser->stack);
+	free(parser->error);
+	parser->token = NULL;
+	parser->stack = NULL;
+	parser->error = NULL;
+}
+
+// Stops the parser for good; a NULL message means a handler asked to stop
+static int push_fail(json_push_parser_t* parser, const char* message, size_t pos)
+{
+	if (message && parser->error == NULL) {
+		parser->error = malloc(256);
+		if (parser->error) {
+			snprintf(parser->error, 256, "%s at position %zu", message, parser->offset + pos);
+		}
+	}
+	parser->state = PUSH_ERROR;
+	return 0;
+}
+
+static int push_emit(json_push_parser_t* parser, int (*callback)(void* ctx))
+{
+	return !callback || callback(parser->ctx);
+}
+
+static int push_token_append(json_push_parser_t* parser, const char* data, size_t length)
+{
+	// One spare byte for the terminator added to decoded strings
+	size_t needed = parser->token_length + length + 1;
+	if (needed > parser->token_capacity) {
+		size_t new_capacity = parser->token_capacity ? parser->token_capacity * 2 : JSON_PUSH_TOKEN_INIT_SIZE;
+		while (new_capacity < needed) {
+			new_capacity *= 2;
+		}
+
+		char* new_token = realloc(parser->token, new_capacity);
+		if (!new_token) {
+			return 0;
+		}
+		parser->token = new_token;
+		parser->token_capacity = new_capacity;
+	}
+
+	memcpy(parser->token + parser->token_length, data, length);
+	parser->token_length += length;
+	return 1;
+}
+
+static int push_open(json_push_parser_t* parser, int is_object, size_t pos)
+{
+	if (parser->depth >= parser->max_depth) {
+		return push_fail(parser, "Maximum nesting depth exceeded", pos);
+	}
+	if (parser->depth == parser->stack_capacity * 8) {
+		size_t new_capacity = parser->stack_capacity ? parser->stack_capacity * 2 : JSON_PUSH_STACK_INIT_SIZE / 8;
+		uint8_t* new_stack = realloc(parser->stack, new_capacity);
+		if (!new_stack) {
+			return push_fail(parser, "Out of memory", pos);
+		}
+		parser->stack = new_stack;
+		parser->stack_capacity = new_capacity;
+	}
+
+	uint8_t bit = (uint8_t)(1u << (parser->depth % 8));
+	if (is_object) {
+		parser->stack[parser->depth / 8] |= bit;
+	}
+	else {
+		parser->stack[parser->depth / 8] &= (uint8_t)~bit;
+	}
+	parser->depth++;
+
+	const json_sax_handler_t* handler = parser->handler;
+	parser->state = is_object ? PUSH_OBJECT_START : PUSH_ARRAY_START;
+	return push_emit(parser, is_object ? handler->on_start_object : handler->on_start_array) ||
+		push_fail(parser, NULL, pos);
+}
+
+static int push_in_object(const json_push_parser_t* parser)
+{
+	size_t top = parser->depth - 1;
+	return (parser->stack[top / 8] >> (top % 8)) & 1;
+}
+
+static void push_value_done(json_push_parser_t* parser)
+{
+	parser->state = parser->depth ? PUSH_AFTER_VALUE : PUSH_DONE;
+}
+
+static int push_close(json_push_parser_t* parser, size_t pos)
+{
+	const json_sax_handler_t* handler = parser->handler;
+	int is_object = push_in_object(parser);
+
+	parser->depth--;
+	push_value_done(parser);
+	return push_emit(parser, is_object ? handler->on_end_object : handler->on_end_array) ||
+		push_fail(parser, NULL, pos);
+}
+
+static void push_begin_string(json_push_parser_t* parser, int is_key)
+{
+	parser->state = PUSH_STRING;
+	parser->string_is_key = is_key;
+	parser->string_has_escape = 0;
+	parser->escape_pending = 0;
+	parser->token_length = 0;
+}
+
+static int push_end_string(json_push_parser_t* parser, size_t pos)
+{
+	size_t length = parser->token_length;
+	if (parser->string_has_escape) {
+		length = unescape_string(parser->token, parser->token, length);
+		if (length == JSON_INVALID_ESCAPE) {
+			return push_fail(parser, "Invalid escape sequence", pos);
+		}
+	}
+
+	// Empty strings never allocated the token buffer
+	if (!parser->token && !push_token_append(parser, "", 0)) {
+		return push_fail(parser, "Out of memory", pos);
+	}
+	parser->token[length] = '\0';
+
+	const json_sax_handler_t* handler = parser->handler;
+	if (parser->string_is_key) {
+		parser->state = PUSH_COLON;
+		return !handler->on_key || handler->on_key(parser->ctx, parser->token, length) || push_fail(parser, NULL, pos);
+	}
+
+	push_value_done(parser);
+	return !handler->on_string || handler->on_string(parser->ctx, parser->token, length) || push_fail(parser, NULL, pos);
+}
+
+static void push_begin_literal(json_push_parser_t* parser, char first)
+{
+	parser->state = PUSH_LITERAL;
+	parser->literal = first == 't' ? "true" : first == 'f' ? "false" : "null";
+	parser->literal_length = strlen(parser->literal);
+	parser->literal_matched = 1;
+}
+
+static int push_end_literal(json_push_parser_t* parser, size_t pos)
+{
+	const json_sax_handler_t* handler = parser->handler;
+	int ok;
+
+	push_value_done(parser);
+	switch (parser->literal[0]) {
+	case 't':
+		ok = !handler->on_bool || handler->on_bool(parser->ctx, 1);
+		break;
+	case 'f':
+		ok = !handler->on_bool || handler->on_bool(parser->ctx, 0);
+		break;
+	default:
+		ok = push_emit(parser, handler->on_null);
+		break;
+	}
+	return ok || push_fail(parser, NULL, pos);
+}
+
+static int push_literal_error(json_push_parser_t* parser, size_t pos)
+{
+	return push_fail(parser, parser->literal[0] == 'n' ? "Expected 'null'" : "Expected 'true' or 'false'", pos);
+}
+
+static int is_number_char(char c)
+{
+	return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// next is the byte after the number, or '\0' at the end of input
+static int push_end_number(json_push_parser_t* parser, char next, size_t pos)
+{
+	json_number_t number;
+	size_t consumed = parse_json_number(parser->token, parser->token_length, &number);
+	if (consumed == 0) {
+		return push_fail(parser, "Expected number", pos);
+	}
+	if (consumed != parser->token_length || (next && json_char_class[(unsigned char)next] == 0)) {
+		return push_fail(parser, "Invalid number", pos);
+	}
+
+	const json_sax_handler_t* handler = parser->handler;
+	push_value_done(parser);
+	return !handler->on_number || handler->on_number(parser->ctx, &number) || push_fail(parser, NULL, pos);
+}
+
+// Starts the value whose first byte is c; returns 0 after failing
+static int push_begin_value(json_push_parser_t* parser, char c, size_t pos)
+{
+	switch (c) {
+	case '{':
+		return push_open(parser, 1, pos);
+	case '[':
+		return push_open(parser, 0, pos);
+	case '"':
+		push_begin_string(parser, 0);
+		return 1;
+	case 't':
+	case 'f':
+	case 'n':
+		push_begin_literal(parser, c);
+		return 1;
+	default:
+		if (c == '-' || (c >= '0' && c <= '9')) {
+			parser->state = PUSH_NUMBER;
+			parser->token_length = 0;
+			return push_token_append(parser, &c, 1) || push_fail(parser, "Out of memory", pos);
+		}
+		return push_fail(parser, "Unexpected character", pos);
+	}
+}
+
+int push_parser_feed(json_push_parser_t* parser, const char* data, size_t length)
+{
+	size_t i = 0;
+
+	while (i < length && parser->state != PUSH_ERROR) {
+		char c = data[i];
+
+		switch (parser->state) {
+		case PUSH_STRING: {
+			// Copy the run of plain bytes in one go
+			size_t start = i;
+			while (i < length) {
+				if (parser->escape_pending) {
+					parser->escape_pending = 0;
+				}
+				else if (data[i] == '\\') {
+					parser->escape_pending = 1;
+					parser->string_has_escape = 1;
+				}
+				else if (data[i] == '"') {
+					break;
+				}
+				i++;
+			}
+
+			if (!push_token_append(parser, data + start, i - start)) {
+				return push_fail(parser, "Out of memory", i);
+			}
+			if (i < length) {
+				i++;
+				push_end_string(parser, i);
+			}
+			continue;
+		}
+		case PUSH_NUMBER: {
+			size_t start = i;
+			while (i < length && is_number_char(data[i])) {
+				i++;
+			}
+
+			if (!push_token_append(parser, data + start, i - start)) {
+				return push_fail(parser, "Out of memory", i);
+			}
+			// The byte after the number is handled by the next state
+			if (i < length) {
+				push_end_number(parser, data[i], i);
+			}
+			continue;
+		}
+		case PUSH_LITERAL:
+			if (parser->literal_matched < parser->literal_length) {
+				if (c != parser->literal[parser->literal_matched]) {
+					push_literal_error(parser, i);
+					continue;
+				}
+				parser->literal_matched++;
+				i++;
+			}
+			else if (json_char_class[(unsigned char)c] == 0) {
+				push_literal_error(parser, i);
+			}
+			else {
+				push_end_literal(parser, i);
+			}
+			continue;
+		default:
+			break;
+		}
+
+		if (json_char_class[(unsigned char)c] == JSON_CLASS_WHITESPACE) {
+			i++;
+			continue;
+		}
+
+		switch (parser->state) {
+		case PUSH_ARRAY_START:
+			if (c == ']') {
+				push_close(parser, i);
+				break;
+			}
+			push_begin_value(parser, c, i);
+			break;
+		case PUSH_VALUE:
+			push_begin_value(parser, c, i);
+			break;
+		case PUSH_OBJECT_START:
+			if (c == '}') {
+				push_close(parser, i);
+				break;
+			}
+			// fall through
+		case PUSH_KEY:
+			if (c != '"') {
+				push_fail(parser, "Expected string key", i);
+				break;
+			}
+			push_begin_string(parser, 1);
+			break;
+		case PUSH_COLON:
+			if (c != ':') {
+				push_fail(parser, "Expected ':' after key", i);
+				break;
+			}
+			parser->state = PUSH_VALUE;
+			break;
+		case PUSH_AFTER_VALUE:
+			if (push_in_object(parser)) {
+				if (c == ',') {
+					parser->state = PUSH_KEY;
+				}
+				else if (c == '}') {
+					push_close(parser, i);
+				}
+				else {
+					push_fail(parser, "Expected ',' or '}'", i);
+				}
+			}
+			else {
+				if (c == ',') {
+					parser->state = PUSH_VALUE;
+				}
+				else if (c == ']') {
+					push_close(parser, i);
+				}
+				else {
+					push_fail(parser, "Expected ',' or ']'", i);
+				}
+			}
+			break;
+		case PUSH_DONE:
+			push_fail(parser, "Extra data after JSON", i);
+			break;
+		default:
+			break;
+		}
+		i++;
+	}
+
+	parser->offset += length;
+	return parser->state != PUSH_ERROR;
+}
+
+int push_parser_finish(json_push_parser_t* parser)
+{
+	switch (parser->state) {
+	case PUSH_DONE:
+		return 1;
+	case PUSH_ERROR:
+		return 0;
+	case PUSH_NUMBER:
+		if (parser->depth == 0) {
+			return push_end_number(parser, '\0', 0) && parser->state == PUSH_DONE;
+		}
+		break;
+	case PUSH_LITERAL:
+		if (parser->depth == 0 && parser->literal_matched == parser->literal_length) {
+			return push_end_literal(parser, 0);
+		}
+		if (parser->literal_matched < parser->literal_length) {
+			return push_literal_error(parser, 0);
+		}
+		break;
+	case PUSH_STRING:
+		return push_fail(parser, "Untermitated string", 0);
+	default:
+		break;
+	}
+	return push_fail(parser, "Unexpected end of input", 0);
+}
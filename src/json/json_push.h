@@ -0,0 +1,59 @@
+﻿#ifndef MULTIFORMAT_JSON_PUSH_H
+#define MULTIFORMAT_JSON_PUSH_H
+
+#include "../core/data_types.h"
+#include "json_builder.h"
+
+#define JSON_PUSH_TOKEN_INIT_SIZE 256
+#define JSON_PUSH_STACK_INIT_SIZE 64
+
+typedef enum {
+	PUSH_VALUE,         // a value is expected
+	PUSH_ARRAY_START,   // a value or ']' is expected
+	PUSH_OBJECT_START,  // a key or '}' is expected
+	PUSH_KEY,           // a key is expected
+	PUSH_COLON,         // ':' after a key is expected
+	PUSH_AFTER_VALUE,   // ',' or a closing bracket is expected
+	PUSH_STRING,
+	PUSH_NUMBER,
+	PUSH_LITERAL,
+	PUSH_DONE,
+	PUSH_ERROR
+}json_push_state_t;
+
+// Byte-at-a-time state machine: every piece of state lives here, so input
+// may be split anywhere, including inside strings, numbers and literals
+struct json_push_parser {
+	json_push_state_t state;
+	const json_sax_handler_t* handler;
+	void* ctx;
+	// Tree building when no handler is given
+	json_document_t* doc;
+	json_builder_t builder;
+	// Raw bytes of the string or number being read
+	char* token;
+	size_t token_length;
+	size_t token_capacity;
+	int string_is_key;
+	int string_has_escape;
+	int escape_pending;
+	const char* literal;
+	size_t literal_length;
+	size_t literal_matched;
+	// One bit per open container, set for objects
+	uint8_t* stack;
+	size_t depth;
+	size_t stack_capacity;
+	// Open containers allowed, as in json_document_set_max_depth()
+	size_t max_depth;
+	// Bytes consumed by earlier chunks, for error positions
+	size_t offset;
+	char* error;
+};
+
+void push_parser_init(json_push_parser_t* parser, const json_sax_handler_t* handler, void* ctx);
+void push_parser_free(json_push_parser_t* parser);
+int push_parser_feed(json_push_parser_t* parser, const char* data, size_t length);
+int push_parser_finish(json_push_parser_t* parser);
+
+#endif // MULTIFORMAT_JSON_PUSH_H
@@ -0,0 +1,414 @@
+﻿#include "json_sax.h"
+#include "json_parser.h"
+
+void sax_parser_init(json_sax_parser_t* parser, const json_sax_handler_t* handler, void* ctx)
+{
+	memset(parser, 0, sizeof(*parser));
+	parser->handler = handler;
+	parser->ctx = ctx;
+}
+
+void sax_parser_free(json_sax_parser_t* parser)
+{
+	free(parser->buffer);
+	free(parser->scratch);
+	free(parser->stack);
+	free(parser->error);
+	parser->buffer = NULL;
+	parser->scratch = NULL;
+	parser->stack = NULL;
+	parser->error = NULL;
+}
+
+static void sax_set_error(json_sax_parser_t* parser, const char* message)
+{
+	if (parser->error == NULL) {
+		parser->error = malloc(256);
+		if (parser->error) {
+			snprintf(parser->error, 256, "%s at position %zu", message, parser->offset + parser->pos);
+		}
+	}
+}
+
+// Makes at least needed bytes available at pos; returns 0 at the end of input
+static int sax_fill(json_sax_parser_t* parser, size_t needed)
+{
+	if (parser->len - parser->pos >= needed) {
+		return 1;
+	}
+	if (!parser->file) {
+		return 0;
+	}
+
+	// The unread tail may be the start of a token, keep it
+	size_t tail = parser->len - parser->pos;
+	if (parser->pos > 0) {
+		memmove(parser->buffer, parser->buffer + parser->pos, tail);
+		parser->offset += parser->pos;
+		parser->pos = 0;
+		parser->len = tail;
+	}
+
+	if (parser->buffer_capacity < needed || parser->buffer_capacity - tail < JSON_SAX_CHUNK_SIZE / 2) {
+		size_t new_capacity = parser->buffer_capacity ? parser->buffer_capacity * 2 : JSON_SAX_CHUNK_SIZE;
+		while (new_capacity < needed) {
+			new_capacity *= 2;
+		}
+
+		char* new_buffer = realloc(parser->buffer, new_capacity);
+		if (!new_buffer) {
+			sax_set_error(parser, "Out of memory");
+			return 0;
+		}
+		parser->buffer = new_buffer;
+		parser->buffer_capacity = new_capacity;
+	}
+	parser->json = parser->buffer;
+
+	while (parser->len < needed) {
+		size_t read = fread(parser->buffer + parser->len, 1, parser->buffer_capacity - parser->len, parser->file);
+		if (read == 0) {
+			return 0;
+		}
+		parser->len += read;
+	}
+	return 1;
+}
+
+static char sax_peek(json_sax_parser_t* parser)
+{
+	return sax_fill(parser, 1) ? parser->json[parser->pos] : '\0';
+}
+
+static void sax_skip_whitespace(json_sax_parser_t* parser)
+{
+	for (;;) {
+		while (parser->pos < parser->len &&
+			json_char_class[(unsigned char)parser->json[parser->pos]] == JSON_CLASS_WHITESPACE) {
+			parser->pos++;
+		}
+		if (parser->pos < parser->len || !sax_fill(parser, 1)) {
+			return;
+		}
+	}
+}
+
+static int sax_at_value_end(json_sax_parser_t* parser)
+{
+	return !sax_fill(parser, 1) || json_char_class[(unsigned char)parser->json[parser->pos]] != 0;
+}
+
+static int sax_push(json_sax_parser_t* parser, int is_object)
+{
+	if (parser->depth == parser->stack_capacity * 8) {
+		size_t new_capacity = parser->stack_capacity ? parser->stack_capacity * 2 : JSON_SAX_STACK_INIT_SIZE / 8;
+		uint8_t* new_stack = realloc(parser->stack, new_capacity);
+		if (!new_stack) {
+			sax_set_error(parser, "Out of memory");
+			return 0;
+		}
+		parser->stack = new_stack;
+		parser->stack_capacity = new_capacity;
+	}
+
+	uint8_t bit = (uint8_t)(1u << (parser->depth % 8));
+	if (is_object) {
+		parser->stack[parser->depth / 8] |= bit;
+	} else {
+		parser->stack[parser->depth / 8] &= (uint8_t)~bit;
+	}
+	parser->depth++;
+	return 1;
+}
+
+static int sax_in_object(const json_sax_parser_t* parser)
+{
+	size_t top = parser->depth - 1;
+	return (parser->stack[top / 8] >> (top % 8)) & 1;
+}
+
+// Reads the string at pos into scratch; returns its decoded length or
+// JSON_INVALID_ESCAPE after setting an error
+static size_t sax_read_string(json_sax_parser_t* parser)
+{
+	parser->pos++;
+
+	// Offsets are relative to pos because refilling moves the window
+	size_t end = 0;
+	int escaped = 0;
+	for (;;) {
+		if (!sax_fill(parser, end + 1)) {
+			parser->pos += end;
+			sax_set_error(parser, "Untermitated string");
+			return JSON_INVALID_ESCAPE;
+		}
+
+		const char* src = parser->json + parser->pos;
+		size_t available = parser->len - parser->pos;
+		end += string_run_length(src + end, available - end);
+		if (end == available) {
+			continue;
+		}
+		if (src[end] == '"') {
+			break;
+		}
+
+		// Keep the escaped byte in the window with its backslash
+		escaped = 1;
+		if (!sax_fill(parser, end + 2)) {
+			parser->pos += end;
+			sax_set_error(parser, "Untermitated string");
+			return JSON_INVALID_ESCAPE;
+		}
+		end += 2;
+	}
+
+	if (end + 1 > parser->scratch_capacity) {
+		size_t new_capacity = parser->scratch_capacity ? parser->scratch_capacity : 256;
+		while (new_capacity < end + 1) {
+			new_capacity *= 2;
+		}
+
+		char* new_scratch = realloc(parser->scratch, new_capacity);
+		if (!new_scratch) {
+			sax_set_error(parser, "Out of memory");
+			return JSON_INVALID_ESCAPE;
+		}
+		parser->scratch = new_scratch;
+		parser->scratch_capacity = new_capacity;
+	}
+
+	const char* src = parser->json + parser->pos;
+	size_t length = end;
+	if (escaped) {
+		length = unescape_string(parser->scratch, src, end);
+		if (length == JSON_INVALID_ESCAPE) {
+			sax_set_error(parser, "Invalid escape sequence");
+			return JSON_INVALID_ESCAPE;
+		}
+	}
+	else {
+		memcpy(parser->scratch, src, end);
+	}
+
+	parser->scratch[length] = '\0';
+	parser->pos += end + 1;
+	return length;
+}
+
+static int sax_match_literal(json_sax_parser_t* parser, const char* literal, size_t length)
+{
+	if (!sax_fill(parser, length) || memcmp(parser->json + parser->pos, literal, length) != 0) {
+		return 0;
+	}
+
+	parser->pos += length;
+	return sax_at_value_end(parser);
+}
+
+static int sax_parse_number(json_sax_parser_t* parser)
+{
+	// Gather the characters a number can contain, the grammar is checked below
+	size_t end = 0;
+	for (;;) {
+		if (!sax_fill(parser, end + 1)) {
+			break;
+		}
+		char c = parser->json[parser->pos + end];
+		if ((c < '0' || c > '9') && c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E') {
+			break;
+		}
+		end++;
+	}
+
+	json_number_t number;
+	size_t consumed = parse_json_number(parser->json + parser->pos, end, &number);
+	if (consumed == 0) {
+		sax_set_error(parser, "Expected number");
+		return 0;
+	}
+
+	parser->pos += consumed;
+	if (consumed != end || !sax_at_value_end(parser)) {
+		sax_set_error(parser, "Invalid number");
+		return 0;
+	}
+
+	const json_sax_handler_t* handler = parser->handler;
+	return !handler->on_number || handler->on_number(parser->ctx, &number);
+}
+
+// Parses a key and its colon
+static int sax_parse_key(json_sax_parser_t* parser)
+{
+	sax_skip_whitespace(parser);
+	if (sax_peek(parser) != '"') {
+		sax_set_error(parser, "Expected string key");
+		return 0;
+	}
+
+	size_t length = sax_read_string(parser);
+	if (length == JSON_INVALID_ESCAPE) {
+		return 0;
+	}
+
+	const json_sax_handler_t* handler = parser->handler;
+	if (handler->on_key && !handler->on_key(parser->ctx, parser->scratch, length)) {
+		return 0;
+	}
+
+	sax_skip_whitespace(parser);
+	if (sax_peek(parser) != ':') {
+		sax_set_error(parser, "Expected ':' after key");
+		return 0;
+	}
+	parser->pos++;
+	return 1;
+}
+
+#define SAX_PARSE_ERROR -1
+#define SAX_VALUE_DONE 0
+#define SAX_VALUE_OPENED 1
+
+// Parses a scalar or opens a container; an opened container has consumed
+// its first key, so a value is expected next either way
+static int sax_parse_value(json_sax_parser_t* parser)
+{
+	const json_sax_handler_t* handler = parser->handler;
+	void* ctx = parser->ctx;
+
+	sax_skip_whitespace(parser);
+	if (!sax_fill(parser, 1)) {
+		sax_set_error(parser, "Unexpected end of input");
+		return SAX_PARSE_ERROR;
+	}
+
+	switch (parser->json[parser->pos]) {
+	case '{':
+		parser->pos++;
+		if (handler->on_start_object && !handler->on_start_object(ctx)) {
+			return SAX_PARSE_ERROR;
+		}
+		sax_skip_whitespace(parser);
+		if (sax_peek(parser) == '}') {
+			parser->pos++;
+			return !handler->on_end_object || handler->on_end_object(ctx) ? SAX_VALUE_DONE : SAX_PARSE_ERROR;
+		}
+		if (!sax_push(parser, 1) || !sax_parse_key(parser)) {
+			return SAX_PARSE_ERROR;
+		}
+		return SAX_VALUE_OPENED;
+	case '[':
+		parser->pos++;
+		if (handler->on_start_array && !handler->on_start_array(ctx)) {
+			return SAX_PARSE_ERROR;
+		}
+		sax_skip_whitespace(parser);
+		if (sax_peek(parser) == ']') {
+			parser->pos++;
+			return !handler->on_end_array || handler->on_end_array(ctx) ? SAX_VALUE_DONE : SAX_PARSE_ERROR;
+		}
+		return sax_push(parser, 0) ? SAX_VALUE_OPENED : SAX_PARSE_ERROR;
+	case '"': {
+		size_t length = sax_read_string(parser);
+		if (length == JSON_INVALID_ESCAPE ||
+			(handler->on_string && !handler->on_string(ctx, parser->scratch, length))) {
+			return SAX_PARSE_ERROR;
+		}
+		return SAX_VALUE_DONE;
+	}
+	case 't':
+	case 'f': {
+		int value = parser->json[parser->pos] == 't';
+		if (!sax_match_literal(parser, value ? "true" : "false", value ? 4 : 5)) {
+			sax_set_error(parser, "Expected 'true' or 'false'");
+			return SAX_PARSE_ERROR;
+		}
+		return !handler->on_bool || handler->on_bool(ctx, value) ? SAX_VALUE_DONE : SAX_PARSE_ERROR;
+	}
+	case 'n':
+		if (!sax_match_literal(parser, "null", 4)) {
+			sax_set_error(parser, "Expected 'null'");
+			return SAX_PARSE_ERROR;
+		}
+		return !handler->on_null || handler->on_null(ctx) ? SAX_VALUE_DONE : SAX_PARSE_ERROR;
+	default: {
+		char c = parser->json[parser->pos];
+		if (c == '-' || (c >= '0' && c <= '9')) {
+			return sax_parse_number(parser) ? SAX_VALUE_DONE : SAX_PARSE_ERROR;
+		}
+		sax_set_error(parser, "Unexpected character");
+		return SAX_PARSE_ERROR;
+	}
+	}
+}
+
+// Closes the containers that end after a value; returns 1 when the next
+// value of an open container is expected, 0 when the root is complete
+static int sax_close_values(json_sax_parser_t* parser)
+{
+	const json_sax_handler_t* handler = parser->handler;
+
+	while (parser->depth > 0) {
+		sax_skip_whitespace(parser);
+		char c = sax_peek(parser);
+
+		if (sax_in_object(parser)) {
+			if (c == ',') {
+				parser->pos++;
+				return sax_parse_key(parser) ? 1 : SAX_PARSE_ERROR;
+			}
+			if (c != '}') {
+				sax_set_error(parser, "Expected ',' or '}'");
+				return SAX_PARSE_ERROR;
+			}
+			parser->pos++;
+			parser->depth--;
+			if (handler->on_end_object && !handler->on_end_object(parser->ctx)) {
+				return SAX_PARSE_ERROR;
+			}
+		}
+		else {
+			if (c == ',') {
+				parser->pos++;
+				return 1;
+			}
+			if (c != ']') {
+				sax_set_error(parser, "Expected ',' or ']'");
+				return SAX_PARSE_ERROR;
+			}
+			parser->pos++;
+			parser->depth--;
+			if (handler->on_end_array && !handler->on_end_array(parser->ctx)) {
+				return SAX_PARSE_ERROR;
+			}
+		}
+	}
+	return 0;
+}
+
+int sax_parse(json_sax_parser_t* parser)
+{
+	parser->depth = 0;
+
+	// Nesting is tracked on the container stack instead of the call stack
+	for (;;) {
+		int state = sax_parse_value(parser);
+		if (state == SAX_VALUE_DONE) {
+			state = sax_close_values(parser);
+			if (state == 0) {
+				break;
+			}
+		}
+		if (state == SAX_PARSE_ERROR) {
+			return 0;
+		}
+	}
+
+	sax_skip_whitespace(parser);
+	if (sax_fill(parser, 1)) {
+		sax_set_error(parser, "Extra data after JSON");
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,42 @@
+﻿#ifndef MULTIFORMAT_JSON_SAX_H
+#define MULTIFORMAT_JSON_SAX_H
+
+#include "../core/data_types.h"
+#include "json_number.h"
+#include "json_stage1.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_SAX_CHUNK_SIZE (64 * 1024)
+#define JSON_SAX_STACK_INIT_SIZE 64
+
+// Event parser over a window of the input. Memory inputs are one window;
+// files are read chunk by chunk and only the token being parsed is kept,
+// so memory stays at O(depth + longest token).
+typedef struct {
+	const json_sax_handler_t* handler;
+	void* ctx;
+	const char* json;
+	size_t pos;
+	size_t len;
+	// Input bytes dropped in front of the window, for error positions
+	size_t offset;
+	FILE* file;
+	char* buffer;
+	size_t buffer_capacity;
+	// Null-terminated copy of the last string or key
+	char* scratch;
+	size_t scratch_capacity;
+	// One bit per open container, set for objects
+	uint8_t* stack;
+	size_t depth;
+	size_t stack_capacity;
+	char* error;
+}json_sax_parser_t;
+
+void sax_parser_init(json_sax_parser_t* parser, const json_sax_handler_t* handler, void* ctx);
+void sax_parser_free(json_sax_parser_t* parser);
+int sax_parse(json_sax_parser_t* parser);
+
+#endif // MULTIFORMAT_JSON_SAX_H
@@ -1,4 +1,21 @@
-﻿#include "json_serializer.h"
+﻿#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "json_serializer.h"
+#include <errno.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <limits.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_SERIALIZER_SSE2 1
+#include <emmintrin.h>
+#endif
 
 
 void serializer_init(json_serializer_t* serializer, int pretty)
@@ -8,50 +25,120 @@ void serializer_init(json_serializer_t* serializer, int pretty)
 	serializer->length = 0;
 	serializer->pretty = pretty;
 	serializer->indent_level = 0;
+	serializer->sink = NULL;
 
 	if (serializer->buffer) {
 		serializer->buffer[0] = '\0';
 	}
 }
 
+void serializer_init_sink(json_serializer_t* serializer, json_sink_t* sink)
+{
+	if (!sink->write && sink->buffer && sink->capacity > 0) {
+		serializer->buffer = sink->buffer;
+		serializer->capacity = sink->capacity;
+	}
+	else {
+		serializer->buffer = serializer->staging;
+		serializer->capacity = sizeof(serializer->staging);
+	}
+	serializer->length = 0;
+	serializer->pretty = sink->pretty;
+	serializer->indent_level = 0;
+	serializer->sink = sink;
+	serializer->buffer[0] = '\0';
+	sink->length = 0;
+}
+
 void serializer_free(json_serializer_t* serializer)
 {
 	if (!serializer)return;
-	if (serializer->buffer) {
+	if (serializer->buffer && !serializer->sink) {
 		free(serializer->buffer);
 	}
 }
 
-int serializer_ensure_capacity(json_serializer_t* serializer, size_t needed)
+int serializer_flush(json_serializer_t* serializer)
 {
-	if (serializer->length + needed + 1 >= serializer->capacity) {
-		size_t new_capacity = serializer->capacity * 2;
-		while (serializer->length + needed + 1 >= new_capacity) {
-			new_capacity *= 2;
-		}
+	json_sink_t* sink = serializer->sink;
+	if (sink->write && serializer->length > 0 && !sink->write(sink->ctx, serializer->buffer, serializer->length)) {
+		return 0;
+	}
 
-		char* new_buffer = realloc(serializer->buffer, new_capacity);
-		if (!new_buffer) {
-			return 0;
-		}
+	// A full caller buffer keeps what it holds and the rest is only counted
+	sink->length += serializer->length;
+	serializer->length = 0;
+	serializer->buffer = serializer->staging;
+	serializer->capacity = sizeof(serializer->staging);
+	serializer->buffer[0] = '\0';
+	return 1;
+}
 
-		serializer->buffer = new_buffer;
-		serializer->capacity = new_capacity;
+int serializer_finish(json_serializer_t* serializer)
+{
+	json_sink_t* sink = serializer->sink;
+	if (serializer->buffer == sink->buffer) {
+		sink->length += serializer->length;
+		return 1;
+	}
+	return serializer_flush(serializer) && (sink->write || !sink->buffer);
+}
+
+// Slow path of serializer_ensure_capacity(): flush to the sink or grow
+static int serializer_make_room(json_serializer_t* serializer, size_t needed)
+{
+	if (serializer->sink) {
+		// Sinks take the output a buffer at a time, so needed has to fit the
+		// staging buffer; longer pieces go through serializer_append_n()
+		return serializer_flush(serializer) && needed < serializer->capacity;
+	}
+
+	size_t new_capacity = serializer->capacity * 2;
+	while (serializer->length + needed + 1 >= new_capacity) {
+		new_capacity *= 2;
+	}
+
+	char* new_buffer = realloc(serializer->buffer, new_capacity);
+	if (!new_buffer) {
+		return 0;
 	}
+
+	serializer->buffer = new_buffer;
+	serializer->capacity = new_capacity;
 	return 1;
 }
 
+int serializer_ensure_capacity(json_serializer_t* serializer, size_t needed)
+{
+	return serializer->length + needed < serializer->capacity || serializer_make_room(serializer, needed);
+}
+
 int serializer_append(json_serializer_t* serializer, const char* str)
 {
-	size_t len = strlen(str);
-	if (!serializer_ensure_capacity(serializer, len)) {
+	return serializer_append_n(serializer, str, strlen(str));
+}
+
+int serializer_append_n(json_serializer_t* serializer, const char* str, size_t length)
+{
+	while (serializer->length + length >= serializer->capacity && serializer->sink) {
+		size_t room = serializer->capacity - serializer->length - 1;
+		memcpy(serializer->buffer + serializer->length, str, room);
+		serializer->length += room;
+		serializer->buffer[serializer->length] = '\0';
+		str += room;
+		length -= room;
+		if (!serializer_flush(serializer)) {
+			return 0;
+		}
+	}
+
+	if (!serializer_ensure_capacity(serializer, length)) {
 		return 0;
 	}
 
-	memcpy(serializer->buffer + serializer->length, str, len);
-	serializer->length += len;
+	memcpy(serializer->buffer + serializer->length, str, length);
+	serializer->length += length;
 	serializer->buffer[serializer->length] = '\0';
-	
 	return 1;
 }
 
@@ -59,15 +146,16 @@ int serializer_append_indent(json_serializer_t* serializer)
 {
 	if (!serializer->pretty)return 1;
 
-	int indent_spaces = serializer->indent_level * JSON_INDENT_SIZE;
-	if (!serializer_ensure_capacity(serializer, indent_spaces + 1)) {
-		return 0;
-	}
+	static const char spaces[] = "                                ";
 
-	for (int i = 0; i < indent_spaces; i++) {
-		serializer->buffer[serializer->length++] = ' ';
+	size_t indent_spaces = (size_t)serializer->indent_level * JSON_INDENT_SIZE;
+	while (indent_spaces > 0) {
+		size_t chunk = indent_spaces < sizeof(spaces) - 1 ? indent_spaces : sizeof(spaces) - 1;
+		if (!serializer_append_n(serializer, spaces, chunk)) {
+			return 0;
+		}
+		indent_spaces -= chunk;
 	}
-	serializer->buffer[serializer->length] = '\0';
 	return 1;
 }
 
@@ -82,74 +170,127 @@ int serializer_append_char(json_serializer_t* serializer, char c)
 	return 1;
 }
 
-char* escape_string(const char* str)
+// Length of the run before the first byte that has to be escaped: a quote,
+// a backslash or a control character
+static size_t escape_run_length(const char* str, size_t length)
 {
-	if (!str) return NULL;
-
-	size_t len = strlen(str);
-	size_t escaped_len = 0;
-
-	for (size_t i = 0; i < len; i++) {
-		switch (str[i]) {
-		case '"':  escaped_len += 2; break;  // \"
-		case '\\': escaped_len += 2; break;  // 
-		case '\b': escaped_len += 2; break;  // \b
-		case '\f': escaped_len += 2; break;  // \f
-		case '\n': escaped_len += 2; break;  // \n
-		case '\r': escaped_len += 2; break;  // \r
-		case '\t': escaped_len += 2; break;  // \t
-		default:
-			if ((unsigned char)str[i] < 0x20) {
-				escaped_len += 6; // \uXXXX
-			}
-			else {
-				escaped_len += 1;
-			}
+	size_t i = 0;
+#ifdef JSON_SERIALIZER_SSE2
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control = _mm_set1_epi8(0x1F);
+	for (; i + 16 <= length; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(str + i));
+		__m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+			_mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+		unsigned mask = (unsigned)_mm_movemask_epi8(special);
+		if (mask) {
+			return i + (size_t)stage1_trailing_zeros(mask);
+		}
+	}
+#endif
+	while (i < length && str[i] != '"' && str[i] != '\\' && (unsigned char)str[i] >= 0x20) {
+		i++;
+	}
+	return i;
+}
+
+// Writes the escape sequence for c and returns its length
+static size_t write_escape(char* out, char c)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	out[0] = '\\';
+	switch (c) {
+	case '"':  out[1] = '"';  return 2;
+	case '\\': out[1] = '\\'; return 2;
+	case '\b': out[1] = 'b';  return 2;
+	case '\f': out[1] = 'f';  return 2;
+	case '\n': out[1] = 'n';  return 2;
+	case '\r': out[1] = 'r';  return 2;
+	case '\t': out[1] = 't';  return 2;
+	default:
+		// Other control characters as \u00XX
+		out[1] = 'u';
+		out[2] = '0';
+		out[3] = '0';
+		out[4] = hex[(unsigned char)c >> 4];
+		out[5] = hex[(unsigned char)c & 0x0F];
+		return 6;
+	}
+}
+
+// Sink version of serializer_append_string(), which passes long strings on
+// in pieces rather than reserving room for all of them
+static int append_string_to_sink(json_serializer_t* serializer, const char* str, size_t length)
+{
+	if (!serializer_append_char(serializer, '"')) {
+		return 0;
+	}
+
+	size_t i = 0;
+	for (;;) {
+		size_t run = escape_run_length(str + i, length - i);
+		if (!serializer_append_n(serializer, str + i, run)) {
+			return 0;
+		}
+		i += run;
+		if (i == length) {
 			break;
 		}
+
+		char escape[6];
+		if (!serializer_append_n(serializer, escape, write_escape(escape, str[i]))) {
+			return 0;
+		}
+		i++;
 	}
 
-	char* escaped = malloc(escaped_len + 1);
-	if (!escaped) return NULL;
-
-	size_t pos = 0;
-	for (size_t i = 0; i < len; i++) {
-		switch (str[i]) {
-		case '"':
-			escaped[pos++] = '\\'; escaped[pos++] = '"'; break;
-		case '\\':
-			escaped[pos++] = '\\'; escaped[pos++] = '\\'; break;
-		case '\b':
-			escaped[pos++] = '\\'; escaped[pos++] = 'b'; break;
-		case '\f':
-			escaped[pos++] = '\\'; escaped[pos++] = 'f'; break;
-		case '\n':
-			escaped[pos++] = '\\'; escaped[pos++] = 'n'; break;
-		case '\r':
-			escaped[pos++] = '\\'; escaped[pos++] = 'r'; break;
-		case '\t':
-			escaped[pos++] = '\\'; escaped[pos++] = 't'; break;
-		default:
-			if ((unsigned char)str[i] < 0x20) {
-				// Управляющие символы - экранируем как \u00XX
-				snprintf(escaped + pos, 7, "\\u%04x", (unsigned char)str[i]);
-				pos += 6;
-			}
-			else {
-				escaped[pos++] = str[i];
-			}
+	return serializer_append_char(serializer, '"');
+}
+
+int serializer_append_string(json_serializer_t* serializer, const char* str)
+{
+	size_t length = strlen(str);
+	if (serializer->sink) {
+		return append_string_to_sink(serializer, str, length);
+	}
+
+	// Enough for the usual case of a string with nothing to escape
+	if (!serializer_ensure_capacity(serializer, length + 2)) {
+		return 0;
+	}
+	serializer->buffer[serializer->length++] = '"';
+
+	size_t i = 0;
+	for (;;) {
+		size_t run = escape_run_length(str + i, length - i);
+		memcpy(serializer->buffer + serializer->length, str + i, run);
+		serializer->length += run;
+		i += run;
+		if (i == length) {
 			break;
 		}
+
+		// The escape, the rest of the string and the closing quote
+		if (!serializer_ensure_capacity(serializer, 6 + (length - i - 1) + 1)) {
+			return 0;
+		}
+		serializer->length += write_escape(serializer->buffer + serializer->length, str[i]);
+		i++;
 	}
-	escaped[pos] = '\0';
-	return escaped;
+
+	serializer->buffer[serializer->length++] = '"';
+	serializer->buffer[serializer->length] = '\0';
+	return 1;
 }
 
 int serialize_value(json_serializer_t* serializer, const json_value_t* value)
 {
 	if (!value) return serialize_null(serializer);
 
-	switch (value->type) {
+	switch (value_type(value)) {
 	case JSON_NULL:
 		return serialize_null(serializer);
 	case JSON_BOOL:
@@ -177,43 +318,45 @@ int serialize_boolean(json_serializer_t* serializer, const json_value_t* value)
 	return serializer_append(serializer, value->data.boolean ? "true" : "false");
 }
 
-int serialize_number(json_serializer_t* serializer, const json_value_t* value)
+int serializer_append_number(json_serializer_t* serializer, const json_number_t* number)
 {
-	char* buffer[64];
-
-	double num = value->data.number;
-	if (num == (long long)num) {
-		snprintf(buffer, sizeof(buffer), "%lld", (long long)num);
+	// Formatted aside so a caller buffer is filled right up to its end
+	if (serializer->sink) {
+		char digits[JSON_NUMBER_MAX_CHARS];
+		return serializer_append_n(serializer, digits, format_json_number(number, digits));
 	}
-	else {
-		snprintf(buffer, sizeof(buffer), "%.15g", num);
+
+	if (!serializer_ensure_capacity(serializer, JSON_NUMBER_MAX_CHARS)) {
+		return 0;
 	}
-	return serializer_append(serializer, buffer);
+
+	serializer->length += format_json_number(number, serializer->buffer + serializer->length);
+	serializer->buffer[serializer->length] = '\0';
+	return 1;
 }
 
-int serialize_string(json_serializer_t* serializer, const json_value_t* value)
+int serialize_number(json_serializer_t* serializer, const json_value_t* value)
 {
-	char* escaped = escape_string(value->data.string);
-	if (!escaped) return 0;
-
-	int result = serializer_append_char(serializer, '"') &&
-		serializer_append(serializer, escaped) &&
-		serializer_append_char(serializer, '"');
+	json_number_t number = value_number(value);
+	return serializer_append_number(serializer, &number);
+}
 
-	free(escaped);
-	return result;
+int serialize_string(json_serializer_t* serializer, const json_value_t* value)
+{
+	return serializer_append_string(serializer, value_string(value));
 }
 
 int serialize_array(json_serializer_t* serializer, const json_value_t* value)
 {
+	const json_array_t* array = value->data.array;
 	if (!serializer_append_char(serializer, '[')) return 0;
 
-	if (serializer->pretty && value->data.array.count > 0) {
+	if (serializer->pretty && array->count > 0) {
 		serializer->indent_level++;
 		if (!serializer_append_char(serializer, '\n')) return 0;
 	}
 
-	for (size_t i = 0; i < value->data.array.count; i++) {
+	for (size_t i = 0; i < array->count; i++) {
 		if (i > 0) {
 			if (!serializer_append_char(serializer, ',')) return 0;
 			if (serializer->pretty) {
@@ -225,12 +368,12 @@ int serialize_array(json_serializer_t* serializer, const json_value_t* value)
 			if (!serializer_append_indent(serializer)) return 0;
 		}
 
-		if (!serialize_value(serializer, value->data.array.values[i])) {
+		if (!serialize_value(serializer, array->values[i])) {
 			return 0;
 		}
 	}
 
-	if (serializer->pretty && value->data.array.count > 0) {
+	if (serializer->pretty && array->count > 0) {
 		serializer->indent_level--;
 		if (!serializer_append_char(serializer, '\n')) return 0;
 		if (!serializer_append_indent(serializer)) return 0;
@@ -241,14 +384,15 @@ int serialize_array(json_serializer_t* serializer, const json_value_t* value)
 
 int serialize_object(json_serializer_t* serializer, const json_value_t* value)
 {
+	const json_object_t* object = value->data.object;
 	if (!serializer_append_char(serializer, '{')) return 0;
 
-	if (serializer->pretty && value->data.object.count > 0) {
+	if (serializer->pretty && object->count > 0) {
 		serializer->indent_level++;
 		if (!serializer_append_char(serializer, '\n')) return 0;
 	}
 
-	for (size_t i = 0; i < value->data.object.count; i++) {
+	for (size_t i = 0; i < object->count; i++) {
 		if (i > 0) {
 			if (!serializer_append_char(serializer, ',')) return 0;
 			if (serializer->pretty) {
@@ -261,16 +405,7 @@ int serialize_object(json_serializer_t* serializer, const json_value_t* value)
 		}
 
 		// Ключ
-		char* escaped_key = escape_string(value->data.object.entries[i].key);
-		if (!escaped_key) return 0;
-
-		if (!serializer_append_char(serializer, '"') ||
-			!serializer_append(serializer, escaped_key) ||
-			!serializer_append_char(serializer, '"')) {
-			free(escaped_key);
-			return 0;
-		}
-		free(escaped_key);
+		if (!serializer_append_string(serializer, object->entries[i].key)) return 0;
 
 		if (serializer->pretty) {
 			if (!serializer_append(serializer, ": ")) return 0;
@@ -280,12 +415,12 @@ int serialize_object(json_serializer_t* serializer, const json_value_t* value)
 		}
 
 		// Значение
-		if (!serialize_value(serializer, value->data.object.entries[i].value)) {
+		if (!serialize_value(serializer, object->entries[i].value)) {
 			return 0;
 		}
 	}
 
-	if (serializer->pretty && value->data.object.count > 0) {
+	if (serializer->pretty && object->count > 0) {
 		serializer->indent_level--;
 		if (!serializer_append_char(serializer, '\n')) return 0;
 		if (!serializer_append_indent(serializer)) return 0;
@@ -294,18 +429,26 @@ int serialize_object(json_serializer_t* serializer, const json_value_t* value)
 	return serializer_append_char(serializer, '}');
 }
 
+int sink_write_file(void* ctx, const char* data, size_t length)
+{
+	return fwrite(data, 1, length, (FILE*)ctx) == length;
+}
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+int sink_write_fd(void* ctx, const char* data, size_t length)
+{
+	int fd = (int)(intptr_t)ctx;
+	while (length > 0) {
+#ifdef _WIN32
+		int written = _write(fd, data, length > INT_MAX ? INT_MAX : (unsigned)length);
+#else
+		ssize_t written = write(fd, data, length);
+#endif
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			return 0;
+		}
+		data += written;
+		length -= (size_t)written;
+	}
+	return 1;
+}
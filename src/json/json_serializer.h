@@ -2,13 +2,19 @@
 #define MULTIFORMAT_JSON_SERIALIZER_H
 
 #include "../core/data_types.h"
+#include "json_number.h"
+#include "json_stage1.h"
+#include "json_value.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <inttypes.h>
 
 #define JSON_SERIALIZER_INIT_SIZE 256
 #define JSON_INDENT_SIZE 2
+// Output a sink receives per flush, see serializer_init_sink()
+#define JSON_SERIALIZER_STAGING_SIZE (16 * 1024)
 
 typedef struct {
 	char* buffer;
@@ -16,16 +22,31 @@ typedef struct {
 	size_t capacity;
 	int pretty;
 	int indent_level;
+	// Where full buffers go; without a sink the buffer grows on the heap
+	json_sink_t* sink;
+	char staging[JSON_SERIALIZER_STAGING_SIZE];
 }json_serializer_t;
 
 
 void serializer_init(json_serializer_t* serializer, int pretty);
+// Writes into the sink's own buffer, or stages output and passes it to the
+// sink's callback one full buffer at a time. With neither the output is only
+// counted, as it is past the end of a caller buffer that fills up.
+void serializer_init_sink(json_serializer_t* serializer, json_sink_t* sink);
 void serializer_free(json_serializer_t* serializer);
+// Hands everything buffered to the sink and empties the buffer
+int serializer_flush(json_serializer_t* serializer);
+// Final flush; fails when the output did not fit a caller buffer
+int serializer_finish(json_serializer_t* serializer);
 int serializer_ensure_capacity(json_serializer_t* serializer, size_t needed);
 int serializer_append(json_serializer_t* serializer, const char* str);
+int serializer_append_n(json_serializer_t* serializer, const char* str, size_t length);
 int serializer_append_indent(json_serializer_t* serializer);
 int serializer_append_char(json_serializer_t* serializer, char c);
-char* escape_string(const char* str);
+// Appends str as a quoted JSON string, escaping straight into the buffer
+int serializer_append_string(json_serializer_t* serializer, const char* str);
+// Appends a short text that reads back as number, see format_json_number()
+int serializer_append_number(json_serializer_t* serializer, const json_number_t* number);
 int serialize_value(json_serializer_t* serializer, const json_value_t* value);
 int serialize_null(json_serializer_t* serializer);
 int serialize_boolean(json_serializer_t* serializer, const json_value_t* value);
@@ -34,6 +55,10 @@ int serialize_string(json_serializer_t* serializer, const json_value_t* value);
 int serialize_array(json_serializer_t* serializer, const json_value_t* value);
 int serialize_object(json_serializer_t* serializer, const json_value_t* value);
 
+// Callbacks behind json_sink_file() and json_sink_fd()
+int sink_write_file(void* ctx, const char* data, size_t length);
+int sink_write_fd(void* ctx, const char* data, size_t length);
+
 
 
 #endif // MILTIFORMAT_JSON_SERIALIZER_H
\ No newline at end of file
@@ -0,0 +1,313 @@
+﻿#include "json_stage1.h"
+#include "json_pool.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_STAGE1_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(JSON_STAGE1_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define JSON_STAGE1_AVX2 1
+#include <immintrin.h>
+#endif
+
+const uint8_t json_char_class[256] = {
+	['\t'] = JSON_CLASS_WHITESPACE, ['\n'] = JSON_CLASS_WHITESPACE,
+	['\r'] = JSON_CLASS_WHITESPACE, [' '] = JSON_CLASS_WHITESPACE,
+	['{'] = JSON_CLASS_OP, ['}'] = JSON_CLASS_OP,
+	['['] = JSON_CLASS_OP, [']'] = JSON_CLASS_OP,
+	[':'] = JSON_CLASS_OP, [','] = JSON_CLASS_OP,
+};
+
+#if !defined(JSON_STAGE1_SSE2)
+static void classify_block_scalar(const uint8_t* block, json_block_masks_t* masks)
+{
+	uint64_t quote = 0, backslash = 0, op = 0, whitespace = 0;
+
+	for (int i = 0; i < JSON_STAGE1_BLOCK_SIZE; i++) {
+		uint64_t bit = (uint64_t)1 << i;
+		uint8_t c = block[i];
+		uint8_t cls = json_char_class[c];
+
+		if (c == '"') quote |= bit;
+		if (c == '\\') backslash |= bit;
+		if (cls == JSON_CLASS_OP) op |= bit;
+		if (cls == JSON_CLASS_WHITESPACE) whitespace |= bit;
+	}
+
+	masks->quote = quote;
+	masks->backslash = backslash;
+	masks->op = op;
+	masks->whitespace = whitespace;
+}
+#endif
+
+#ifdef JSON_STAGE1_SSE2
+static void classify_block_sse2(const uint8_t* block, json_block_masks_t* masks)
+{
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i lower_bit = _mm_set1_epi8(0x20);
+	const __m128i open_brace = _mm_set1_epi8('{');
+	const __m128i close_brace = _mm_set1_epi8('}');
+	const __m128i colon = _mm_set1_epi8(':');
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i carriage = _mm_set1_epi8('\r');
+
+	uint64_t q = 0, b = 0, o = 0, w = 0;
+
+	for (int i = 0; i < 4; i++) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(block + i * 16));
+		// '[' and ']' differ from '{' and '}' only in bit 0x20
+		__m128i folded = _mm_or_si128(chunk, lower_bit);
+
+		__m128i ops = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(folded, open_brace), _mm_cmpeq_epi8(folded, close_brace)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, comma)));
+		__m128i spaces = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage)));
+
+		int shift = i * 16;
+		q |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)) << shift;
+		b |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)) << shift;
+		o |= (uint64_t)(uint16_t)_mm_movemask_epi8(ops) << shift;
+		w |= (uint64_t)(uint16_t)_mm_movemask_epi8(spaces) << shift;
+	}
+
+	masks->quote = q;
+	masks->backslash = b;
+	masks->op = o;
+	masks->whitespace = w;
+}
+#endif
+
+#ifdef JSON_STAGE1_AVX2
+__attribute__((target("avx2")))
+static void classify_block_avx2(const uint8_t* block, json_block_masks_t* masks)
+{
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i lower_bit = _mm256_set1_epi8(0x20);
+	const __m256i open_brace = _mm256_set1_epi8('{');
+	const __m256i close_brace = _mm256_set1_epi8('}');
+	const __m256i colon = _mm256_set1_epi8(':');
+	const __m256i comma = _mm256_set1_epi8(',');
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i carriage = _mm256_set1_epi8('\r');
+
+	uint64_t q = 0, b = 0, o = 0, w = 0;
+
+	for (int i = 0; i < 2; i++) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i*)(block + i * 32));
+		__m256i folded = _mm256_or_si256(chunk, lower_bit);
+
+		__m256i ops = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(folded, open_brace), _mm256_cmpeq_epi8(folded, close_brace)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, colon), _mm256_cmpeq_epi8(chunk, comma)));
+		__m256i spaces = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, carriage)));
+
+		int shift = i * 32;
+		q |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote)) << shift;
+		b |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslash)) << shift;
+		o |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ops) << shift;
+		w |= (uint64_t)(uint32_t)_mm256_movemask_epi8(spaces) << shift;
+	}
+
+	masks->quote = q;
+	masks->backslash = b;
+	masks->op = o;
+	masks->whitespace = w;
+}
+#endif
+
+typedef void (*classify_block_fn)(const uint8_t* block, json_block_masks_t* masks);
+
+static classify_block_fn select_classifier(void)
+{
+#if defined(JSON_STAGE1_AVX2)
+	if (__builtin_cpu_supports("avx2")) {
+		return classify_block_avx2;
+	}
+#endif
+#if defined(JSON_STAGE1_SSE2)
+	return classify_block_sse2;
+#else
+	return classify_block_scalar;
+#endif
+}
+
+// Picked on first use. Worker threads may race to pick it; they all store the
+// same function, and the atomic keeps that well defined. On x86 the load is
+// a plain move, so the check costs nothing per block.
+static _Atomic(classify_block_fn) block_classifier = NULL;
+
+void stage1_classify_block(const uint8_t* block, json_block_masks_t* masks)
+{
+	classify_block_fn classify = atomic_load_explicit(&block_classifier, memory_order_acquire);
+	if (!classify) {
+		classify = select_classifier();
+		atomic_store_explicit(&block_classifier, classify, memory_order_release);
+	}
+	classify(block, masks);
+}
+
+void stage1_state_init(json_stage1_state_t* state)
+{
+	state->escaped = 0;
+	state->in_string = 0;
+	// The first byte of the input starts a token
+	state->follows_boundary = 1;
+}
+
+// Bits of the characters preceded by an odd run of backslashes.
+// Escapes are rare, so a walk over the backslash bits is cheap enough.
+static uint64_t find_escaped(uint64_t backslash, uint64_t* carry)
+{
+	uint64_t escaped = *carry;
+	uint64_t escapers = backslash & ~escaped;
+
+	*carry = 0;
+	while (escapers) {
+		int i = stage1_trailing_zeros(escapers);
+		escapers &= escapers - 1;
+		if (i == 63) {
+			*carry = 1;
+			break;
+		}
+		uint64_t next = (uint64_t)1 << (i + 1);
+		escaped |= next;
+		escapers &= ~next;
+	}
+	return escaped;
+}
+
+uint64_t stage1_structurals(const json_block_masks_t* masks, json_stage1_state_t* state)
+{
+	uint64_t escaped = 0;
+	if (masks->backslash || state->escaped) {
+		escaped = find_escaped(masks->backslash, &state->escaped);
+	}
+
+	// Opening quotes and string bodies are inside, closing quotes are outside
+	uint64_t quotes = masks->quote & ~escaped;
+	uint64_t in_string = stage1_prefix_xor(quotes) ^ state->in_string;
+	state->in_string = (uint64_t)((int64_t)in_string >> 63);
+
+	uint64_t outside = ~in_string;
+	uint64_t op = masks->op & outside;
+	uint64_t whitespace = masks->whitespace & outside;
+
+	// Scalars (numbers, literals and stray bytes) are indexed by their first byte
+	uint64_t boundary = op | whitespace | (quotes & outside);
+	uint64_t scalar = outside & ~(op | whitespace | quotes);
+	uint64_t follows_boundary = (boundary << 1) | state->follows_boundary;
+	state->follows_boundary = boundary >> 63;
+
+	return op | quotes | (scalar & follows_boundary);
+}
+
+static int index_reserve(json_structural_index_t* index, size_t needed)
+{
+	if (index->count + needed <= index->capacity) {
+		return 1;
+	}
+
+	size_t new_capacity = index->capacity ? index->capacity * 2 : 1024;
+	while (index->count + needed > new_capacity) {
+		new_capacity *= 2;
+	}
+
+	uint32_t* new_positions = pool_realloc(index->positions,
+		sizeof(uint32_t) * index->capacity, sizeof(uint32_t) * new_capacity);
+	if (!new_positions) {
+		return 0;
+	}
+
+	index->positions = new_positions;
+	index->capacity = new_capacity;
+	return 1;
+}
+
+static void flatten_bits(json_structural_index_t* index, uint32_t base, uint64_t bits)
+{
+	uint32_t* out = index->positions + index->count;
+	while (bits) {
+		*out++ = base + (uint32_t)stage1_trailing_zeros(bits);
+		bits &= bits - 1;
+	}
+	index->count = (size_t)(out - index->positions);
+}
+
+int build_structural_index(const char* json, size_t len, json_structural_index_t* index)
+{
+	index->count = 0;
+	index->has_backslash = 0;
+	if (len > JSON_STAGE1_MAX_LENGTH) {
+		return 0;
+	}
+
+	// Structurals are rarely denser than one per four bytes
+	if (!index_reserve(index, len / 4 + JSON_STAGE1_BLOCK_SIZE + 1)) {
+		return 0;
+	}
+
+	json_stage1_state_t state;
+	stage1_state_init(&state);
+
+	json_block_masks_t masks;
+	size_t pos = 0;
+
+	for (; pos + JSON_STAGE1_BLOCK_SIZE <= len; pos += JSON_STAGE1_BLOCK_SIZE) {
+		if (!index_reserve(index, JSON_STAGE1_BLOCK_SIZE)) {
+			return 0;
+		}
+		stage1_classify_block((const uint8_t*)json + pos, &masks);
+		index->has_backslash |= masks.backslash != 0;
+		flatten_bits(index, (uint32_t)pos, stage1_structurals(&masks, &state));
+	}
+
+	if (pos < len) {
+		// Pad the tail with spaces so the last block never reads past the input
+		uint8_t tail[JSON_STAGE1_BLOCK_SIZE];
+		memset(tail, ' ', sizeof(tail));
+		memcpy(tail, json + pos, len - pos);
+
+		if (!index_reserve(index, JSON_STAGE1_BLOCK_SIZE)) {
+			return 0;
+		}
+		stage1_classify_block(tail, &masks);
+		index->has_backslash |= masks.backslash != 0;
+		flatten_bits(index, (uint32_t)pos, stage1_structurals(&masks, &state));
+	}
+
+	// An unterminated string is reported by the parser with its usual message
+	if (state.in_string) {
+		return 0;
+	}
+
+	// Sentinel so that consumers can always look one entry ahead
+	if (!index_reserve(index, 1)) {
+		return 0;
+	}
+	index->positions[index->count] = (uint32_t)len;
+	return 1;
+}
+
+void structural_index_free(json_structural_index_t* index)
+{
+	pool_free(index->positions, sizeof(uint32_t) * index->capacity);
+	index->positions = NULL;
+	index->count = 0;
+	index->capacity = 0;
+}
@@ -0,0 +1,81 @@
+﻿#ifndef MULTIFORMAT_JSON_STAGE1_H
+#define MULTIFORMAT_JSON_STAGE1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#define JSON_STAGE1_BLOCK_SIZE 64
+// Positions are stored as 32-bit offsets; larger inputs use the byte parser
+#define JSON_STAGE1_MAX_LENGTH ((size_t)UINT32_MAX - JSON_STAGE1_BLOCK_SIZE)
+
+#define JSON_CLASS_WHITESPACE 1
+#define JSON_CLASS_OP 2
+
+// JSON_CLASS_* of every byte; everything else is part of a string or scalar
+extern const uint8_t json_char_class[256];
+
+// Character masks of one 64-byte block, bit i describes byte i
+typedef struct {
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t op;
+	uint64_t whitespace;
+}json_block_masks_t;
+
+// State carried from one block to the next
+typedef struct {
+	uint64_t escaped;
+	uint64_t in_string;
+	uint64_t follows_boundary;
+}json_stage1_state_t;
+
+typedef struct {
+	uint32_t* positions;
+	size_t count;
+	size_t capacity;
+	// Set when the input contains a backslash anywhere, so parsers can skip
+	// looking for escapes in every string when it is clear
+	int has_backslash;
+}json_structural_index_t;
+
+void stage1_classify_block(const uint8_t* block, json_block_masks_t* masks);
+void stage1_state_init(json_stage1_state_t* state);
+uint64_t stage1_structurals(const json_block_masks_t* masks, json_stage1_state_t* state);
+int build_structural_index(const char* json, size_t len, json_structural_index_t* index);
+void structural_index_free(json_structural_index_t* index);
+
+static inline int stage1_trailing_zeros(uint64_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#else
+	int n = 0;
+	while (!(bits & 1)) {
+		bits >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+// Bit i is the parity of bits 0..i; turns quote bits into string interiors
+static inline uint64_t stage1_prefix_xor(uint64_t bits)
+{
+	bits ^= bits << 1;
+	bits ^= bits << 2;
+	bits ^= bits << 4;
+	bits ^= bits << 8;
+	bits ^= bits << 16;
+	bits ^= bits << 32;
+	return bits;
+}
+
+#endif // MULTIFORMAT_JSON_STAGE1_H
@@ -0,0 +1,227 @@
+﻿#include "json_tape.h"
+
+#define JSON_TAPE_FRAMES_INIT_SIZE 16
+
+void tape_init(json_tape_t* tape)
+{
+	memset(tape, 0, sizeof(*tape));
+}
+
+void tape_release(json_tape_t* tape)
+{
+	free(tape->words);
+	free(tape->strings);
+	tape_init(tape);
+}
+
+static int tape_reserve_words(json_tape_t* tape, size_t needed)
+{
+	if (needed <= tape->capacity) {
+		return 1;
+	}
+
+	size_t new_capacity = tape->capacity ? tape->capacity : 64;
+	while (new_capacity < needed) {
+		new_capacity *= 2;
+	}
+
+	uint64_t* new_words = realloc(tape->words, sizeof(uint64_t) * new_capacity);
+	if (!new_words) {
+		return 0;
+	}
+	tape->words = new_words;
+	tape->capacity = new_capacity;
+	return 1;
+}
+
+static int tape_reserve_strings(json_tape_t* tape, size_t needed)
+{
+	if (needed <= tape->strings_capacity) {
+		return 1;
+	}
+
+	size_t new_capacity = tape->strings_capacity ? tape->strings_capacity : 256;
+	while (new_capacity < needed) {
+		new_capacity *= 2;
+	}
+
+	char* new_strings = realloc(tape->strings, new_capacity);
+	if (!new_strings) {
+		return 0;
+	}
+	tape->strings = new_strings;
+	tape->strings_capacity = new_capacity;
+	return 1;
+}
+
+static void tape_append(json_tape_t* tape, char tag, uint64_t payload)
+{
+	tape->words[tape->count++] = ((uint64_t)(unsigned char)tag << JSON_TAPE_PAYLOAD_BITS) | payload;
+}
+
+int tape_builder_init(json_tape_builder_t* builder, json_tape_t* tape, size_t input_length)
+{
+	builder->tape = tape;
+	builder->depth = 0;
+	builder->capacity = JSON_TAPE_FRAMES_INIT_SIZE;
+	builder->frames = malloc(sizeof(json_tape_frame_t) * builder->capacity);
+
+	// Every value takes at least two bytes of input, and strings take no
+	// more room than their quoted text plus a length and a terminator
+	return builder->frames &&
+		tape_reserve_words(tape, input_length / 4 + 2) &&
+		tape_reserve_strings(tape, input_length / 2 + 16);
+}
+
+int tape_builder_finish(json_tape_builder_t* builder)
+{
+	free(builder->frames);
+	builder->frames = NULL;
+	return builder->depth == 0 && builder->tape->count > 0;
+}
+
+// Reserves room for a value of the given number of words
+static int tape_begin_value(json_tape_builder_t* builder, size_t words)
+{
+	if (builder->depth > 0) {
+		builder->frames[builder->depth - 1].count++;
+	}
+	return tape_reserve_words(builder->tape, builder->tape->count + words);
+}
+
+static int tape_on_null(void* ctx)
+{
+	json_tape_builder_t* builder = ctx;
+	if (!tape_begin_value(builder, 1)) return 0;
+	tape_append(builder->tape, 'n', 0);
+	return 1;
+}
+
+static int tape_on_bool(void* ctx, int boolean)
+{
+	json_tape_builder_t* builder = ctx;
+	if (!tape_begin_value(builder, 1)) return 0;
+	tape_append(builder->tape, boolean ? 't' : 'f', 0);
+	return 1;
+}
+
+static int tape_on_number(void* ctx, const json_number_t* number)
+{
+	json_tape_builder_t* builder = ctx;
+	if (!tape_begin_value(builder, 2)) return 0;
+
+	json_tape_t* tape = builder->tape;
+	uint64_t raw;
+	switch (number->repr) {
+	case JSON_INTEGER:
+		tape_append(tape, 'l', 0);
+		raw = (uint64_t)number->integer;
+		break;
+	case JSON_UNSIGNED:
+		tape_append(tape, 'u', 0);
+		raw = number->uinteger;
+		break;
+	default:
+		tape_append(tape, 'd', 0);
+		memcpy(&raw, &number->real, sizeof(raw));
+		break;
+	}
+	tape->words[tape->count++] = raw;
+	return 1;
+}
+
+static int tape_add_string(json_tape_t* tape, char tag, const char* string, size_t length)
+{
+	uint64_t stored = length;
+	size_t offset = tape->strings_length;
+	if (!tape_reserve_strings(tape, offset + sizeof(stored) + length + 1)) {
+		return 0;
+	}
+
+	memcpy(tape->strings + offset, &stored, sizeof(stored));
+	memcpy(tape->strings + offset + sizeof(stored), string, length);
+	tape->strings[offset + sizeof(stored) + length] = '\0';
+	tape->strings_length = offset + sizeof(stored) + length + 1;
+
+	tape_append(tape, tag, offset);
+	return 1;
+}
+
+static int tape_on_string(void* ctx, const char* string, size_t length)
+{
+	json_tape_builder_t* builder = ctx;
+	return tape_begin_value(builder, 1) && tape_add_string(builder->tape, '"', string, length);
+}
+
+static int tape_on_key(void* ctx, const char* key, size_t length)
+{
+	json_tape_builder_t* builder = ctx;
+	return tape_reserve_words(builder->tape, builder->tape->count + 1) &&
+		tape_add_string(builder->tape, 'k', key, length);
+}
+
+static int tape_open(json_tape_builder_t* builder, char tag)
+{
+	if (!tape_begin_value(builder, 1)) return 0;
+
+	if (builder->depth == builder->capacity) {
+		size_t new_capacity = builder->capacity * 2;
+		json_tape_frame_t* new_frames = realloc(builder->frames, sizeof(json_tape_frame_t) * new_capacity);
+		if (!new_frames) {
+			return 0;
+		}
+		builder->frames = new_frames;
+		builder->capacity = new_capacity;
+	}
+
+	json_tape_frame_t* frame = &builder->frames[builder->depth++];
+	frame->start = builder->tape->count;
+	frame->count = 0;
+
+	// The end index is patched in when the container closes
+	tape_append(builder->tape, tag, 0);
+	return 1;
+}
+
+static int tape_close(json_tape_builder_t* builder, char tag)
+{
+	json_tape_t* tape = builder->tape;
+	if (!tape_reserve_words(tape, tape->count + 1)) return 0;
+
+	json_tape_frame_t* frame = &builder->frames[--builder->depth];
+	tape_append(tape, tag, frame->count);
+	tape->words[frame->start] |= tape->count;
+	return 1;
+}
+
+static int tape_on_start_object(void* ctx)
+{
+	return tape_open(ctx, '{');
+}
+
+static int tape_on_end_object(void* ctx)
+{
+	return tape_close(ctx, '}');
+}
+
+static int tape_on_start_array(void* ctx)
+{
+	return tape_open(ctx, '[');
+}
+
+static int tape_on_end_array(void* ctx)
+{
+	return tape_close(ctx, ']');
+}
+
+const json_sax_handler_t json_tape_handler = {
+	.on_null = tape_on_null,
+	.on_bool = tape_on_bool,
+	.on_number = tape_on_number,
+	.on_string = tape_on_string,
+	.on_start_object = tape_on_start_object,
+	.on_key = tape_on_key,
+	.on_end_object = tape_on_end_object,
+	.on_start_array = tape_on_start_array,
+	.on_end_array = tape_on_end_array
+};
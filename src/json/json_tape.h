@@ -0,0 +1,86 @@
+﻿#ifndef MULTIFORMAT_JSON_TAPE_H
+#define MULTIFORMAT_JSON_TAPE_H
+
+#include "../core/data_types.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A tape is a flat array of 64-bit words, one or two per value, in document
+// order. The top byte of a word is its tag, the other 56 bits its payload:
+//   'n' 't' 'f'     literals
+//   'l' 'u' 'd'     int64, uint64 and double, the raw value is the next word
+//   '"' 'k'         string value and object key, offset into the strings
+//   '[' '{'         container start, payload is the index after its end word
+//   ']' '}'         container end, payload is the number of elements
+// Strings are stored back to back as a 64-bit length, the bytes and a '\0'.
+#define JSON_TAPE_PAYLOAD_BITS 56
+#define JSON_TAPE_PAYLOAD_MASK ((UINT64_C(1) << JSON_TAPE_PAYLOAD_BITS) - 1)
+
+struct json_tape {
+	uint64_t* words;
+	size_t count;
+	size_t capacity;
+	char* strings;
+	size_t strings_length;
+	size_t strings_capacity;
+};
+
+typedef struct {
+	size_t start;
+	size_t count;
+}json_tape_frame_t;
+
+// SAX handler that appends to a tape, see json_builder.h for the tree version
+typedef struct {
+	json_tape_t* tape;
+	json_tape_frame_t* frames;
+	size_t depth;
+	size_t capacity;
+}json_tape_builder_t;
+
+extern const json_sax_handler_t json_tape_handler;
+
+void tape_init(json_tape_t* tape);
+void tape_release(json_tape_t* tape);
+int tape_builder_init(json_tape_builder_t* builder, json_tape_t* tape, size_t input_length);
+int tape_builder_finish(json_tape_builder_t* builder);
+
+static inline char tape_tag(const json_tape_t* tape, size_t index)
+{
+	return (char)(tape->words[index] >> JSON_TAPE_PAYLOAD_BITS);
+}
+
+static inline uint64_t tape_payload(const json_tape_t* tape, size_t index)
+{
+	return tape->words[index] & JSON_TAPE_PAYLOAD_MASK;
+}
+
+// Index of the word following the value at index
+static inline size_t tape_skip(const json_tape_t* tape, size_t index)
+{
+	switch (tape_tag(tape, index)) {
+	case '[':
+	case '{':
+		return (size_t)tape_payload(tape, index);
+	case 'l':
+	case 'u':
+	case 'd':
+		return index + 2;
+	default:
+		return index + 1;
+	}
+}
+
+static inline const char* tape_string(const json_tape_t* tape, size_t index, size_t* length)
+{
+	const char* entry = tape->strings + tape_payload(tape, index);
+	uint64_t stored;
+	memcpy(&stored, entry, sizeof(stored));
+	if (length) {
+		*length = (size_t)stored;
+	}
+	return entry + sizeof(stored);
+}
+
+#endif // MULTIFORMAT_JSON_TAPE_H
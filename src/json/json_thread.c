@@ -0,0 +1,144 @@
+﻿#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "json_thread.h"
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+typedef struct {
+	json_thread_fn fn;
+	void* arg;
+}thread_start_t;
+
+#ifdef _WIN32
+
+static DWORD WINAPI thread_trampoline(LPVOID param)
+{
+	thread_start_t start = *(thread_start_t*)param;
+	free(param);
+	start.fn(start.arg);
+	return 0;
+}
+
+int thread_create(json_thread_t* thread, json_thread_fn fn, void* arg)
+{
+	thread_start_t* start = malloc(sizeof(thread_start_t));
+	if (!start) return 0;
+
+	start->fn = fn;
+	start->arg = arg;
+	*thread = CreateThread(NULL, 0, thread_trampoline, start, 0, NULL);
+	if (!*thread) {
+		free(start);
+		return 0;
+	}
+	return 1;
+}
+
+void thread_join(json_thread_t thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+size_t thread_hardware_concurrency(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors ? (size_t)info.dwNumberOfProcessors : 1;
+}
+
+void mutex_init(json_mutex_t* mutex) { InitializeCriticalSection(mutex); }
+void mutex_lock(json_mutex_t* mutex) { EnterCriticalSection(mutex); }
+void mutex_unlock(json_mutex_t* mutex) { LeaveCriticalSection(mutex); }
+void mutex_destroy(json_mutex_t* mutex) { DeleteCriticalSection(mutex); }
+
+void cond_init(json_cond_t* cond) { InitializeConditionVariable(cond); }
+void cond_wait(json_cond_t* cond, json_mutex_t* mutex) { SleepConditionVariableCS(cond, mutex, INFINITE); }
+void cond_broadcast(json_cond_t* cond) { WakeAllConditionVariable(cond); }
+void cond_destroy(json_cond_t* cond) { (void)cond; }
+
+static BOOL CALLBACK once_trampoline(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	(void)once;
+	(void)context;
+	(*(void (**)(void))param)();
+	return TRUE;
+}
+
+void thread_once(json_once_t* once, void (*fn)(void))
+{
+	InitOnceExecuteOnce(once, once_trampoline, &fn, NULL);
+}
+
+// Fiber-local storage is used for its destructor; FLS callbacks also run
+// when a plain thread exits
+int tls_key_create(json_tls_key_t* key, json_tls_destructor_t destructor)
+{
+	*key = FlsAlloc(destructor);
+	return *key != FLS_OUT_OF_INDEXES;
+}
+
+void* tls_get(json_tls_key_t key) { return FlsGetValue(key); }
+void tls_set(json_tls_key_t key, void* value) { FlsSetValue(key, value); }
+
+#else
+
+static void* thread_trampoline(void* param)
+{
+	thread_start_t start = *(thread_start_t*)param;
+	free(param);
+	start.fn(start.arg);
+	return NULL;
+}
+
+int thread_create(json_thread_t* thread, json_thread_fn fn, void* arg)
+{
+	thread_start_t* start = malloc(sizeof(thread_start_t));
+	if (!start) return 0;
+
+	start->fn = fn;
+	start->arg = arg;
+	if (pthread_create(thread, NULL, thread_trampoline, start) != 0) {
+		free(start);
+		return 0;
+	}
+	return 1;
+}
+
+void thread_join(json_thread_t thread)
+{
+	pthread_join(thread, NULL);
+}
+
+size_t thread_hardware_concurrency(void)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (size_t)count : 1;
+}
+
+void mutex_init(json_mutex_t* mutex) { pthread_mutex_init(mutex, NULL); }
+void mutex_lock(json_mutex_t* mutex) { pthread_mutex_lock(mutex); }
+void mutex_unlock(json_mutex_t* mutex) { pthread_mutex_unlock(mutex); }
+void mutex_destroy(json_mutex_t* mutex) { pthread_mutex_destroy(mutex); }
+
+void cond_init(json_cond_t* cond) { pthread_cond_init(cond, NULL); }
+void cond_wait(json_cond_t* cond, json_mutex_t* mutex) { pthread_cond_wait(cond, mutex); }
+void cond_broadcast(json_cond_t* cond) { pthread_cond_broadcast(cond); }
+void cond_destroy(json_cond_t* cond) { pthread_cond_destroy(cond); }
+
+void thread_once(json_once_t* once, void (*fn)(void)) { pthread_once(once, fn); }
+
+int tls_key_create(json_tls_key_t* key, json_tls_destructor_t destructor)
+{
+	return pthread_key_create(key, destructor) == 0;
+}
+
+void* tls_get(json_tls_key_t key) { return pthread_getspecific(key); }
+void tls_set(json_tls_key_t key, void* value) { pthread_setspecific(key, value); }
+
+#endif
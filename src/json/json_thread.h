@@ -0,0 +1,54 @@
+﻿#ifndef MULTIFORMAT_JSON_THREAD_H
+#define MULTIFORMAT_JSON_THREAD_H
+
+#include <stddef.h>
+
+// Minimal threading layer over Win32 and POSIX threads
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef HANDLE json_thread_t;
+typedef CRITICAL_SECTION json_mutex_t;
+typedef CONDITION_VARIABLE json_cond_t;
+typedef INIT_ONCE json_once_t;
+typedef DWORD json_tls_key_t;
+#define JSON_ONCE_INIT INIT_ONCE_STATIC_INIT
+#define JSON_TLS_CALLBACK WINAPI
+#else
+#include <pthread.h>
+typedef pthread_t json_thread_t;
+typedef pthread_mutex_t json_mutex_t;
+typedef pthread_cond_t json_cond_t;
+typedef pthread_once_t json_once_t;
+typedef pthread_key_t json_tls_key_t;
+#define JSON_ONCE_INIT PTHREAD_ONCE_INIT
+#define JSON_TLS_CALLBACK
+#endif
+
+typedef void (*json_thread_fn)(void* arg);
+// Runs with the exiting thread's non-NULL value of a thread-local key
+typedef void (JSON_TLS_CALLBACK *json_tls_destructor_t)(void* value);
+
+int thread_create(json_thread_t* thread, json_thread_fn fn, void* arg);
+void thread_join(json_thread_t thread);
+size_t thread_hardware_concurrency(void);
+
+void mutex_init(json_mutex_t* mutex);
+void mutex_lock(json_mutex_t* mutex);
+void mutex_unlock(json_mutex_t* mutex);
+void mutex_destroy(json_mutex_t* mutex);
+
+void cond_init(json_cond_t* cond);
+void cond_wait(json_cond_t* cond, json_mutex_t* mutex);
+void cond_broadcast(json_cond_t* cond);
+void cond_destroy(json_cond_t* cond);
+
+void thread_once(json_once_t* once, void (*fn)(void));
+
+int tls_key_create(json_tls_key_t* key, json_tls_destructor_t destructor);
+void* tls_get(json_tls_key_t key);
+void tls_set(json_tls_key_t key, void* value);
+
+#endif // MULTIFORMAT_JSON_THREAD_H
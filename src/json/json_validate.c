@@ -0,0 +1,659 @@
+﻿#include "json_validate.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_VALIDATE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(JSON_VALIDATE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define JSON_VALIDATE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#define VALIDATE_NO_STRING ((size_t)-1)
+
+typedef enum {
+	VALIDATE_VALUE,
+	VALIDATE_ARRAY_FIRST,
+	VALIDATE_OBJECT_FIRST,
+	VALIDATE_KEY,
+	VALIDATE_COLON,
+	VALIDATE_NEXT,
+	VALIDATE_DONE
+}validate_state_t;
+
+// Last 32 bytes of the previous non-ASCII block for the vector UTF-8
+// check, or the pending sequence for the scalar one
+typedef struct {
+	json_utf8_state_t scalar;
+	uint8_t prev_input[32];
+	uint8_t prev_incomplete[32];
+}utf8_checker_t;
+
+typedef struct {
+	const char* json;
+	size_t len;
+	validate_state_t state;
+	size_t depth;
+	// Bit per open container, set for objects
+	uint64_t objects[JSON_DEFAULT_MAX_DEPTH / 64];
+	// Opening quote of the string being read, or VALIDATE_NO_STRING
+	size_t string_start;
+	int string_is_key;
+	uint64_t in_string;
+	// First byte after the last escape sequence checked
+	size_t escape_end;
+	const char* message;
+	size_t offset;
+}validator_t;
+
+size_t utf8_check_scalar(json_utf8_state_t* state, const uint8_t* data, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		uint8_t c = data[i];
+
+		if (state->need) {
+			if (c < state->low || c > state->high) {
+				return i;
+			}
+			state->need--;
+			state->low = 0x80;
+			state->high = 0xBF;
+			continue;
+		}
+
+		if (c < 0x80) {
+			continue;
+		}
+
+		// The second byte range rules out overlong forms, surrogates and
+		// code points past U+10FFFF
+		state->low = 0x80;
+		state->high = 0xBF;
+		if (c >= 0xC2 && c <= 0xDF) {
+			state->need = 1;
+		}
+		else if (c >= 0xE0 && c <= 0xEF) {
+			state->need = 2;
+			if (c == 0xE0) state->low = 0xA0;
+			if (c == 0xED) state->high = 0x9F;
+		}
+		else if (c >= 0xF0 && c <= 0xF4) {
+			state->need = 3;
+			if (c == 0xF0) state->low = 0x90;
+			if (c == 0xF4) state->high = 0x8F;
+		}
+		else {
+			return i;
+		}
+	}
+	return len;
+}
+
+static int block_is_ascii(const uint8_t* block)
+{
+	uint64_t bits = 0;
+	for (int i = 0; i < JSON_STAGE1_BLOCK_SIZE; i += 8) {
+		uint64_t word;
+		memcpy(&word, block + i, sizeof(word));
+		bits |= word;
+	}
+	return (bits & UINT64_C(0x8080808080808080)) == 0;
+}
+
+static int utf8_block_scalar(utf8_checker_t* checker, const uint8_t* block)
+{
+	if (checker->scalar.need == 0 && block_is_ascii(block)) {
+		return 1;
+	}
+	return utf8_check_scalar(&checker->scalar, block, JSON_STAGE1_BLOCK_SIZE) == JSON_STAGE1_BLOCK_SIZE;
+}
+
+#ifdef JSON_VALIDATE_AVX2
+// Lookup-table UTF-8 validation (Keiser and Lemire, "Validating UTF-8 In
+// Less Than One Instruction Per Byte"). Each byte is checked against the
+// one, two and three bytes before it using three 16-entry nibble tables.
+#define UTF8_TOO_SHORT (1 << 0)
+#define UTF8_TOO_LONG (1 << 1)
+#define UTF8_OVERLONG_3 (1 << 2)
+#define UTF8_TOO_LARGE (1 << 3)
+#define UTF8_SURROGATE (1 << 4)
+#define UTF8_OVERLONG_2 (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4 (1 << 6)
+#define UTF8_TWO_CONTS (1 << 7)
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+#define UTF8_TABLE(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p) \
+	_mm256_setr_epi8(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, \
+		a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p)
+
+__attribute__((target("avx2")))
+static inline __m256i high_nibbles(__m256i bytes)
+{
+	return _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F));
+}
+
+// Input shifted so that byte i is byte i - n of the stream
+#define UTF8_PREV(input, prev, n) \
+	_mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+
+__attribute__((target("avx2")))
+static inline __m256i utf8_check_bytes(__m256i input, __m256i prev)
+{
+	__m256i prev1 = UTF8_PREV(input, prev, 1);
+
+	const __m256i byte_1_high = UTF8_TABLE(
+		UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+		UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+		UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+		UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+		UTF8_TOO_SHORT,
+		UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+		UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+	const __m256i byte_1_low = UTF8_TABLE(
+		UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+		UTF8_CARRY | UTF8_OVERLONG_2,
+		UTF8_CARRY,
+		UTF8_CARRY,
+		UTF8_CARRY | UTF8_TOO_LARGE,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+		UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000);
+	const __m256i byte_2_high = UTF8_TABLE(
+		UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+		UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+		UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+		UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+		UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+		UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+		UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+
+	__m256i special = _mm256_and_si256(
+		_mm256_and_si256(_mm256_shuffle_epi8(byte_1_high, high_nibbles(prev1)),
+			_mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+		_mm256_shuffle_epi8(byte_2_high, high_nibbles(input)));
+
+	// Third and fourth bytes of a sequence must be continuations; the
+	// tables flag every continuation after a continuation as TWO_CONTS
+	__m256i third = _mm256_subs_epu8(UTF8_PREV(input, prev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+	__m256i fourth = _mm256_subs_epu8(UTF8_PREV(input, prev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+	__m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+	return _mm256_xor_si256(must_continue, special);
+}
+
+// Non-zero where a sequence starting in the last three bytes is cut off
+__attribute__((target("avx2")))
+static inline __m256i utf8_incomplete(__m256i input)
+{
+	const __m256i max = _mm256_setr_epi8(
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		(char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+	return _mm256_subs_epu8(input, max);
+}
+
+__attribute__((target("avx2")))
+static int utf8_block_avx2(utf8_checker_t* checker, const uint8_t* block)
+{
+	__m256i in0 = _mm256_loadu_si256((const __m256i*)block);
+	__m256i in1 = _mm256_loadu_si256((const __m256i*)(block + 32));
+	__m256i incomplete = _mm256_loadu_si256((const __m256i*)checker->prev_incomplete);
+
+	if (!_mm256_movemask_epi8(_mm256_or_si256(in0, in1))) {
+		return _mm256_testz_si256(incomplete, incomplete);
+	}
+
+	__m256i prev = _mm256_loadu_si256((const __m256i*)checker->prev_input);
+	__m256i error = _mm256_or_si256(utf8_check_bytes(in0, prev), utf8_check_bytes(in1, in0));
+	_mm256_storeu_si256((__m256i*)checker->prev_input, in1);
+	_mm256_storeu_si256((__m256i*)checker->prev_incomplete, utf8_incomplete(in1));
+	return _mm256_testz_si256(error, error);
+}
+#endif
+
+typedef int (*utf8_block_fn)(utf8_checker_t* checker, const uint8_t* block);
+
+static utf8_block_fn select_utf8_checker(void)
+{
+#ifdef JSON_VALIDATE_AVX2
+	if (__builtin_cpu_supports("avx2")) {
+		return utf8_block_avx2;
+	}
+#endif
+	return utf8_block_scalar;
+}
+
+// Whether the input may end here; the state of the checker not in use stays zero
+static int utf8_finish(const utf8_checker_t* checker)
+{
+	for (size_t i = 0; i < sizeof(checker->prev_incomplete); i++) {
+		if (checker->prev_incomplete[i]) {
+			return 0;
+		}
+	}
+	return checker->scalar.need == 0;
+}
+
+// Offset of the first bad byte in a region whose earlier bytes passed the
+// block check; sequences may start up to three bytes before the region
+static size_t utf8_error_offset(const char* json, size_t len, size_t start)
+{
+	size_t from = start > 3 ? start - 3 : 0;
+	while (from < start && ((uint8_t)json[from] & 0xC0) == 0x80) {
+		from++;
+	}
+
+	json_utf8_state_t state = { 0, 0x80, 0xBF };
+	size_t offset = from + utf8_check_scalar(&state, (const uint8_t*)json + from, len - from);
+	return offset < len ? offset : len;
+}
+
+// Bytes below 0x20: never allowed in strings, and only as whitespace outside
+static uint64_t control_mask(const uint8_t* block)
+{
+	uint64_t mask = 0;
+#ifdef JSON_VALIDATE_SSE2
+	const __m128i limit = _mm_set1_epi8(0x1F);
+	for (int i = 0; i < 4; i++) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(block + i * 16));
+		__m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, limit), chunk);
+		mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(control) << (i * 16);
+	}
+#else
+	for (int i = 0; i < JSON_STAGE1_BLOCK_SIZE; i++) {
+		if (block[i] < 0x20) {
+			mask |= (uint64_t)1 << i;
+		}
+	}
+#endif
+	return mask;
+}
+
+static int fail(validator_t* v, const char* message, size_t offset)
+{
+	if (v->message == NULL || offset < v->offset) {
+		v->message = message;
+		v->offset = offset;
+	}
+	return 0;
+}
+
+static long hex4(const char* json, size_t len, size_t pos)
+{
+	if (pos + 4 > len) {
+		return -1;
+	}
+
+	long code = 0;
+	for (int i = 0; i < 4; i++) {
+		char c = json[pos + i];
+		int digit = (c >= '0' && c <= '9') ? c - '0' :
+			(c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+			(c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+		if (digit < 0) {
+			return -1;
+		}
+		code = (code << 4) | digit;
+	}
+	return code;
+}
+
+// Checks the escape sequence starting at the backslash at pos
+static int check_escape(validator_t* v, size_t pos)
+{
+	const char* json = v->json;
+	size_t len = v->len;
+
+	if (pos + 1 >= len) {
+		return fail(v, "Invalid escape sequence", pos);
+	}
+
+	switch (json[pos + 1]) {
+	case '"': case '\\': case '/': case 'b':
+	case 'f': case 'n': case 'r': case 't':
+		v->escape_end = pos + 2;
+		return 1;
+	case 'u': {
+		long code = hex4(json, len, pos + 2);
+		if (code < 0 || (code >= 0xDC00 && code <= 0xDFFF)) {
+			return fail(v, "Invalid escape sequence", pos);
+		}
+		if (code >= 0xD800 && code <= 0xDBFF) {
+			// A high surrogate must be followed by an escaped low one
+			long low = pos + 8 <= len && json[pos + 6] == '\\' && json[pos + 7] == 'u' ?
+				hex4(json, len, pos + 8) : -1;
+			if (low < 0xDC00 || low > 0xDFFF) {
+				return fail(v, "Invalid escape sequence", pos);
+			}
+			v->escape_end = pos + 12;
+			return 1;
+		}
+		v->escape_end = pos + 6;
+		return 1;
+	}
+	default:
+		return fail(v, "Invalid escape sequence", pos);
+	}
+}
+
+// Returns the end of the number at pos, or 0 when it is malformed
+static size_t scan_number(const char* json, size_t len, size_t pos)
+{
+	if (pos < len && json[pos] == '-') {
+		pos++;
+	}
+
+	if (pos >= len || json[pos] < '0' || json[pos] > '9') {
+		return 0;
+	}
+	if (json[pos] == '0') {
+		pos++;
+	}
+	else {
+		while (pos < len && json[pos] >= '0' && json[pos] <= '9') {
+			pos++;
+		}
+	}
+
+	if (pos < len && json[pos] == '.') {
+		pos++;
+		if (pos >= len || json[pos] < '0' || json[pos] > '9') {
+			return 0;
+		}
+		while (pos < len && json[pos] >= '0' && json[pos] <= '9') {
+			pos++;
+		}
+	}
+
+	if (pos < len && (json[pos] == 'e' || json[pos] == 'E')) {
+		pos++;
+		if (pos < len && (json[pos] == '+' || json[pos] == '-')) {
+			pos++;
+		}
+		if (pos >= len || json[pos] < '0' || json[pos] > '9') {
+			return 0;
+		}
+		while (pos < len && json[pos] >= '0' && json[pos] <= '9') {
+			pos++;
+		}
+	}
+	return pos;
+}
+
+static int at_scalar_end(const validator_t* v, size_t pos)
+{
+	return pos >= v->len || json_char_class[(unsigned char)v->json[pos]] != 0;
+}
+
+static int check_literal(validator_t* v, size_t pos, const char* literal, size_t length, const char* message)
+{
+	if (pos + length > v->len || memcmp(v->json + pos, literal, length) != 0 || !at_scalar_end(v, pos + length)) {
+		return fail(v, message, pos);
+	}
+	return 1;
+}
+
+static int check_scalar(validator_t* v, char c, size_t pos)
+{
+	switch (c) {
+	case 't':
+		return check_literal(v, pos, "true", 4, "Expected 'true' or 'false'");
+	case 'f':
+		return check_literal(v, pos, "false", 5, "Expected 'true' or 'false'");
+	case 'n':
+		return check_literal(v, pos, "null", 4, "Expected 'null'");
+	default: {
+		if (c != '-' && (c < '0' || c > '9')) {
+			return fail(v, "Unexpected character", pos);
+		}
+		size_t end = scan_number(v->json, v->len, pos);
+		if (end == 0 || !at_scalar_end(v, end)) {
+			return fail(v, "Invalid number", pos);
+		}
+		return 1;
+	}
+	}
+}
+
+static void value_done(validator_t* v)
+{
+	v->state = v->depth ? VALIDATE_NEXT : VALIDATE_DONE;
+}
+
+static int in_object(const validator_t* v)
+{
+	size_t top = v->depth - 1;
+	return (int)((v->objects[top / 64] >> (top % 64)) & 1);
+}
+
+static int open_container(validator_t* v, int is_object, size_t pos)
+{
+	if (v->depth >= JSON_DEFAULT_MAX_DEPTH) {
+		return fail(v, "Maximum nesting depth exceeded", pos);
+	}
+
+	uint64_t bit = (uint64_t)1 << (v->depth % 64);
+	if (is_object) {
+		v->objects[v->depth / 64] |= bit;
+	}
+	else {
+		v->objects[v->depth / 64] &= ~bit;
+	}
+	v->depth++;
+	v->state = is_object ? VALIDATE_OBJECT_FIRST : VALIDATE_ARRAY_FIRST;
+	return 1;
+}
+
+static int close_container(validator_t* v, char c, size_t pos)
+{
+	int is_object = in_object(v);
+	if (c != (is_object ? '}' : ']')) {
+		return fail(v, is_object ? "Expected ',' or '}'" : "Expected ',' or ']'", pos);
+	}
+	v->depth--;
+	value_done(v);
+	return 1;
+}
+
+static int begin_value(validator_t* v, char c, size_t pos)
+{
+	switch (c) {
+	case '{':
+		return open_container(v, 1, pos);
+	case '[':
+		return open_container(v, 0, pos);
+	case '"':
+		v->string_start = pos;
+		v->string_is_key = 0;
+		return 1;
+	default:
+		if (!check_scalar(v, c, pos)) {
+			return 0;
+		}
+		value_done(v);
+		return 1;
+	}
+}
+
+// Advances the grammar over the structural character at pos
+static int validate_token(validator_t* v, size_t pos)
+{
+	char c = v->json[pos];
+
+	// Stage 1 leaves nothing but the closing quote inside a string
+	if (v->string_start != VALIDATE_NO_STRING) {
+		v->string_start = VALIDATE_NO_STRING;
+		if (v->string_is_key) {
+			v->state = VALIDATE_COLON;
+		}
+		else {
+			value_done(v);
+		}
+		return 1;
+	}
+
+	switch (v->state) {
+	case VALIDATE_ARRAY_FIRST:
+		if (c == ']') {
+			return close_container(v, c, pos);
+		}
+		// fall through
+	case VALIDATE_VALUE:
+		return begin_value(v, c, pos);
+	case VALIDATE_OBJECT_FIRST:
+		if (c == '}') {
+			return close_container(v, c, pos);
+		}
+		// fall through
+	case VALIDATE_KEY:
+		if (c != '"') {
+			return fail(v, "Expected string key", pos);
+		}
+		v->string_start = pos;
+		v->string_is_key = 1;
+		return 1;
+	case VALIDATE_COLON:
+		if (c != ':') {
+			return fail(v, "Expected ':' after key", pos);
+		}
+		v->state = VALIDATE_VALUE;
+		return 1;
+	case VALIDATE_NEXT:
+		if (c == ',') {
+			v->state = in_object(v) ? VALIDATE_KEY : VALIDATE_VALUE;
+			return 1;
+		}
+		return close_container(v, c, pos);
+	default:
+		return fail(v, "Extra data after JSON", pos);
+	}
+}
+
+// Checks one 64-byte block starting at pos; bytes past the input are spaces
+static int validate_block(validator_t* v, utf8_block_fn utf8_block, utf8_checker_t* utf8,
+	json_stage1_state_t* stage1, const uint8_t* block, size_t pos)
+{
+	json_block_masks_t masks;
+	stage1_classify_block(block, &masks);
+	uint64_t structurals = stage1_structurals(&masks, stage1);
+
+	// Strings run from an opening quote up to the byte before its closing one
+	uint64_t quotes = structurals & masks.quote;
+	uint64_t in_string = stage1_prefix_xor(quotes) ^ v->in_string;
+	v->in_string = (uint64_t)((int64_t)in_string >> 63);
+
+	// Problems inside strings are found for the whole block at once; only
+	// structurals before the first of them are fed to the grammar
+	size_t limit = v->len;
+	uint64_t control = control_mask(block) & (in_string | ~masks.whitespace);
+	if (control) {
+		limit = pos + (size_t)stage1_trailing_zeros(control);
+		fail(v, "Invalid control character", limit);
+	}
+
+	uint64_t escapes = masks.backslash & in_string;
+	while (escapes) {
+		size_t at = pos + (size_t)stage1_trailing_zeros(escapes);
+		escapes &= escapes - 1;
+		if (at >= limit) {
+			break;
+		}
+		if (at >= v->escape_end && !check_escape(v, at)) {
+			limit = at;
+			break;
+		}
+	}
+
+	if (!utf8_block(utf8, block)) {
+		size_t offset = utf8_error_offset(v->json, v->len, pos);
+		if (offset < limit) {
+			limit = offset;
+		}
+		fail(v, "Invalid UTF-8", offset);
+	}
+
+	while (structurals) {
+		size_t at = pos + (size_t)stage1_trailing_zeros(structurals);
+		structurals &= structurals - 1;
+		if (at >= limit || !validate_token(v, at)) {
+			break;
+		}
+	}
+
+	return v->message == NULL;
+}
+
+// Picked on first use like the stage 1 classifier; threads racing to pick
+// it all store the same function
+static _Atomic(utf8_block_fn) utf8_checker = NULL;
+
+int validate_json(const char* json, size_t len, json_error_t* error)
+{
+	utf8_block_fn utf8_block = atomic_load_explicit(&utf8_checker, memory_order_acquire);
+	if (!utf8_block) {
+		utf8_block = select_utf8_checker();
+		atomic_store_explicit(&utf8_checker, utf8_block, memory_order_release);
+	}
+
+	validator_t v;
+	v.json = json;
+	v.len = len;
+	v.state = VALIDATE_VALUE;
+	v.depth = 0;
+	v.string_start = VALIDATE_NO_STRING;
+	v.string_is_key = 0;
+	v.in_string = 0;
+	v.escape_end = 0;
+	v.message = NULL;
+	v.offset = 0;
+
+	utf8_checker_t utf8;
+	memset(&utf8, 0, sizeof(utf8));
+
+	json_stage1_state_t stage1;
+	stage1_state_init(&stage1);
+
+	size_t pos = 0;
+	int ok = 1;
+	for (; ok && pos + JSON_STAGE1_BLOCK_SIZE <= len; pos += JSON_STAGE1_BLOCK_SIZE) {
+		ok = validate_block(&v, utf8_block, &utf8, &stage1, (const uint8_t*)json + pos, pos);
+	}
+
+	if (ok && pos < len) {
+		// Pad the tail with spaces so the last block never reads past the input
+		uint8_t tail[JSON_STAGE1_BLOCK_SIZE];
+		memset(tail, ' ', sizeof(tail));
+		memcpy(tail, json + pos, len - pos);
+		ok = validate_block(&v, utf8_block, &utf8, &stage1, tail, pos);
+	}
+
+	if (ok && !utf8_finish(&utf8)) {
+		fail(&v, "Invalid UTF-8", utf8_error_offset(json, len, len));
+	}
+	else if (ok && v.string_start != VALIDATE_NO_STRING) {
+		fail(&v, "Unterminated string", v.string_start);
+	}
+	else if (ok && v.state != VALIDATE_DONE) {
+		fail(&v, "Unexpected end of input", len);
+	}
+
+	if (v.message == NULL) {
+		return 1;
+	}
+	if (error) {
+		error->offset = v.offset;
+		error->message = v.message;
+	}
+	return 0;
+}
@@ -0,0 +1,27 @@
+﻿#ifndef MULTIFORMAT_JSON_VALIDATE_H
+#define MULTIFORMAT_JSON_VALIDATE_H
+
+#include "../core/data_types.h"
+#include "json_stage1.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Checks one JSON text against RFC 8259, including UTF-8 validity, control
+// characters and escapes inside strings. Works block by block on the stage
+// 1 masks without building an index and never allocates; nesting is
+// limited to JSON_DEFAULT_MAX_DEPTH. Fills error, when given, on failure.
+int validate_json(const char* json, size_t len, json_error_t* error);
+
+// UTF-8 checker usable across block boundaries; need is the number of
+// continuation bytes still expected
+typedef struct {
+	int need;
+	uint8_t low;
+	uint8_t high;
+}json_utf8_state_t;
+
+// Returns the offset of the first invalid byte in data, or len when every
+// byte is valid so far
+size_t utf8_check_scalar(json_utf8_state_t* state, const uint8_t* data, size_t len);
+
+#endif // MULTIFORMAT_JSON_VALIDATE_H
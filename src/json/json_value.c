@@ -0,0 +1,40 @@
+﻿#include "json_value.h"
+
+int value_set_string(json_arena_t* arena, json_value_t* value, const char* string, size_t length)
+{
+	if (length <= JSON_INLINE_STRING_MAX) {
+		value_set_inline_string(value, string, length);
+		return 1;
+	}
+
+	char* copy = arena_strndup(arena, string, length);
+	if (!copy) {
+		return 0;
+	}
+	value->data.string = copy;
+	value->tag = JSON_STRING;
+	return 1;
+}
+
+json_value_t** value_make_array(json_arena_t* arena, json_value_t* value, size_t count)
+{
+	json_array_t* array = arena_alloc(arena, sizeof(json_array_t) + sizeof(json_value_t*) * count);
+	if (!array) {
+		return NULL;
+	}
+	array->count = count;
+	value->data.array = array;
+	return array->values;
+}
+
+struct json_object_entry* value_make_object(json_arena_t* arena, json_value_t* value, size_t count)
+{
+	json_object_t* object = arena_alloc(arena, sizeof(json_object_t) + sizeof(struct json_object_entry) * count);
+	if (!object) {
+		return NULL;
+	}
+	object->count = count;
+	object->index = NULL;
+	value->data.object = object;
+	return object->entries;
+}
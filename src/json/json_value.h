@@ -0,0 +1,62 @@
+﻿#ifndef MULTIFORMAT_JSON_VALUE_H
+#define MULTIFORMAT_JSON_VALUE_H
+
+#include "../core/data_types.h"
+#include "json_arena.h"
+#include <string.h>
+
+// Tag byte layout, see struct json_value
+#define JSON_TAG_TYPE_MASK 0x07
+#define JSON_TAG_REPR_SHIFT 3
+#define JSON_TAG_REPR_MASK 0x18
+#define JSON_TAG_INLINE 0x20
+
+_Static_assert(sizeof(json_value_t) == 16, "json_value_t must stay 16 bytes");
+
+static inline void value_init(json_value_t* value, json_type_t type)
+{
+	memset(value, 0, sizeof(*value));
+	value->tag = (uint8_t)type;
+}
+
+static inline json_type_t value_type(const json_value_t* value)
+{
+	return (json_type_t)(value->tag & JSON_TAG_TYPE_MASK);
+}
+
+static inline json_number_t value_number(const json_value_t* value)
+{
+	json_number_t number;
+	number.uinteger = value->data.uinteger;
+	number.repr = (json_number_repr_t)((value->tag & JSON_TAG_REPR_MASK) >> JSON_TAG_REPR_SHIFT);
+	return number;
+}
+
+static inline void value_set_number(json_value_t* value, const json_number_t* number)
+{
+	value->data.uinteger = number->uinteger;
+	value->tag = (uint8_t)(JSON_NUMBER | ((unsigned)number->repr << JSON_TAG_REPR_SHIFT));
+}
+
+static inline const char* value_string(const json_value_t* value)
+{
+	return (value->tag & JSON_TAG_INLINE) ? value->inline_string : value->data.string;
+}
+
+// Copies a string of at most JSON_INLINE_STRING_MAX bytes into the value
+static inline void value_set_inline_string(json_value_t* value, const char* string, size_t length)
+{
+	memcpy(value->inline_string, string, length);
+	memset(value->inline_string + length, 0, sizeof(value->inline_string) - length);
+	value->tag = JSON_STRING | JSON_TAG_INLINE;
+}
+
+// Short strings are stored inline, longer ones are copied into the arena
+int value_set_string(json_arena_t* arena, json_value_t* value, const char* string, size_t length);
+
+// Give a container a header for count children and return the slot array to
+// fill in; NULL when out of memory
+json_value_t** value_make_array(json_arena_t* arena, json_value_t* value, size_t count);
+struct json_object_entry* value_make_object(json_arena_t* arena, json_value_t* value, size_t count);
+
+#endif // MULTIFORMAT_JSON_VALUE_H
@@ -0,0 +1,188 @@
+﻿#include "json_writer.h"
+
+void writer_init(json_writer_t* writer, json_sink_t* sink)
+{
+	serializer_init_sink(&writer->serializer, sink);
+	writer->depth = 0;
+	writer->empty = 0;
+	writer->key_pending = 0;
+	writer->done = 0;
+	writer->failed = 0;
+}
+
+static int writer_fail(json_writer_t* writer)
+{
+	writer->failed = 1;
+	return 0;
+}
+
+static int writer_in_object(const json_writer_t* writer)
+{
+	size_t level = writer->depth - 1;
+	return (writer->stack[level / 8] >> (level % 8)) & 1;
+}
+
+// Comma and indentation ahead of an array element or object member
+static int writer_separate(json_writer_t* writer)
+{
+	json_serializer_t* serializer = &writer->serializer;
+	if (!writer->empty && !serializer_append_char(serializer, ',')) {
+		return 0;
+	}
+	writer->empty = 0;
+
+	if (serializer->pretty) {
+		return serializer_append_char(serializer, '\n') && serializer_append_indent(serializer);
+	}
+	return 1;
+}
+
+// Checks that a value may come next and writes what goes before it
+static int writer_begin_value(json_writer_t* writer)
+{
+	if (writer->failed) {
+		return 0;
+	}
+
+	if (writer->depth == 0) {
+		return writer->done ? writer_fail(writer) : 1;
+	}
+	if (writer_in_object(writer)) {
+		// The key already wrote the separator
+		if (!writer->key_pending) {
+			return writer_fail(writer);
+		}
+		writer->key_pending = 0;
+		return 1;
+	}
+	return writer_separate(writer) || writer_fail(writer);
+}
+
+static int writer_end_value(json_writer_t* writer, int written)
+{
+	if (!written) {
+		return writer_fail(writer);
+	}
+	if (writer->depth == 0) {
+		writer->done = 1;
+	}
+	return 1;
+}
+
+static int writer_open(json_writer_t* writer, char bracket, int object)
+{
+	if (!writer_begin_value(writer)) {
+		return 0;
+	}
+	if (writer->depth == JSON_DEFAULT_MAX_DEPTH || !serializer_append_char(&writer->serializer, bracket)) {
+		return writer_fail(writer);
+	}
+
+	size_t level = writer->depth++;
+	if (object) {
+		writer->stack[level / 8] |= (uint8_t)(1u << (level % 8));
+	}
+	else {
+		writer->stack[level / 8] &= (uint8_t)~(1u << (level % 8));
+	}
+	writer->empty = 1;
+	writer->serializer.indent_level++;
+	return 1;
+}
+
+static int writer_close(json_writer_t* writer, char bracket, int object)
+{
+	if (writer->failed) {
+		return 0;
+	}
+	if (writer->depth == 0 || writer_in_object(writer) != object || writer->key_pending) {
+		return writer_fail(writer);
+	}
+
+	json_serializer_t* serializer = &writer->serializer;
+	writer->depth--;
+	serializer->indent_level--;
+	if (serializer->pretty && !writer->empty) {
+		if (!serializer_append_char(serializer, '\n') || !serializer_append_indent(serializer)) {
+			return writer_fail(writer);
+		}
+	}
+
+	// The parent, if any, now holds this container
+	writer->empty = 0;
+	return writer_end_value(writer, serializer_append_char(serializer, bracket));
+}
+
+int writer_begin_object(json_writer_t* writer)
+{
+	return writer_open(writer, '{', 1);
+}
+
+int writer_end_object(json_writer_t* writer)
+{
+	return writer_close(writer, '}', 1);
+}
+
+int writer_begin_array(json_writer_t* writer)
+{
+	return writer_open(writer, '[', 0);
+}
+
+int writer_end_array(json_writer_t* writer)
+{
+	return writer_close(writer, ']', 0);
+}
+
+int writer_key(json_writer_t* writer, const char* key)
+{
+	if (writer->failed) {
+		return 0;
+	}
+	if (writer->depth == 0 || !writer_in_object(writer) || writer->key_pending) {
+		return writer_fail(writer);
+	}
+
+	json_serializer_t* serializer = &writer->serializer;
+	int written = writer_separate(writer)
+		&& serializer_append_string(serializer, key)
+		&& (serializer->pretty ? serializer_append_n(serializer, ": ", 2) : serializer_append_char(serializer, ':'));
+	if (!written) {
+		return writer_fail(writer);
+	}
+
+	writer->key_pending = 1;
+	return 1;
+}
+
+int writer_null(json_writer_t* writer)
+{
+	return writer_begin_value(writer)
+		&& writer_end_value(writer, serializer_append_n(&writer->serializer, "null", 4));
+}
+
+int writer_bool(json_writer_t* writer, int value)
+{
+	return writer_begin_value(writer)
+		&& writer_end_value(writer, value ? serializer_append_n(&writer->serializer, "true", 4)
+			: serializer_append_n(&writer->serializer, "false", 5));
+}
+
+int writer_number(json_writer_t* writer, const json_number_t* number)
+{
+	return writer_begin_value(writer)
+		&& writer_end_value(writer, serializer_append_number(&writer->serializer, number));
+}
+
+int writer_string(json_writer_t* writer, const char* value)
+{
+	return writer_begin_value(writer)
+		&& writer_end_value(writer, serializer_append_string(&writer->serializer, value));
+}
+
+int writer_finish(json_writer_t* writer)
+{
+	if (writer->failed || !writer->done) {
+		return writer_fail(writer);
+	}
+	return serializer_finish(&writer->serializer) || writer_fail(writer);
+}
@@ -0,0 +1,37 @@
+﻿#ifndef MULTIFORMAT_JSON_WRITER_H
+#define MULTIFORMAT_JSON_WRITER_H
+
+#include "../core/data_types.h"
+#include "json_serializer.h"
+
+// Writes JSON text event by event through a sink, checking that the events
+// form exactly one well-nested value. The first misuse or sink failure
+// makes every later call fail.
+struct json_writer {
+	json_serializer_t serializer;
+	// One bit per open container, set for objects
+	uint8_t stack[JSON_DEFAULT_MAX_DEPTH / 8];
+	size_t depth;
+	// Nothing written yet in the innermost container
+	int empty;
+	// A key was written and its value has not
+	int key_pending;
+	// The root value is complete
+	int done;
+	int failed;
+};
+
+void writer_init(json_writer_t* writer, json_sink_t* sink);
+int writer_begin_object(json_writer_t* writer);
+int writer_end_object(json_writer_t* writer);
+int writer_begin_array(json_writer_t* writer);
+int writer_end_array(json_writer_t* writer);
+int writer_key(json_writer_t* writer, const char* key);
+int writer_null(json_writer_t* writer);
+int writer_bool(json_writer_t* writer, int value);
+int writer_number(json_writer_t* writer, const json_number_t* number);
+int writer_string(json_writer_t* writer, const char* value);
+// Flushes the rest of the output; fails unless one complete value was written
+int writer_finish(json_writer_t* writer);
+
+#endif // MULTIFORMAT_JSON_WRITER_H
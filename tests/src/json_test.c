@@ -1,4 +1,10 @@
-﻿#include <stdio.h>
+﻿#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
 #include "test_common.h"
 #include "../../include/json.h"
 
@@ -653,6 +659,2089 @@ void test_object_with_many_keys() {
     printf("✓ Object With Many Keys Test: %s\n\n", passed ? "PASSED" : "FAILED");
 }
 
+void test_document_reuse() {
+    printf("=== Document Reuse Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    json_document_t* doc = json_document_create();
+    passed &= (assertNotNull(doc) == 0);
+    if (!doc) {
+        printf("✓ Document Reuse Test: FAILED\n\n");
+        return;
+    }
+
+    // Test 1: Root of an empty document
+    printf("Test 1: Root of an empty document\n");
+    passed &= (assertNull(json_document_root(doc)) == 0);
+
+    // Test 2: First parse
+    printf("Test 2: First parse\n");
+    json_value_t* first = json_document_parse(doc, "{\"name\": \"first\", \"list\": [1, 2, 3]}");
+    passed &= (assertNotNull(first) == 0);
+    if (first) {
+        passed &= (assertPointersMatch(first, json_document_root(doc)) == 0);
+        passed &= (assertStringsMatch((char*)json_get_string(json_object_get(first, "name")), "first") == 0);
+        passed &= (assertEquals(json_get_array_size(json_object_get(first, "list")), 3) == 0);
+    }
+
+    // Test 3: Reparse a document large enough to need several arena blocks
+    printf("Test 3: Reparse with several arena blocks\n");
+    char* big_json = malloc(200000);
+    if (big_json) {
+        size_t len = 0;
+        big_json[len++] = '[';
+        for (int i = 0; i < 5000; i++) {
+            len += sprintf(big_json + len, "%s{\"id\":%d,\"tag\":\"item_%d\"}", i ? "," : "", i, i);
+        }
+        big_json[len++] = ']';
+        big_json[len] = '\0';
+
+        json_value_t* second = json_document_parse(doc, big_json);
+        passed &= (assertNotNull(second) == 0);
+        if (second) {
+            passed &= (assertEquals(json_get_array_size(second), 5000) == 0);
+            json_value_t* last = json_array_get(second, 4999);
+            passed &= (assertDoubleEquals(json_get_number(json_object_get(last, "id")), 4999.0) == 0);
+            passed &= (assertStringsMatch((char*)json_get_string(json_object_get(last, "tag")), "item_4999") == 0);
+        }
+        free(big_json);
+    }
+
+    // Test 4: Failed parse leaves no root behind
+    printf("Test 4: Failed parse\n");
+    passed &= (assertNull(json_document_parse(doc, "[1, 2,")) == 0);
+    passed &= (assertNull(json_document_root(doc)) == 0);
+
+    // Test 5: Document is still usable after an error
+    printf("Test 5: Parse after error\n");
+    json_value_t* third = json_document_parse(doc, "[true]");
+    passed &= (assertNotNull(third) == 0);
+    if (third) {
+        passed &= (assertEquals(json_get_boolean(json_array_get(third, 0)), 1) == 0);
+    }
+
+    json_document_free(doc);
+
+    printf("✓ Document Reuse Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_structural_index() {
+    printf("=== Structural Index Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Structural characters inside strings are ignored
+    printf("Test 1: Structural characters inside strings\n");
+    json_value_t* str_ops = json_parse("{\"k{[\": \"a,b:c]}\", \"n\": 1}");
+    passed &= (assertNotNull(str_ops) == 0);
+    if (str_ops) {
+        passed &= (assertEquals(json_object_size(str_ops), 2) == 0);
+        passed &= (assertStringsMatch((char*)json_get_string(json_object_get(str_ops, "k{[")), "a,b:c]}") == 0);
+        json_free(str_ops);
+    }
+
+    // Test 2: Escaped quotes and backslash runs across 64-byte blocks
+    printf("Test 2: Escapes across block boundaries\n");
+    char escaped_json[256];
+    for (int shift = 0; shift < 8; shift++) {
+        int len = sprintf(escaped_json, "[%*s\"x\\\\\\\"y\\\\\", 7]", 56 + shift, "");
+        json_value_t* escaped = json_parse(escaped_json);
+        passed &= (assertNotNull(escaped) == 0);
+        if (escaped) {
+            passed &= (assertEquals(json_get_array_size(escaped), 2) == 0);
+            passed &= (assertStringsMatch((char*)json_get_string(json_array_get(escaped, 0)), "x\\\"y\\") == 0);
+            json_free(escaped);
+        }
+        passed &= (assertGreaterThan(len, 64) == 0);
+    }
+
+    // Test 3: Scalars must end at a delimiter
+    printf("Test 3: Invalid scalar endings\n");
+    passed &= (assertNull(json_parse("[1x]")) == 0);
+    passed &= (assertNull(json_parse("[truex]")) == 0);
+    passed &= (assertNull(json_parse("[1 2]")) == 0);
+    passed &= (assertNull(json_parse("{\"a\":null\"b\"}")) == 0);
+
+    // Test 4: Whitespace-heavy input spanning many blocks
+    printf("Test 4: Long whitespace runs\n");
+    char spaced_json[1024];
+    sprintf(spaced_json, "%300s[%300s1,%200s\"s\"%100s]%50s", "", "", "", "", "");
+    json_value_t* spaced = json_parse(spaced_json);
+    passed &= (assertNotNull(spaced) == 0);
+    if (spaced) {
+        passed &= (assertEquals(json_get_array_size(spaced), 2) == 0);
+        json_free(spaced);
+    }
+
+    printf("✓ Structural Index Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_insitu_parsing() {
+    printf("=== In-situ Parsing Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Strings and keys point into the buffer and are decoded
+    printf("Test 1: Strings decoded in place\n");
+    char buffer[] = "{\"name\": \"caf\\u00e9\", \"path\": \"a\\/b\\\\c\", "
+                    "\"emoji\": \"\\ud83c\\udf0d\", \"list\": [\"x\\ny\", 5]}";
+    size_t length = strlen(buffer);
+    json_value_t* root = json_parse_insitu(buffer, length);
+    passed &= (assertNotNull(root) == 0);
+    if (root) {
+        const char* key = json_object_get_key(root, 0);
+        passed &= (assertTrue(key >= buffer && key < buffer + length) == 0);
+        passed &= (assertStringsMatch((char*)key, "name") == 0);
+
+        const char* name = json_get_string(json_object_get(root, "name"));
+        passed &= (assertTrue(name >= buffer && name < buffer + length) == 0);
+        passed &= (assertStringsMatch((char*)name, "caf\xc3\xa9") == 0);
+        passed &= (assertStringsMatch((char*)json_get_string(json_object_get(root, "path")), "a/b\\c") == 0);
+        passed &= (assertStringsMatch((char*)json_get_string(json_object_get(root, "emoji")), "\xf0\x9f\x8c\x8d") == 0);
+
+        json_value_t* list = json_object_get(root, "list");
+        passed &= (assertStringsMatch((char*)json_get_string(json_array_get(list, 0)), "x\ny") == 0);
+        passed &= (assertDoubleEquals(json_get_number(json_array_get(list, 1)), 5.0) == 0);
+        json_free(root);
+    }
+
+    // Test 2: Only the given length is parsed
+    printf("Test 2: Length-bounded buffer\n");
+    char bounded[] = "[12, \"ab\"]trailing garbage";
+    json_value_t* array = json_parse_insitu(bounded, 10);
+    passed &= (assertNotNull(array) == 0);
+    if (array) {
+        passed &= (assertEquals(json_get_array_size(array), 2) == 0);
+        passed &= (assertDoubleEquals(json_get_number(json_array_get(array, 0)), 12.0) == 0);
+        json_free(array);
+    }
+
+    // Test 3: Invalid escapes are rejected
+    printf("Test 3: Invalid escapes\n");
+    char bad_escape[] = "\"\\q\"";
+    passed &= (assertNull(json_parse_insitu(bad_escape, strlen(bad_escape))) == 0);
+    char lone_surrogate[] = "\"\\ud83c\"";
+    passed &= (assertNull(json_parse_insitu(lone_surrogate, strlen(lone_surrogate))) == 0);
+
+    // Test 4: Document reuse with in-situ buffers
+    printf("Test 4: Document reuse\n");
+    json_document_t* doc = json_document_create();
+    char first[] = "{\"a\": \"1\"}";
+    char second[] = "[\"b\"]";
+    passed &= (assertNotNull(json_document_parse_insitu(doc, first, strlen(first))) == 0);
+    json_value_t* reused = json_document_parse_insitu(doc, second, strlen(second));
+    passed &= (assertNotNull(reused) == 0);
+    if (reused) {
+        passed &= (assertStringsMatch((char*)json_get_string(json_array_get(reused, 0)), "b") == 0);
+    }
+    json_document_free(doc);
+
+    printf("✓ In-situ Parsing Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_number_parsing() {
+    printf("=== Number Parsing Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Integers beyond 2^53 are kept exactly
+    printf("Test 1: Large integers\n");
+    json_value_t* ints = json_parse("[9007199254740993, -9223372036854775808, 18446744073709551615, 42]");
+    passed &= (assertNotNull(ints) == 0);
+    if (ints) {
+        json_value_t* big = json_array_get(ints, 0);
+        passed &= (assertEquals(json_get_type(big), JSON_NUMBER) == 0);
+        passed &= (assertEquals(json_get_number_repr(big), JSON_INTEGER) == 0);
+        passed &= (assertTrue(json_get_int64(big) == 9007199254740993LL) == 0);
+        passed &= (assertTrue(json_get_int64(json_array_get(ints, 1)) == INT64_MIN) == 0);
+
+        json_value_t* max = json_array_get(ints, 2);
+        passed &= (assertEquals(json_get_number_repr(max), JSON_UNSIGNED) == 0);
+        passed &= (assertTrue(json_get_uint64(max) == UINT64_MAX) == 0);
+        passed &= (assertTrue(json_get_int64(max) == 0) == 0);
+
+        passed &= (assertDoubleEquals(json_get_number(json_array_get(ints, 3)), 42.0) == 0);
+
+        char* serialized = json_serialize(ints);
+        passed &= (assertNotNull(serialized) == 0);
+        if (serialized) {
+            passed &= (assertStringsMatch(serialized, "[9007199254740993,-9223372036854775808,18446744073709551615,42]") == 0);
+            free(serialized);
+        }
+        json_free(ints);
+    }
+
+    // Test 2: Doubles are correctly rounded
+    printf("Test 2: Correctly rounded doubles\n");
+    json_value_t* reals = json_parse("[0.1, 2.2250738585072014e-308, 1.7976931348623157e308, "
+                                     "4.9e-324, 3.14159265358979323846264338327950288, 1e400, -0.0, 1E+2]");
+    passed &= (assertNotNull(reals) == 0);
+    if (reals) {
+        passed &= (assertEquals(json_get_number_repr(json_array_get(reals, 0)), JSON_REAL) == 0);
+        passed &= (assertTrue(json_get_number(json_array_get(reals, 0)) == 0.1) == 0);
+        passed &= (assertTrue(json_get_number(json_array_get(reals, 1)) == 2.2250738585072014e-308) == 0);
+        passed &= (assertTrue(json_get_number(json_array_get(reals, 2)) == 1.7976931348623157e308) == 0);
+        passed &= (assertTrue(json_get_number(json_array_get(reals, 3)) == 4.9e-324) == 0);
+        passed &= (assertTrue(json_get_number(json_array_get(reals, 4)) == 3.141592653589793) == 0);
+        passed &= (assertTrue(isinf(json_get_number(json_array_get(reals, 5)))) == 0);
+        passed &= (assertTrue(signbit(json_get_number(json_array_get(reals, 6)))) == 0);
+        passed &= (assertTrue(json_get_number(json_array_get(reals, 7)) == 100.0) == 0);
+        passed &= (assertTrue(json_get_int64(json_array_get(reals, 7)) == 100) == 0);
+        json_free(reals);
+    }
+
+    // Test 3: Numbers outside the JSON grammar are rejected
+    printf("Test 3: Invalid numbers\n");
+    passed &= (assertNull(json_parse("01")) == 0);
+    passed &= (assertNull(json_parse("1.")) == 0);
+    passed &= (assertNull(json_parse("-")) == 0);
+    passed &= (assertNull(json_parse("1e+")) == 0);
+    passed &= (assertNull(json_parse("0x10")) == 0);
+
+    printf("✓ Number Parsing Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_ondemand() {
+    printf("=== On-Demand Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+    json_od_parser_t* parser = json_od_parser_create();
+    passed &= (assertNotNull(parser) == 0);
+    if (!parser) {
+        printf("✓ On-Demand Test: FAILED\n\n");
+        return;
+    }
+
+    // Test 1: Fields are found past unread subtrees
+    printf("Test 1: Find fields\n");
+    const char* json = "{\"skip\": {\"price\": [1, {\"x\": \"]}\"}]}, \"na\\u006de\": \"Widget\", "
+                       "\"price\": 19.5, \"count\": 9007199254740993, \"ok\": true, \"none\": null}";
+    json_od_value_t root, field;
+    passed &= (assertTrue(json_od_iterate(parser, json, strlen(json), &root)) == 0);
+    passed &= (assertEquals(json_od_get_type(&root), JSON_OBJECT) == 0);
+
+    double price = 0;
+    passed &= (assertTrue(json_od_find_field(&root, "price", &field)) == 0);
+    passed &= (assertTrue(json_od_get_double(&field, &price)) == 0);
+    passed &= (assertDoubleEquals(price, 19.5) == 0);
+
+    int64_t count = 0;
+    passed &= (assertTrue(json_od_find_field(&root, "count", &field)) == 0);
+    passed &= (assertTrue(json_od_get_int64(&field, &count)) == 0);
+    passed &= (assertTrue(count == 9007199254740993LL) == 0);
+
+    const char* name = NULL;
+    size_t name_length = 0;
+    passed &= (assertTrue(json_od_find_field(&root, "name", &field)) == 0);
+    passed &= (assertTrue(json_od_get_string(&field, &name, &name_length)) == 0);
+    passed &= (assertStringsMatch((char*)name, "Widget") == 0);
+    passed &= (assertEquals((int)name_length, 6) == 0);
+
+    int ok = 0;
+    passed &= (assertTrue(json_od_find_field(&root, "ok", &field)) == 0);
+    passed &= (assertTrue(json_od_get_bool(&field, &ok) && ok) == 0);
+    passed &= (assertTrue(json_od_find_field(&root, "none", &field)) == 0);
+    passed &= (assertTrue(json_od_is_null(&field)) == 0);
+    passed &= (assertFalse(json_od_find_field(&root, "missing", &field)) == 0);
+    passed &= (assertFalse(json_od_get_double(&root, &price)) == 0);
+
+    // Test 2: Array and object iterators
+    printf("Test 2: Iterators\n");
+    const char* items = "[{\"price\": 1.5, \"tags\": [\"a\", [\"b\"]]}, {\"price\": 2}, {}, [], {\"price\": 3.25}]";
+    passed &= (assertTrue(json_od_iterate(parser, items, strlen(items), &root)) == 0);
+
+    json_od_iterator_t it;
+    json_od_value_t item;
+    double total = 0, value;
+    int elements = 0;
+    passed &= (assertTrue(json_od_array_begin(&root, &it)) == 0);
+    while (json_od_array_next(&it, &item)) {
+        elements++;
+        if (json_od_find_field(&item, "price", &field) && json_od_get_double(&field, &value)) {
+            total += value;
+        }
+    }
+    passed &= (assertEquals(elements, 5) == 0);
+    passed &= (assertDoubleEquals(total, 6.75) == 0);
+
+    const char* object = "{\"a\": 1, \"b\": [true, false], \"c\": \"x\"}";
+    passed &= (assertTrue(json_od_iterate(parser, object, strlen(object), &root)) == 0);
+    passed &= (assertTrue(json_od_object_begin(&root, &it)) == 0);
+    const char* key;
+    size_t key_length;
+    char keys[4] = { 0 };
+    int fields = 0;
+    while (fields < 3 && json_od_object_next(&it, &key, &key_length, &field)) {
+        passed &= (assertEquals((int)key_length, 1) == 0);
+        keys[fields++] = key[0];
+    }
+    passed &= (assertStringsMatch(keys, "abc") == 0);
+    passed &= (assertFalse(json_od_object_next(&it, &key, &key_length, &field)) == 0);
+
+    // Test 3: Malformed input fails when it is read
+    printf("Test 3: Malformed input\n");
+    passed &= (assertFalse(json_od_iterate(parser, "\"open", 5, &root)) == 0);
+    const char* broken = "[1, 2 3, 01]";
+    passed &= (assertTrue(json_od_iterate(parser, broken, strlen(broken), &root)) == 0);
+    passed &= (assertTrue(json_od_array_begin(&root, &it)) == 0);
+    passed &= (assertTrue(json_od_array_next(&it, &item)) == 0);
+    passed &= (assertFalse(json_od_array_next(&it, &item)) == 0);
+    const char* bad_number = "[01]";
+    passed &= (assertTrue(json_od_iterate(parser, bad_number, strlen(bad_number), &root)) == 0);
+    passed &= (assertTrue(json_od_array_begin(&root, &it) && json_od_array_next(&it, &item)) == 0);
+    passed &= (assertFalse(json_od_get_double(&item, &value)) == 0);
+
+    json_od_parser_free(parser);
+
+    printf("✓ On-Demand Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+typedef struct {
+    char events[256];
+    size_t length;
+    double sum;
+    size_t strings;
+    size_t string_bytes;
+    int stop_at_key;
+} sax_recorder_t;
+
+static void sax_record(sax_recorder_t* rec, char event) {
+    if (rec->length + 1 < sizeof(rec->events)) {
+        rec->events[rec->length++] = event;
+        rec->events[rec->length] = '\0';
+    }
+}
+
+static int sax_on_null(void* ctx) { sax_record(ctx, 'n'); return 1; }
+static int sax_on_bool(void* ctx, int value) { sax_record(ctx, value ? 't' : 'f'); return 1; }
+static int sax_on_start_object(void* ctx) { sax_record(ctx, '{'); return 1; }
+static int sax_on_end_object(void* ctx) { sax_record(ctx, '}'); return 1; }
+static int sax_on_start_array(void* ctx) { sax_record(ctx, '['); return 1; }
+static int sax_on_end_array(void* ctx) { sax_record(ctx, ']'); return 1; }
+
+static int sax_on_number(void* ctx, const json_number_t* number) {
+    sax_recorder_t* rec = ctx;
+    sax_record(rec, '#');
+    switch (number->repr) {
+    case JSON_INTEGER: rec->sum += (double)number->integer; break;
+    case JSON_UNSIGNED: rec->sum += (double)number->uinteger; break;
+    default: rec->sum += number->real; break;
+    }
+    return 1;
+}
+
+static int sax_on_string(void* ctx, const char* value, size_t length) {
+    sax_recorder_t* rec = ctx;
+    sax_record(rec, 's');
+    rec->strings++;
+    rec->string_bytes += length;
+    return strlen(value) == length;
+}
+
+static int sax_on_key(void* ctx, const char* key, size_t length) {
+    sax_recorder_t* rec = ctx;
+    sax_record(rec, 'k');
+    if (strlen(key) != length) return 0;
+    return !(rec->stop_at_key && strcmp(key, "stop") == 0);
+}
+
+void test_sax_parsing() {
+    printf("=== SAX Parsing Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+    json_sax_handler_t handler = {
+        .on_null = sax_on_null,
+        .on_bool = sax_on_bool,
+        .on_number = sax_on_number,
+        .on_string = sax_on_string,
+        .on_start_object = sax_on_start_object,
+        .on_key = sax_on_key,
+        .on_end_object = sax_on_end_object,
+        .on_start_array = sax_on_start_array,
+        .on_end_array = sax_on_end_array
+    };
+
+    // Test 1: Events follow document order
+    printf("Test 1: Event order\n");
+    const char* json = "{\"a\": [1, 2.5, {}, []], \"b\\n\": \"x\\u00e9\", \"c\": {\"d\": null, \"e\": true, \"f\": false}}";
+    sax_recorder_t rec = { 0 };
+    passed &= (assertTrue(json_sax_parse(json, strlen(json), &handler, &rec)) == 0);
+    passed &= (assertStringsMatch(rec.events, "{k[##{}[]]ksk{knktkf}}") == 0);
+    passed &= (assertDoubleEquals(rec.sum, 3.5) == 0);
+    passed &= (assertEquals((int)rec.string_bytes, 3) == 0);
+
+    // Test 2: Syntax errors and handlers that stop the parse
+    printf("Test 2: Errors and early stop\n");
+    sax_recorder_t bad = { 0 };
+    passed &= (assertFalse(json_sax_parse("[1, 2", 5, &handler, &bad)) == 0);
+    passed &= (assertFalse(json_sax_parse("{\"a\" 1}", 7, &handler, &bad)) == 0);
+    passed &= (assertFalse(json_sax_parse("[01]", 4, &handler, &bad)) == 0);
+    passed &= (assertFalse(json_sax_parse("[1] 2", 5, &handler, &bad)) == 0);
+
+    sax_recorder_t stop = { .stop_at_key = 1 };
+    const char* stopping = "{\"a\": 1, \"stop\": 2, \"c\": 3}";
+    passed &= (assertFalse(json_sax_parse(stopping, strlen(stopping), &handler, &stop)) == 0);
+    passed &= (assertStringsMatch(stop.events, "{k#k") == 0);
+
+    // Test 3: Deep nesting does not use the call stack
+    printf("Test 3: Deep nesting\n");
+    size_t depth = 100000;
+    char* deep = malloc(depth * 2);
+    if (deep) {
+        memset(deep, '[', depth);
+        memset(deep + depth, ']', depth);
+        json_sax_handler_t empty = { 0 };
+        passed &= (assertTrue(json_sax_parse(deep, depth * 2, &empty, NULL)) == 0);
+        passed &= (assertFalse(json_sax_parse(deep, depth * 2 - 1, &empty, NULL)) == 0);
+        free(deep);
+    }
+
+    // Test 4: Files are streamed across chunk boundaries
+    printf("Test 4: File streaming\n");
+    const char* path = "sax_stream_test.json";
+    FILE* file = fopen(path, "wb");
+    passed &= (assertNotNull(file) == 0);
+    if (file) {
+        size_t count = 20000;
+        double expected = 0;
+        fputs("[", file);
+        for (size_t i = 0; i < count; i++) {
+            fprintf(file, "%s{\"id\": %zu, \"name\": \"item \\\"%zu\\\" with a longer name\"}", i ? ",\n  " : "", i, i);
+            expected += (double)i;
+        }
+        fputs("]", file);
+        fclose(file);
+
+        sax_recorder_t streamed = { 0 };
+        passed &= (assertTrue(json_sax_parse_file(path, &handler, &streamed)) == 0);
+        passed &= (assertDoubleEquals(streamed.sum, expected) == 0);
+        passed &= (assertEquals((int)streamed.strings, (int)count) == 0);
+        remove(path);
+    }
+    passed &= (assertFalse(json_sax_parse_file("missing_sax_file.json", &handler, &rec)) == 0);
+
+    printf("✓ SAX Parsing Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_push_parsing() {
+    printf("=== Push Parsing Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+    const char* json = "{\"name\": \"caf\\u00e9 \\\"x\\\"\", \"values\": [12, -3.5e2, true, null], \"big\": 18446744073709551615}";
+    size_t length = strlen(json);
+
+    // Test 1: A document fed one byte at a time
+    printf("Test 1: Byte-by-byte document\n");
+    json_push_parser_t* parser = json_push_parser_create(NULL, NULL);
+    passed &= (assertNotNull(parser) == 0);
+    int ok = 1;
+    for (size_t i = 0; i < length && ok; i++) {
+        ok = json_push_feed(parser, json + i, 1);
+    }
+    passed &= (assertTrue(ok && json_push_finish(parser)) == 0);
+    json_value_t* root = json_push_take_root(parser);
+    passed &= (assertNotNull(root) == 0);
+    passed &= (assertNull(json_push_take_root(parser)) == 0);
+    json_push_parser_free(parser);
+    if (root) {
+        passed &= (assertStringsMatch((char*)json_get_string(json_object_get(root, "name")), "caf\xc3\xa9 \"x\"") == 0);
+        json_value_t* values = json_object_get(root, "values");
+        passed &= (assertEquals((int)json_get_array_size(values), 4) == 0);
+        passed &= (assertTrue(json_get_int64(json_array_get(values, 0)) == 12) == 0);
+        passed &= (assertDoubleEquals(json_get_number(json_array_get(values, 1)), -350.0) == 0);
+        passed &= (assertEquals(json_get_type(json_array_get(values, 3)), JSON_NULL) == 0);
+        passed &= (assertTrue(json_get_uint64(json_object_get(root, "big")) == UINT64_MAX) == 0);
+        json_free(root);
+    }
+
+    // Test 2: Events across every split point
+    printf("Test 2: Events across chunk boundaries\n");
+    json_sax_handler_t handler = {
+        .on_null = sax_on_null,
+        .on_bool = sax_on_bool,
+        .on_number = sax_on_number,
+        .on_string = sax_on_string,
+        .on_start_object = sax_on_start_object,
+        .on_key = sax_on_key,
+        .on_end_object = sax_on_end_object,
+        .on_start_array = sax_on_start_array,
+        .on_end_array = sax_on_end_array
+    };
+    int all_match = 1;
+    for (size_t split = 0; split <= length; split++) {
+        sax_recorder_t rec = { 0 };
+        json_push_parser_t* events = json_push_parser_create(&handler, &rec);
+        int fed = json_push_feed(events, json, split) && json_push_feed(events, json + split, length - split);
+        all_match &= fed && json_push_finish(events) && strcmp(rec.events, "{ksk[##tn]k#}") == 0 &&
+            rec.sum == (12 - 350.0) + (double)UINT64_MAX;
+        json_push_parser_free(events);
+    }
+    passed &= (assertTrue(all_match) == 0);
+
+    // Test 3: Root scalars end with the input
+    printf("Test 3: Root scalars\n");
+    json_push_parser_t* number = json_push_parser_create(NULL, NULL);
+    passed &= (assertTrue(json_push_feed(number, "12", 2) && json_push_feed(number, "34", 2)) == 0);
+    passed &= (assertNull(json_push_take_root(number)) == 0);
+    passed &= (assertTrue(json_push_finish(number)) == 0);
+    root = json_push_take_root(number);
+    passed &= (assertTrue(json_get_int64(root) == 1234) == 0);
+    json_free(root);
+    json_push_parser_free(number);
+
+    // Test 4: Errors
+    printf("Test 4: Errors\n");
+    json_push_parser_t* bad = json_push_parser_create(NULL, NULL);
+    passed &= (assertTrue(json_push_feed(bad, "[1, tr", 6)) == 0);
+    passed &= (assertFalse(json_push_feed(bad, "ux]", 3)) == 0);
+    passed &= (assertFalse(json_push_feed(bad, "]", 1)) == 0);
+    passed &= (assertFalse(json_push_finish(bad)) == 0);
+    json_push_parser_free(bad);
+
+    json_push_parser_t* partial = json_push_parser_create(NULL, NULL);
+    passed &= (assertTrue(json_push_feed(partial, "{\"a\": \"unterminated", 19)) == 0);
+    passed &= (assertFalse(json_push_finish(partial)) == 0);
+    json_push_parser_free(partial);
+
+    json_push_parser_t* extra = json_push_parser_create(NULL, NULL);
+    passed &= (assertFalse(json_push_feed(extra, "{} {}", 5)) == 0);
+    json_push_parser_free(extra);
+
+    // Test 5: Nesting stops at the same depth as the parser
+    printf("Test 5: Depth limit\n");
+    char brackets[2 * JSON_DEFAULT_MAX_DEPTH + 2];
+    memset(brackets, '[', JSON_DEFAULT_MAX_DEPTH);
+    memset(brackets + JSON_DEFAULT_MAX_DEPTH, ']', JSON_DEFAULT_MAX_DEPTH);
+    json_push_parser_t* deepest = json_push_parser_create(NULL, NULL);
+    passed &= (assertTrue(json_push_feed(deepest, brackets, 2 * JSON_DEFAULT_MAX_DEPTH) && json_push_finish(deepest)) == 0);
+    root = json_push_take_root(deepest);
+    passed &= (assertNotNull(root) == 0);
+    json_free(root);
+    json_push_parser_free(deepest);
+
+    memset(brackets, '[', JSON_DEFAULT_MAX_DEPTH + 1);
+    json_push_parser_t* too_deep = json_push_parser_create(NULL, NULL);
+    passed &= (assertFalse(json_push_feed(too_deep, brackets, JSON_DEFAULT_MAX_DEPTH + 1)) == 0);
+    json_push_parser_free(too_deep);
+
+    sax_recorder_t deep_rec = { 0 };
+    json_push_parser_t* deep_events = json_push_parser_create(&handler, &deep_rec);
+    passed &= (assertFalse(json_push_feed(deep_events, brackets, JSON_DEFAULT_MAX_DEPTH + 1)) == 0);
+    json_push_parser_free(deep_events);
+
+    printf("✓ Push Parsing Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+typedef struct {
+    size_t records;
+    size_t invalid;
+    size_t last_line;
+    int in_order;
+    int ids_match;
+    size_t stop_after;
+} lines_state_t;
+
+static int lines_collect(void* ctx, size_t line, json_value_t* record) {
+    lines_state_t* state = ctx;
+    if (line <= state->last_line) state->in_order = 0;
+    state->last_line = line;
+    if (!record) {
+        state->invalid++;
+    } else {
+        state->records++;
+        // Line n of the test file holds id n - 1
+        if (json_get_int64(json_object_get(record, "id")) != (int64_t)line - 1) state->ids_match = 0;
+    }
+    return !state->stop_after || state->records < state->stop_after;
+}
+
+static atomic_size_t lines_unordered_count;
+static atomic_size_t lines_unordered_mismatch;
+
+static int lines_count_concurrent(void* ctx, size_t line, json_value_t* record) {
+    (void)ctx;
+    atomic_fetch_add(&lines_unordered_count, 1);
+    if (!record || json_get_int64(json_object_get(record, "id")) != (int64_t)line - 1) {
+        atomic_fetch_add(&lines_unordered_mismatch, 1);
+    }
+    return 1;
+}
+
+void test_parse_lines_parallel() {
+    printf("=== Parallel JSON Lines Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+    const char* path = "lines_parallel_test.jsonl";
+    size_t count = 60000;
+
+    FILE* file = fopen(path, "wb");
+    passed &= (assertNotNull(file) == 0);
+    if (!file) {
+        printf("✓ Parallel JSON Lines Test: FAILED\n\n");
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        fprintf(file, "{\"id\": %zu, \"msg\": \"event number %zu\", \"tags\": [1, 2, 3]}%s", i, i, i % 3 ? "\n" : "\r\n");
+    }
+    fclose(file);
+
+    // Test 1: Ordered delivery across chunks and threads
+    printf("Test 1: Ordered delivery\n");
+    lines_state_t ordered = { .in_order = 1, .ids_match = 1 };
+    passed &= (assertTrue(json_parse_lines_parallel(path, 4, lines_collect, &ordered, JSON_LINES_ORDERED)) == 0);
+    passed &= (assertEquals((int)ordered.records, (int)count) == 0);
+    passed &= (assertEquals((int)ordered.invalid, 0) == 0);
+    passed &= (assertTrue(ordered.in_order && ordered.ids_match) == 0);
+
+    // Test 2: Unordered delivery from concurrent workers
+    printf("Test 2: Unordered delivery\n");
+    atomic_store(&lines_unordered_count, 0);
+    atomic_store(&lines_unordered_mismatch, 0);
+    passed &= (assertTrue(json_parse_lines_parallel(path, 4, lines_count_concurrent, NULL, JSON_LINES_UNORDERED)) == 0);
+    passed &= (assertEquals((int)atomic_load(&lines_unordered_count), (int)count) == 0);
+    passed &= (assertEquals((int)atomic_load(&lines_unordered_mismatch), 0) == 0);
+
+    // Test 3: Early stop
+    printf("Test 3: Early stop\n");
+    lines_state_t stopped = { .in_order = 1, .ids_match = 1, .stop_after = 100 };
+    passed &= (assertFalse(json_parse_lines_parallel(path, 4, lines_collect, &stopped, JSON_LINES_ORDERED)) == 0);
+    passed &= (assertEquals((int)stopped.records, 100) == 0);
+
+    // Test 4: Blank and invalid lines, no trailing newline
+    printf("Test 4: Invalid lines\n");
+    file = fopen(path, "wb");
+    if (file) {
+        fputs("{\"id\": 0}\n\n  \n{\"id\": \n{\"id\": 4}", file);
+        fclose(file);
+    }
+    lines_state_t mixed = { .in_order = 1, .ids_match = 1 };
+    passed &= (assertTrue(json_parse_lines_parallel(path, 1, lines_collect, &mixed, JSON_LINES_ORDERED)) == 0);
+    passed &= (assertEquals((int)mixed.records, 2) == 0);
+    passed &= (assertEquals((int)mixed.invalid, 1) == 0);
+    passed &= (assertTrue(mixed.ids_match) == 0);
+    remove(path);
+
+    passed &= (assertFalse(json_parse_lines_parallel("missing_lines_file.jsonl", 2, lines_collect, &mixed, JSON_LINES_ORDERED)) == 0);
+
+    printf("✓ Parallel JSON Lines Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_object_index() {
+    printf("=== Object Index Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Large objects are indexed while parsing
+    printf("Test 1: Lookups in a large object\n");
+    size_t count = 2000;
+    char* json = malloc(count * 32 + 16);
+    passed &= (assertNotNull(json) == 0);
+    if (json) {
+        size_t length = 0;
+        json[length++] = '{';
+        for (size_t i = 0; i < count; i++) {
+            length += (size_t)sprintf(json + length, "%s\"user_%zu\": %zu", i ? ", " : "", i, i);
+        }
+        length += (size_t)sprintf(json + length, ", \"user_7\": -1}");
+
+        json_value_t* map = json_parse(json);
+        passed &= (assertNotNull(map) == 0);
+        if (map) {
+            int all_found = 1;
+            char key[32];
+            for (size_t i = 0; i < count; i++) {
+                sprintf(key, "user_%zu", i);
+                all_found &= json_get_int64(json_object_get(map, key)) == (int64_t)i;
+            }
+            passed &= (assertTrue(all_found) == 0);
+            passed &= (assertNull(json_object_get(map, "user_2000")) == 0);
+            passed &= (assertNull(json_object_get(map, "")) == 0);
+
+            // Duplicate keys resolve to the first entry, order is unchanged
+            passed &= (assertTrue(json_get_int64(json_object_get(map, "user_7")) == 7) == 0);
+            passed &= (assertEquals((int)json_object_size(map), (int)count + 1) == 0);
+            passed &= (assertStringsMatch((char*)json_object_get_key(map, 0), "user_0") == 0);
+            passed &= (assertStringsMatch((char*)json_object_get_key(map, 1999), "user_1999") == 0);
+            passed &= (assertStringsMatch((char*)json_object_get_key(map, 2000), "user_7") == 0);
+            json_free(map);
+        }
+        free(json);
+    }
+
+    // Test 2: Indexing a small object on request
+    printf("Test 2: Explicit index\n");
+    json_document_t* doc = json_document_create();
+    json_value_t* small = json_document_parse(doc, "{\"a\": 1, \"b\": {\"c\": 2}, \"a\": 3}");
+    passed &= (assertNotNull(small) == 0);
+    if (small) {
+        passed &= (assertTrue(json_object_build_index(doc, small)) == 0);
+        passed &= (assertTrue(json_get_int64(json_object_get(small, "a")) == 1) == 0);
+        passed &= (assertNotNull(json_object_get(small, "b")) == 0);
+        passed &= (assertNull(json_object_get(small, "c")) == 0);
+        passed &= (assertFalse(json_object_build_index(doc, json_object_get(small, "a"))) == 0);
+    }
+    json_value_t* empty = json_document_parse(doc, "{}");
+    passed &= (assertFalse(json_object_build_index(doc, empty)) == 0);
+    passed &= (assertNull(json_object_get(empty, "a")) == 0);
+    json_document_free(doc);
+
+    printf("✓ Object Index Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_key_pool() {
+    printf("=== Key Pool Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+    json_key_pool_t* pool = json_key_pool_create();
+    passed &= (assertNotNull(pool) == 0);
+    if (!pool) {
+        printf("✓ Key Pool Test: FAILED\n\n");
+        return;
+    }
+
+    // Test 1: Keys are shared across records and documents
+    printf("Test 1: Shared keys\n");
+    json_document_t* first = json_document_create();
+    json_document_t* second = json_document_create();
+    json_document_set_key_pool(first, pool);
+    json_document_set_key_pool(second, pool);
+
+    json_value_t* a = json_document_parse(first, "[{\"id\": 1, \"name\": \"x\"}, {\"name\": \"y\", \"id\": 2}]");
+    json_value_t* b = json_document_parse(second, "{\"id\": 3}");
+    passed &= (assertNotNull(a) == 0);
+    passed &= (assertNotNull(b) == 0);
+    if (a && b) {
+        const char* id = json_key_pool_intern(pool, "id");
+        passed &= (assertTrue(json_object_get_key(json_array_get(a, 0), 0) == id) == 0);
+        passed &= (assertTrue(json_object_get_key(json_array_get(a, 1), 1) == id) == 0);
+        passed &= (assertTrue(json_object_get_key(b, 0) == id) == 0);
+        passed &= (assertTrue(json_get_int64(json_object_get_interned(json_array_get(a, 1), id)) == 2) == 0);
+        passed &= (assertTrue(json_get_int64(json_object_get(b, "id")) == 3) == 0);
+        passed &= (assertNull(json_object_get_interned(b, json_key_pool_intern(pool, "name"))) == 0);
+    }
+
+    // Test 2: Indexed objects use the pooled hashes
+    printf("Test 2: Indexed lookups\n");
+    char json[1024];
+    size_t length = 0;
+    json[length++] = '{';
+    for (int i = 0; i < 40; i++) {
+        length += (size_t)sprintf(json + length, "%s\"field_%d\": %d", i ? ", " : "", i, i);
+    }
+    json[length++] = '}';
+    json[length] = '\0';
+    json_value_t* wide = json_document_parse(first, json);
+    passed &= (assertNotNull(wide) == 0);
+    if (wide) {
+        int all_found = 1;
+        char key[32];
+        for (int i = 0; i < 40; i++) {
+            sprintf(key, "field_%d", i);
+            all_found &= json_get_int64(json_object_get_interned(wide, json_key_pool_intern(pool, key))) == i;
+            all_found &= json_get_int64(json_object_get(wide, key)) == i;
+        }
+        passed &= (assertTrue(all_found) == 0);
+        passed &= (assertNull(json_object_get_interned(wide, json_key_pool_intern(pool, "field_40"))) == 0);
+    }
+
+    // Test 3: Decoded in-situ keys are interned
+    printf("Test 3: In-situ keys\n");
+    char buffer[] = "{\"i\\u0064\": 7}";
+    json_value_t* insitu = json_document_parse_insitu(first, buffer, strlen(buffer));
+    passed &= (assertNotNull(insitu) == 0);
+    if (insitu) {
+        passed &= (assertTrue(json_object_get_key(insitu, 0) == json_key_pool_intern(pool, "id")) == 0);
+    }
+
+    json_document_free(first);
+    json_document_free(second);
+    json_key_pool_free(pool);
+
+    printf("✓ Key Pool Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_length_aware_parsing() {
+    printf("=== Length-aware Parsing Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Only the given bytes are parsed
+    printf("Test 1: Slices\n");
+    const char* text = "[1, 2, 3]{\"unrelated\": true}";
+    json_value_t* slice = json_parse_n(text, 9);
+    passed &= (assertNotNull(slice) == 0);
+    if (slice) {
+        passed &= (assertEquals((int)json_get_array_size(slice), 3) == 0);
+        json_free(slice);
+    }
+    passed &= (assertNull(json_parse_n(text, 8)) == 0);
+
+    // Test 2: Buffers without a terminator
+    printf("Test 2: Unterminated buffers\n");
+    const char* samples[] = { "{\"key\": \"value\"}", "12345", "-0.5e3", "true", "\"text\"" };
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        size_t length = strlen(samples[i]);
+        char* exact = malloc(length);
+        memcpy(exact, samples[i], length);
+        json_value_t* value = json_parse_n(exact, length);
+        passed &= (assertNotNull(value) == 0);
+        json_free(value);
+        free(exact);
+    }
+
+    json_document_t* doc = json_document_create();
+    json_value_t* number = json_document_parse_n(doc, "42 is not JSON", 2);
+    passed &= (assertTrue(json_get_int64(number) == 42) == 0);
+    json_document_free(doc);
+
+    // Test 3: Files are parsed from the mapping
+    printf("Test 3: File parsing\n");
+    const char* path = "parse_file_test.json";
+    FILE* file = fopen(path, "wb");
+    passed &= (assertNotNull(file) == 0);
+    if (file) {
+        size_t count = 50000;
+        fputs("{\"items\": [", file);
+        for (size_t i = 0; i < count; i++) {
+            fprintf(file, "%s{\"id\": %zu, \"tag\": \"item %zu\"}", i ? ", " : "", i, i);
+        }
+        fputs("]}", file);
+        fclose(file);
+
+        json_value_t* root = json_parse_file(path);
+        passed &= (assertNotNull(root) == 0);
+        if (root) {
+            json_value_t* items = json_object_get(root, "items");
+            passed &= (assertEquals((int)json_get_array_size(items), (int)count) == 0);
+            passed &= (assertStringsMatch((char*)json_get_string(json_object_get(json_array_get(items, count - 1), "tag")),
+                "item 49999") == 0);
+            json_free(root);
+        }
+
+        file = fopen(path, "wb");
+        if (file) {
+            fclose(file);
+        }
+        passed &= (assertNull(json_parse_file(path)) == 0);
+        remove(path);
+    }
+    passed &= (assertNull(json_parse_file("missing_parse_file.json")) == 0);
+
+    printf("✓ Length-aware Parsing Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_tape() {
+    printf("=== Tape Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Scalars and nested containers
+    printf("Test 1: Accessors\n");
+    const char* json = "{\"name\": \"caf\\u00e9\", \"n\": -12, \"big\": 18446744073709551615, \"pi\": 3.5, "
+                       "\"ok\": true, \"none\": null, \"nested\": {\"list\": [[1, 2], {}, []]}, \"last\": \"x\"}";
+    json_tape_t* tape = json_tape_parse(json, strlen(json));
+    passed &= (assertNotNull(tape) == 0);
+    if (tape) {
+        json_tape_value_t root = json_tape_root(tape);
+        passed &= (assertTrue(json_tape_get_type(root) == JSON_OBJECT) == 0);
+        passed &= (assertEquals((int)json_tape_object_size(root), 8) == 0);
+        passed &= (assertStringsMatch((char*)json_tape_object_get_key(root, 7), "last") == 0);
+
+        size_t length = 0;
+        const char* name = json_tape_get_string(json_tape_object_get(root, "name"), &length);
+        passed &= (assertStringsMatch((char*)name, "caf\xc3\xa9") == 0);
+        passed &= (assertEquals((int)length, 5) == 0);
+        passed &= (assertTrue(json_tape_get_int64(json_tape_object_get(root, "n")) == -12) == 0);
+        passed &= (assertDoubleEquals(json_tape_get_number(json_tape_object_get(root, "big")), 18446744073709551615.0) == 0);
+        passed &= (assertDoubleEquals(json_tape_get_number(json_tape_object_get(root, "pi")), 3.5) == 0);
+        passed &= (assertTrue(json_tape_get_boolean(json_tape_object_get(root, "ok"))) == 0);
+        passed &= (assertTrue(json_tape_get_type(json_tape_object_get(root, "none")) == JSON_NULL) == 0);
+        passed &= (assertFalse(json_tape_is_valid(json_tape_object_get(root, "missing"))) == 0);
+
+        // Nested containers are skipped as a whole
+        json_tape_value_t list = json_tape_object_get(json_tape_object_get(root, "nested"), "list");
+        passed &= (assertEquals((int)json_tape_get_array_size(list), 3) == 0);
+        passed &= (assertTrue(json_tape_get_int64(json_tape_array_get(json_tape_array_get(list, 0), 1)) == 2) == 0);
+        passed &= (assertEquals((int)json_tape_object_size(json_tape_array_get(list, 1)), 0) == 0);
+        passed &= (assertFalse(json_tape_is_valid(json_tape_first(json_tape_array_get(list, 2)))) == 0);
+        passed &= (assertFalse(json_tape_is_valid(json_tape_array_get(list, 3))) == 0);
+        passed &= (assertStringsMatch((char*)json_tape_get_string(json_tape_object_get(root, "last"), NULL), "x") == 0);
+        passed &= (assertFalse(json_tape_is_valid(json_tape_next(root))) == 0);
+
+        json_tape_free(tape);
+    }
+
+    // Test 2: Iterating records matches the tree
+    printf("Test 2: Record scans\n");
+    size_t count = 20000;
+    char* records = malloc(count * 64 + 16);
+    size_t length = 0;
+    records[length++] = '[';
+    for (size_t i = 0; i < count; i++) {
+        length += (size_t)sprintf(records + length, "%s{\"id\": %zu, \"tags\": [\"a\", \"b\"], \"price\": %zu.25}",
+            i ? "," : "", i, i % 100);
+    }
+    records[length++] = ']';
+
+    tape = json_tape_parse(records, length);
+    json_value_t* tree = json_parse_n(records, length);
+    passed &= (assertNotNull(tape) == 0);
+    passed &= (assertNotNull(tree) == 0);
+    if (tape && tree) {
+        json_tape_value_t root = json_tape_root(tape);
+        passed &= (assertEquals((int)json_tape_get_array_size(root), (int)count) == 0);
+
+        double tape_total = 0, tree_total = 0;
+        size_t visited = 0;
+        int keys_match = 1;
+        for (json_tape_value_t item = json_tape_first(root); json_tape_is_valid(item); item = json_tape_next(item)) {
+            json_tape_value_t member = json_tape_first(item);
+            keys_match &= strcmp(json_tape_key(member), "id") == 0 && json_tape_get_int64(member) == (int64_t)visited;
+            tape_total += json_tape_get_number(json_tape_object_get(item, "price"));
+            tree_total += json_get_number(json_object_get(json_array_get(tree, visited), "price"));
+            visited++;
+        }
+        passed &= (assertEquals((int)visited, (int)count) == 0);
+        passed &= (assertTrue(keys_match) == 0);
+        passed &= (assertDoubleEquals(tape_total, tree_total) == 0);
+        passed &= (assertNull((char*)json_tape_key(json_tape_first(root))) == 0);
+    }
+    json_tape_free(tape);
+    json_free(tree);
+    free(records);
+
+    // Test 3: Invalid input
+    printf("Test 3: Errors\n");
+    passed &= (assertNull(json_tape_parse("[1, 2", 5)) == 0);
+    passed &= (assertNull(json_tape_parse("{\"a\" 1}", 7)) == 0);
+    passed &= (assertNull(json_tape_parse("", 0)) == 0);
+    passed &= (assertFalse(json_tape_is_valid(json_tape_root(NULL))) == 0);
+
+    printf("✓ Tape Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+typedef struct {
+    double total;
+    size_t stop_after;
+    size_t seen;
+} path_sum_t;
+
+static int path_sum_value(void* ctx, json_value_t* match) {
+    path_sum_t* sum = ctx;
+    sum->total += json_get_number(match);
+    return ++sum->seen != sum->stop_after;
+}
+
+static int path_sum_od(void* ctx, const json_od_value_t* match) {
+    path_sum_t* sum = ctx;
+    double value = 0;
+    json_od_get_double(match, &value);
+    sum->total += value;
+    return ++sum->seen != sum->stop_after;
+}
+
+void test_json_path() {
+    printf("=== JSON Path Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+    const char* json = "{\"items\": [{\"price\": 1.5, \"tags\": [\"a\"]}, {\"price\": 2}, {\"name\": \"free\"}, "
+                       "{\"price\": 4, \"extra\": {\"deep\": [1, 2, 3]}}], "
+                       "\"a/b\": {\"m~n\": 7}, \"odd key\": {\"x\": true}, \"list\": [10, 20, 30]}";
+    json_value_t* root = json_parse(json);
+    json_od_parser_t* parser = json_od_parser_create();
+    json_od_value_t cursor;
+    passed &= (assertNotNull(root) == 0);
+    passed &= (assertTrue(json_od_iterate(parser, json, strlen(json), &cursor)) == 0);
+    if (!root) {
+        json_od_parser_free(parser);
+        printf("✓ JSON Path Test: FAILED\n\n");
+        return;
+    }
+
+    // Test 1: Wildcards over the tree and the cursor agree
+    printf("Test 1: Wildcards\n");
+    json_path_t* prices = json_path_compile("$.items[*].price");
+    passed &= (assertNotNull(prices) == 0);
+    path_sum_t tree_sum = { 0 }, od_sum = { 0 };
+    passed &= (assertEquals((int)json_path_select(prices, root, path_sum_value, &tree_sum), 3) == 0);
+    passed &= (assertEquals((int)json_path_select_od(prices, &cursor, path_sum_od, &od_sum), 3) == 0);
+    passed &= (assertDoubleEquals(tree_sum.total, 7.5) == 0);
+    passed &= (assertDoubleEquals(od_sum.total, 7.5) == 0);
+
+    // A compiled path is reused, and callbacks can stop early
+    path_sum_t first_two = { 0, 2, 0 };
+    passed &= (assertEquals((int)json_path_select(prices, root, path_sum_value, &first_two), 2) == 0);
+    passed &= (assertDoubleEquals(first_two.total, 3.5) == 0);
+    json_path_free(prices);
+
+    json_path_t* values = json_path_compile("$.list.*");
+    path_sum_t list_sum = { 0 };
+    passed &= (assertEquals((int)json_path_select_od(values, &cursor, path_sum_od, &list_sum), 3) == 0);
+    passed &= (assertDoubleEquals(list_sum.total, 60) == 0);
+    json_path_free(values);
+
+    // Test 2: Single matches
+    printf("Test 2: Indexes and keys\n");
+    const char* expressions[] = {
+        "$.items[3].extra.deep[2]", "$['odd key'].x", "$[\"list\"][1]", "/a~1b/m~0n", "/items/3/extra/deep/0"
+    };
+    double expected[] = { 3, 1, 20, 7, 1 };
+    for (size_t i = 0; i < sizeof(expressions) / sizeof(expressions[0]); i++) {
+        json_path_t* path = json_path_compile(expressions[i]);
+        passed &= (assertNotNull(path) == 0);
+
+        json_value_t* match = json_path_get(path, root);
+        json_od_value_t od_match;
+        double od_value = 0;
+        passed &= (assertNotNull(match) == 0);
+        passed &= (assertTrue(json_path_get_od(path, &cursor, &od_match)) == 0);
+        if (json_od_get_type(&od_match) == JSON_BOOL) {
+            int flag = 0;
+            json_od_get_bool(&od_match, &flag);
+            od_value = flag;
+            passed &= (assertDoubleEquals(json_get_boolean(match), expected[i]) == 0);
+        }
+        else {
+            json_od_get_double(&od_match, &od_value);
+            passed &= (assertDoubleEquals(json_get_number(match), expected[i]) == 0);
+        }
+        passed &= (assertDoubleEquals(od_value, expected[i]) == 0);
+        json_path_free(path);
+    }
+
+    json_path_t* whole = json_path_compile("");
+    passed &= (assertTrue(json_path_get(whole, root) == root) == 0);
+    json_path_free(whole);
+
+    json_path_t* missing = json_path_compile("$.items[9].price");
+    json_od_value_t unused;
+    passed &= (assertNull(json_path_get(missing, root)) == 0);
+    passed &= (assertFalse(json_path_get_od(missing, &cursor, &unused)) == 0);
+    json_path_free(missing);
+
+    // Test 3: Syntax errors
+    printf("Test 3: Syntax errors\n");
+    const char* invalid[] = { "$..price", "$.items[", "$.items[01]", "$['open", "items", "/a~2", "$.", "$x" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        passed &= (assertNull(json_path_compile(invalid[i])) == 0);
+    }
+
+    json_od_parser_free(parser);
+    json_free(root);
+
+    printf("✓ JSON Path Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+static char* make_nested(size_t depth, int objects) {
+    const char* open = objects ? "{\"a\":" : "[";
+    size_t open_length = strlen(open);
+    char* json = malloc(depth * (open_length + 1) + 2);
+    size_t length = 0;
+    for (size_t i = 0; i < depth; i++) {
+        memcpy(json + length, open, open_length);
+        length += open_length;
+    }
+    json[length++] = '1';
+    memset(json + length, objects ? '}' : ']', depth);
+    json[length + depth] = '\0';
+    return json;
+}
+
+void test_depth_limit() {
+    printf("=== Depth Limit Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Hostile nesting fails instead of overflowing the stack
+    printf("Test 1: Default limit\n");
+    size_t hostile_depth = 1000000;
+    char* hostile = malloc(hostile_depth);
+    memset(hostile, '[', hostile_depth);
+    passed &= (assertNull(json_parse_n(hostile, hostile_depth)) == 0);
+    free(hostile);
+
+    char* at_limit = make_nested(JSON_DEFAULT_MAX_DEPTH, 0);
+    char* over_limit = make_nested(JSON_DEFAULT_MAX_DEPTH + 1, 0);
+    json_value_t* root = json_parse(at_limit);
+    passed &= (assertNotNull(root) == 0);
+    if (root) {
+        json_value_t* value = root;
+        size_t depth = 0;
+        while (json_get_type(value) == JSON_ARRAY) {
+            value = json_array_get(value, 0);
+            depth++;
+        }
+        passed &= (assertEquals((int)depth, JSON_DEFAULT_MAX_DEPTH) == 0);
+        passed &= (assertTrue(json_get_int64(value) == 1) == 0);
+        json_free(root);
+    }
+    passed &= (assertNull(json_parse(over_limit)) == 0);
+    free(at_limit);
+    free(over_limit);
+
+    // Test 2: The limit is per document and the stack is reused
+    printf("Test 2: Configured limit\n");
+    json_document_t* doc = json_document_create();
+    json_document_set_max_depth(doc, 200000);
+    for (int objects = 0; objects <= 1; objects++) {
+        char* deep = make_nested(100000, objects);
+        json_value_t* value = json_document_parse(doc, deep);
+        passed &= (assertNotNull(value) == 0);
+        for (size_t i = 0; value && i < 100000; i++) {
+            value = objects ? json_object_get(value, "a") : json_array_get(value, 0);
+        }
+        passed &= (assertTrue(json_get_int64(value) == 1) == 0);
+        free(deep);
+    }
+
+    json_document_set_max_depth(doc, 3);
+    passed &= (assertNotNull(json_document_parse(doc, "[{\"a\": [1, 2]}, [], {\"b\": []}]")) == 0);
+    passed &= (assertNull(json_document_parse(doc, "[{\"a\": [1, {\"b\": []}]}]")) == 0);
+    json_document_set_max_depth(doc, 0);
+    passed &= (assertNotNull(json_document_parse(doc, "\"scalar\"")) == 0);
+    passed &= (assertNull(json_document_parse(doc, "[]")) == 0);
+    json_document_free(doc);
+
+    // Test 3: Errors inside nested containers
+    printf("Test 3: Nested errors\n");
+    const char* invalid[] = {
+        "[1, [2, 3}", "{\"a\": [1, 2]", "[{\"a\" 1}]", "{\"a\": {\"b\": 1,}}", "[[[]]]]", "[1 2]", "{,}", "[truefalse]"
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        passed &= (assertNull(json_parse(invalid[i])) == 0);
+    }
+
+    printf("✓ Depth Limit Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_parse_parallel() {
+    printf("=== Parallel Parse Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+    size_t count = 40000;
+    char* json = malloc(count * 128 + 16);
+    size_t length = 0;
+
+    // Strings with commas and brackets must not be taken for boundaries
+    length += (size_t)sprintf(json + length, " [\n");
+    for (size_t i = 0; i < count; i++) {
+        length += (size_t)sprintf(json + length, "%s{\"id\": %zu, \"text\": \"a, [b] {c} \\\"%zu\\\"\", \"list\": [%zu, [true, null]]}",
+            i ? ",\n" : "", i, i, i * 3);
+    }
+    length += (size_t)sprintf(json + length, "\n] ");
+
+    // Test 1: Same tree as the serial parser
+    printf("Test 1: Split arrays\n");
+    json_value_t* serial = json_parse_n(json, length);
+    char* expected = json_serialize(serial);
+    size_t threads[] = { 1, 2, 4, 0 };
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        json_value_t* root = json_parse_parallel(json, length, threads[t]);
+        passed &= (assertNotNull(root) == 0);
+        if (root) {
+            passed &= (assertEquals((int)json_get_array_size(root), (int)count) == 0);
+            char* actual = json_serialize(root);
+            passed &= (assertTrue(actual && expected && strcmp(actual, expected) == 0) == 0);
+            free(actual);
+            json_free(root);
+        }
+    }
+    free(expected);
+    json_free(serial);
+
+    // Test 2: Malformed arrays fail like the serial parser
+    printf("Test 2: Errors\n");
+    char saved = json[length / 2];
+    json[length / 2] = ']';
+    passed &= (assertNull(json_parse_parallel(json, length, 4)) == 0);
+    json[length / 2] = saved;
+    passed &= (assertNull(json_parse_parallel(json, length - 3, 4)) == 0);
+
+    memcpy(json + length, ", 1", 3);
+    passed &= (assertNull(json_parse_parallel(json, length + 3, 4)) == 0);
+
+    char* trailing = strrchr(json, '}');
+    trailing[1] = ',';
+    passed &= (assertNull(json_parse_parallel(json, length, 4)) == 0);
+    free(json);
+
+    // Test 3: Other inputs are parsed serially
+    printf("Test 3: Small and non-array inputs\n");
+    json_value_t* object = json_parse_parallel("{\"a\": [1, 2]}", 13, 4);
+    passed &= (assertTrue(json_get_type(object) == JSON_OBJECT) == 0);
+    json_free(object);
+    json_value_t* empty = json_parse_parallel("[]", 2, 4);
+    passed &= (assertTrue(json_get_type(empty) == JSON_ARRAY && json_get_array_size(empty) == 0) == 0);
+    json_free(empty);
+
+    printf("✓ Parallel Parse Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+typedef struct {
+    char city[16];
+    int zip;
+} bind_address_t;
+
+typedef struct {
+    int64_t id;
+    char name[32];
+    double balance;
+    int active;
+    int retries;
+    bind_address_t address;
+} bind_account_t;
+
+static const json_bind_field_t bind_address_fields[] = {
+    { "city", offsetof(bind_address_t, city), JSON_BIND_STRING, sizeof(((bind_address_t*)0)->city), NULL },
+    { "zip", offsetof(bind_address_t, zip), JSON_BIND_INT, 0, NULL }
+};
+static const json_bind_desc_t bind_address_desc = { bind_address_fields, 2 };
+
+static const json_bind_field_t bind_account_fields[] = {
+    { "id", offsetof(bind_account_t, id), JSON_BIND_INT64, 0, NULL },
+    { "name", offsetof(bind_account_t, name), JSON_BIND_STRING, sizeof(((bind_account_t*)0)->name), NULL },
+    { "balance", offsetof(bind_account_t, balance), JSON_BIND_DOUBLE, 0, NULL },
+    { "active", offsetof(bind_account_t, active), JSON_BIND_BOOL, 0, NULL },
+    { "retries", offsetof(bind_account_t, retries), JSON_BIND_INT, 0, NULL },
+    { "address", offsetof(bind_account_t, address), JSON_BIND_OBJECT, 0, &bind_address_desc }
+};
+static const json_bind_desc_t bind_account_desc = { bind_account_fields, 6 };
+
+void test_bind() {
+    printf("=== Struct Binding Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Known members are written, unknown ones skipped
+    printf("Test 1: Binding\n");
+    const char* json = "{\"id\": 9007199254740993, \"skip\": {\"deep\": [1, {\"name\": \"no\"}]}, "
+                       "\"name\": \"Ada \\u00e9\", \"balance\": -12.5, \"active\": true, \"retries\": null, "
+                       "\"address\": {\"zip\": 12345, \"city\": \"Paris\", \"extra\": [1, 2]}}";
+    bind_account_t account = { 0, "", 0, 0, 3, { "", 0 } };
+    passed &= (assertTrue(json_bind(json, strlen(json), &bind_account_desc, &account)) == 0);
+    passed &= (assertTrue(account.id == INT64_C(9007199254740993)) == 0);
+    passed &= (assertStringsMatch(account.name, "Ada \xc3\xa9") == 0);
+    passed &= (assertDoubleEquals(account.balance, -12.5) == 0);
+    passed &= (assertEquals(account.active, 1) == 0);
+    passed &= (assertEquals(account.retries, 3) == 0);
+    passed &= (assertStringsMatch(account.address.city, "Paris") == 0);
+    passed &= (assertEquals(account.address.zip, 12345) == 0);
+
+    // Test 2: Binding from a reusable cursor
+    printf("Test 2: Cursors\n");
+    json_od_parser_t* parser = json_od_parser_create();
+    const char* batch = "[{\"zip\": 1, \"city\": \"A\"}, {\"city\": \"B\", \"zip\": 2}]";
+    json_od_value_t root, element;
+    json_od_iterator_t it;
+    int zip_sum = 0;
+    passed &= (assertTrue(json_od_iterate(parser, batch, strlen(batch), &root)) == 0);
+    passed &= (assertTrue(json_od_array_begin(&root, &it)) == 0);
+    while (json_od_array_next(&it, &element)) {
+        bind_address_t address = { "", 0 };
+        passed &= (assertTrue(json_bind_value(&element, &bind_address_desc, &address)) == 0);
+        zip_sum += address.zip;
+    }
+    passed &= (assertEquals(zip_sum, 3) == 0);
+    json_od_parser_free(parser);
+
+    // Test 3: Mismatches and malformed input fail
+    printf("Test 3: Errors\n");
+    const char* invalid[] = {
+        "{\"id\": \"7\"}",
+        "{\"name\": \"a name that does not fit in the buffer\"}",
+        "{\"retries\": 4294967296}",
+        "{\"retries\": -2147483649}",
+        "{\"retries\": 1.5}",
+        "{\"id\": 2.5}",
+        "{\"id\": 9223372036854775808}",
+        "{\"id\": 1e19}",
+        "{\"address\": {\"zip\": 0.5}}",
+        "{\"address\": [1]}",
+        "{\"active\": 1}",
+        "[1, 2]",
+        "{\"id\": 1} {}",
+        "{\"id\": 1"
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        bind_account_t scratch = { 0 };
+        passed &= (assertFalse(json_bind(invalid[i], strlen(invalid[i]), &bind_account_desc, &scratch)) == 0);
+    }
+
+    // Test 4: Integer fields take reals only when they are integral
+    printf("Test 4: Integral reals\n");
+    bind_account_t integral = { 0 };
+    const char* reals = "{\"id\": -4e3, \"retries\": 2.0}";
+    passed &= (assertTrue(json_bind(reals, strlen(reals), &bind_account_desc, &integral)) == 0);
+    passed &= (assertTrue(integral.id == -4000) == 0);
+    passed &= (assertEquals(integral.retries, 2) == 0);
+
+    printf("✓ Struct Binding Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_compact_values() {
+    printf("=== Compact Value Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Values fit in 16 bytes
+    printf("Test 1: Value size\n");
+    passed &= (assertEquals((int)sizeof(json_value_t), 16) == 0);
+
+    // Test 2: Strings on both sides of the inline limit
+    printf("Test 2: Inline and heap strings\n");
+    const char* json = "[\"\", \"abcdefghijklmn\", \"abcdefghijklmno\", \"q\", "
+                       "-9223372036854775808, 18446744073709551615, 0.5, true, [], {}]";
+    json_value_t* root = json_parse(json);
+    passed &= (assertNotNull(root) == 0);
+    passed &= (assertStringsMatch((char*)json_get_string(json_array_get(root, 0)), "") == 0);
+    passed &= (assertStringsMatch((char*)json_get_string(json_array_get(root, 1)), "abcdefghijklmn") == 0);
+    passed &= (assertStringsMatch((char*)json_get_string(json_array_get(root, 2)), "abcdefghijklmno") == 0);
+
+    // Test 3: Number representations and other types survive packing
+    printf("Test 3: Packed tags\n");
+    passed &= (assertTrue(json_get_number_repr(json_array_get(root, 4)) == JSON_INTEGER) == 0);
+    passed &= (assertTrue(json_get_int64(json_array_get(root, 4)) == INT64_MIN) == 0);
+    passed &= (assertTrue(json_get_number_repr(json_array_get(root, 5)) == JSON_UNSIGNED) == 0);
+    passed &= (assertTrue(json_get_uint64(json_array_get(root, 5)) == UINT64_MAX) == 0);
+    passed &= (assertDoubleEquals(json_get_number(json_array_get(root, 6)), 0.5) == 0);
+    passed &= (assertEquals(json_get_boolean(json_array_get(root, 7)), 1) == 0);
+    passed &= (assertEquals((int)json_get_array_size(json_array_get(root, 8)), 0) == 0);
+    passed &= (assertEquals((int)json_object_size(json_array_get(root, 9)), 0) == 0);
+
+    char* serialized = json_serialize(root);
+    passed &= (assertStringsMatch(serialized, "[\"\",\"abcdefghijklmn\",\"abcdefghijklmno\",\"q\","
+                                              "-9223372036854775808,18446744073709551615,0.5,true,[],{}]") == 0);
+    free(serialized);
+    json_free(root);
+
+    // Test 4: Short strings and roots built from events
+    printf("Test 4: Push parser\n");
+    json_push_parser_t* parser = json_push_parser_create(NULL, NULL);
+    const char* chunks[] = { "{\"short\": \"ab", "c\", \"long\": \"0123456789abcdef\"}" };
+    for (size_t i = 0; i < 2; i++) {
+        passed &= (assertTrue(json_push_feed(parser, chunks[i], strlen(chunks[i]))) == 0);
+    }
+    passed &= (assertTrue(json_push_finish(parser)) == 0);
+    json_value_t* pushed = json_push_take_root(parser);
+    passed &= (assertStringsMatch((char*)json_get_string(json_object_get(pushed, "short")), "abc") == 0);
+    passed &= (assertStringsMatch((char*)json_get_string(json_object_get(pushed, "long")), "0123456789abcdef") == 0);
+    json_free(pushed);
+    json_push_parser_free(parser);
+
+    json_value_t* scalar = json_parse("\"root\"");
+    passed &= (assertStringsMatch((char*)json_get_string(scalar), "root") == 0);
+    json_free(scalar);
+
+    printf("✓ Compact Value Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_memory_reuse() {
+    printf("=== Memory Reuse Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Documents of mixed sizes freed out of order
+    printf("Test 1: Interleaved documents\n");
+    enum { LIVE = 8, ROUNDS = 200 };
+    json_value_t* live[LIVE] = { NULL };
+    char* expected[LIVE] = { NULL };
+    char* json = malloc(64 * 1024);
+    int intact = 1;
+    for (size_t round = 0; round < ROUNDS; round++) {
+        size_t slot = (round * 5) % LIVE;
+        if (live[slot]) {
+            char* actual = json_serialize(live[slot]);
+            intact &= actual && strcmp(actual, expected[slot]) == 0;
+            free(actual);
+            free(expected[slot]);
+            json_free(live[slot]);
+        }
+
+        // Sizes cycle from a few bytes to past the largest recycled block
+        size_t count = (size_t)1 << (round % 12);
+        size_t length = 0;
+        json[length++] = '[';
+        for (size_t i = 0; i < count && length < 60 * 1024; i++) {
+            length += (size_t)sprintf(json + length, "%s{\"r\":%zu,\"s\":\"item %zu of a long enough string\"}",
+                i ? "," : "", round, i);
+        }
+        json[length++] = ']';
+        json[length] = '\0';
+
+        live[slot] = json_parse(json);
+        expected[slot] = json_serialize(live[slot]);
+        intact &= live[slot] != NULL && expected[slot] != NULL;
+    }
+    for (size_t slot = 0; slot < LIVE; slot++) {
+        free(expected[slot]);
+        json_free(live[slot]);
+    }
+    free(json);
+    passed &= (assertTrue(intact) == 0);
+
+    // Test 2: Trees built on worker threads and freed on this one
+    printf("Test 2: Blocks crossing threads\n");
+    size_t count = 20000;
+    json = malloc(count * 32 + 16);
+    size_t length = 0;
+    json[length++] = '[';
+    for (size_t i = 0; i < count; i++) {
+        length += (size_t)sprintf(json + length, "%s{\"id\": %zu}", i ? ", " : "", i);
+    }
+    json[length++] = ']';
+    for (int round = 0; round < 4; round++) {
+        json_value_t* root = json_parse_parallel(json, length, 4);
+        passed &= (assertEquals((int)json_get_array_size(root), (int)count) == 0);
+        passed &= (assertTrue(json_get_int64(json_object_get(json_array_get(root, count - 1), "id")) == (int64_t)count - 1) == 0);
+        json_free(root);
+    }
+    free(json);
+
+    json_value_t* small = json_parse("{\"after\": [1, 2, 3]}");
+    passed &= (assertEquals((int)json_get_array_size(json_object_get(small, "after")), 3) == 0);
+    json_free(small);
+
+    printf("✓ Memory Reuse Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_validate() {
+    printf("=== Validate Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+    json_error_t error;
+
+    // Test 1: Valid documents, including multi-byte text crossing blocks
+    printf("Test 1: Valid documents\n");
+    passed &= (assertTrue(json_validate("{\"a\": [1, -2.5e3, true, null, \"x\\u00e9\\ud83d\\ude00\"]}", 53, &error)) == 0);
+    passed &= (assertTrue(json_validate(" 42 ", 4, NULL)) == 0);
+    passed &= (assertTrue(json_validate("\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\"", 11, NULL)) == 0);
+    char text[200];
+    size_t length = 0;
+    text[length++] = '"';
+    while (length < 60) text[length++] = 'a';
+    // A four-byte sequence split across the first 64-byte boundary
+    memcpy(text + length, "\xf0\x9f\x98\x80", 4);
+    length += 4;
+    while (length < 150) text[length++] = 'b';
+    text[length++] = '"';
+    passed &= (assertTrue(json_validate(text, length, &error)) == 0);
+
+    // Test 2: Syntax errors report the offending byte
+    printf("Test 2: Syntax errors\n");
+    passed &= (assertFalse(json_validate("[1, 2,]", 7, &error)) == 0);
+    passed &= (assertEquals((int)error.offset, 6) == 0);
+    passed &= (assertNotNull((void*)error.message) == 0);
+    passed &= (assertFalse(json_validate("{\"a\" 1}", 7, &error)) == 0);
+    passed &= (assertEquals((int)error.offset, 5) == 0);
+    passed &= (assertFalse(json_validate("[1] 2", 5, &error)) == 0);
+    passed &= (assertEquals((int)error.offset, 4) == 0);
+    passed &= (assertFalse(json_validate("[01]", 4, NULL)) == 0);
+    passed &= (assertFalse(json_validate("[tru]", 5, NULL)) == 0);
+    passed &= (assertFalse(json_validate("", 0, &error)) == 0);
+    passed &= (assertFalse(json_validate("[1, 2", 5, &error)) == 0);
+    passed &= (assertEquals((int)error.offset, 5) == 0);
+    passed &= (assertFalse(json_validate("[\"abc", 5, &error)) == 0);
+    passed &= (assertEquals((int)error.offset, 1) == 0);
+    passed &= (assertFalse(json_validate(NULL, 0, &error)) == 0);
+
+    // Test 3: Strings
+    printf("Test 3: String contents\n");
+    passed &= (assertFalse(json_validate("[\"a\tb\"]", 7, &error)) == 0);
+    passed &= (assertEquals((int)error.offset, 3) == 0);
+    passed &= (assertFalse(json_validate("[\"\\x\"]", 6, &error)) == 0);
+    passed &= (assertEquals((int)error.offset, 2) == 0);
+    passed &= (assertFalse(json_validate("[\"\\ud800\"]", 10, NULL)) == 0);
+    passed &= (assertFalse(json_validate("[\"\\udc00\"]", 10, NULL)) == 0);
+    passed &= (assertFalse(json_validate("[\"\\u12g4\"]", 10, NULL)) == 0);
+
+    // Test 4: Invalid UTF-8
+    printf("Test 4: Invalid UTF-8\n");
+    passed &= (assertFalse(json_validate("[\"\xc0\xaf\"]", 6, &error)) == 0);
+    passed &= (assertEquals((int)error.offset, 2) == 0);
+    passed &= (assertFalse(json_validate("[\"\xed\xa0\x80\"]", 7, NULL)) == 0);
+    passed &= (assertFalse(json_validate("[\"\xf4\x90\x80\x80\"]", 8, NULL)) == 0);
+    passed &= (assertFalse(json_validate("\"\xe2\x82", 3, NULL)) == 0);
+    text[62] = 'c';
+    passed &= (assertFalse(json_validate(text, length, &error)) == 0);
+    passed &= (assertEquals((int)error.offset, 62) == 0);
+
+    // Test 5: Nesting limit
+    printf("Test 5: Nesting limit\n");
+    char* deep = malloc(2 * (JSON_DEFAULT_MAX_DEPTH + 1));
+    for (size_t i = 0; i <= JSON_DEFAULT_MAX_DEPTH; i++) {
+        deep[i] = '[';
+        deep[2 * JSON_DEFAULT_MAX_DEPTH + 1 - i] = ']';
+    }
+    passed &= (assertTrue(json_validate(deep + 1, 2 * JSON_DEFAULT_MAX_DEPTH, NULL)) == 0);
+    passed &= (assertFalse(json_validate(deep, 2 * (JSON_DEFAULT_MAX_DEPTH + 1), &error)) == 0);
+    passed &= (assertEquals((int)error.offset, JSON_DEFAULT_MAX_DEPTH) == 0);
+    free(deep);
+
+    printf("✓ Validate Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_string_decoding() {
+    printf("=== String Decoding Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Escapes are decoded in copied strings and keys
+    printf("Test 1: Decoded strings\n");
+    json_value_t* root = json_parse("{\"q\\\"k\": \"a\\\"b\", \"path\": \"a\\/b\\\\c\\td\", "
+        "\"name\": \"caf\\u00e9 au lait, s'il vous pla\\u00eet\", \"emoji\": \"\\ud83c\\udf0d\"}");
+    passed &= (assertNotNull(root) == 0);
+    if (root) {
+        passed &= (assertStringsMatch((char*)json_object_get_key(root, 0), "q\"k") == 0);
+        passed &= (assertStringsMatch((char*)json_get_string(json_object_get(root, "q\"k")), "a\"b") == 0);
+        passed &= (assertStringsMatch((char*)json_get_string(json_object_get(root, "path")), "a/b\\c\td") == 0);
+        passed &= (assertStringsMatch((char*)json_get_string(json_object_get(root, "name")),
+            "caf\xc3\xa9 au lait, s'il vous pla\xc3\xaet") == 0);
+        passed &= (assertStringsMatch((char*)json_get_string(json_object_get(root, "emoji")), "\xf0\x9f\x8c\x8d") == 0);
+        json_free(root);
+    }
+
+    // Test 2: Escapes on either side of every 16-byte boundary
+    printf("Test 2: Escapes around vector boundaries\n");
+    int decoded = 1;
+    for (size_t offset = 0; offset < 40; offset++) {
+        char json[128];
+        char expected[64];
+        memset(json, 'x', sizeof(json));
+        memset(expected, 'x', offset);
+        json[0] = '"';
+        memcpy(json + 1 + offset, "\\n\\u20ac", 8);
+        memcpy(expected + offset, "\n\xe2\x82\xac", 4);
+        memcpy(json + 1 + offset + 8, "yz\"", 4);
+        memcpy(expected + offset + 4, "yz", 3);
+
+        json_value_t* value = json_parse(json);
+        decoded &= value != NULL && strcmp(json_get_string(value), expected) == 0;
+        json_free(value);
+    }
+    passed &= (assertTrue(decoded) == 0);
+
+    // Test 3: Decoded strings serialize back to the same text
+    printf("Test 3: Round trip\n");
+    const char* text = "[\"line\\nbreak\",\"quote \\\"q\\\" and \\\\\",\"\\u0001\"]";
+    root = json_parse(text);
+    char* serialized = json_serialize(root);
+    passed &= (assertNotNull(serialized) == 0);
+    if (serialized) {
+        passed &= (assertStringsMatch(serialized, "[\"line\\nbreak\",\"quote \\\"q\\\" and \\\\\",\"\\u0001\"]") == 0);
+        free(serialized);
+    }
+    json_free(root);
+
+    // Test 4: Malformed escapes are rejected
+    printf("Test 4: Invalid escapes\n");
+    passed &= (assertNull(json_parse("[\"\\x\"]")) == 0);
+    passed &= (assertNull(json_parse("[\"a long enough string \\ud800\"]")) == 0);
+    passed &= (assertNull(json_parse("{\"\\u12\": 1}")) == 0);
+
+    printf("✓ String Decoding Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_projected_parsing() {
+    printf("=== Projected Parsing Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+    const char* payload =
+        "{\"vendor\": {\"name\": \"Acme }]\\\" Corp\", \"tags\": [[1, 2], {\"deep\": [3]}]},"
+        " \"invoice\": {\"id\": \"INV-7\", \"notes\": \"skip me\", \"total\": 99.5},"
+        " \"lines\": [{\"sku\": \"A1\", \"qty\": 2}, {\"qty\": 1, \"sku\": \"B2\"}, {\"qty\": 3}],"
+        " \"meta\": [true, {\"x\": null}], \"trailer\": \"end\"}";
+
+    // Test 1: Only the selected paths and the containers leading to them
+    printf("Test 1: Selected fields\n");
+    const char* fields[] = { "$.invoice.id", "$.invoice.total", "$.lines[*].sku", "/meta/0", "$.missing" };
+    json_projection_t* projection = json_projection_compile(fields, 5);
+    passed &= (assertNotNull(projection) == 0);
+    json_value_t* root = json_parse_projected(payload, strlen(payload), projection);
+    passed &= (assertNotNull(root) == 0);
+    char* json = json_serialize(root);
+    passed &= (assertNotNull(json) == 0);
+    if (json) {
+        passed &= (assertStringsMatch(json, "{\"invoice\":{\"id\":\"INV-7\",\"total\":99.5},"
+            "\"lines\":[{\"sku\":\"A1\"},{\"sku\":\"B2\"},{}],\"meta\":[true]}") == 0);
+        free(json);
+    }
+    json_free(root);
+    json_projection_free(projection);
+
+    // Test 2: A wildcard and a named element of the same array
+    printf("Test 2: Overlapping paths\n");
+    const char* overlapping[] = { "$.lines[*].qty", "$.lines[1]", "$.vendor.tags[1]" };
+    projection = json_projection_compile(overlapping, 3);
+    root = json_parse_projected(payload, strlen(payload), projection);
+    json = json_serialize(root);
+    passed &= (assertNotNull(json) == 0);
+    if (json) {
+        passed &= (assertStringsMatch(json, "{\"vendor\":{\"tags\":[{\"deep\":[3]}]},"
+            "\"lines\":[{\"qty\":2},{\"qty\":1,\"sku\":\"B2\"},{\"qty\":3}]}") == 0);
+        free(json);
+    }
+    json_free(root);
+    json_projection_free(projection);
+
+    // A pointer token and a bracket index naming the same element, in either order
+    const char* rows = "[{\"x\":1,\"y\":2,\"z\":3}]";
+    const char* pointer_first[] = { "/0/y", "$[0].x" };
+    const char* index_first[] = { "$[0].x", "/0/y" };
+    const char* const* mixed[] = { pointer_first, index_first };
+    for (size_t order = 0; order < 2; order++) {
+        projection = json_projection_compile(mixed[order], 2);
+        root = json_parse_projected(rows, strlen(rows), projection);
+        json = json_serialize(root);
+        passed &= (assertNotNull(json) == 0);
+        if (json) {
+            passed &= (assertStringsMatch(json, "[{\"x\":1,\"y\":2}]") == 0);
+            free(json);
+        }
+        json_free(root);
+        json_projection_free(projection);
+    }
+
+    // Test 3: Escaped keys, whole documents and scalar roots
+    printf("Test 3: Keys and roots\n");
+    const char* key_path[] = { "$.key" };
+    projection = json_projection_compile(key_path, 1);
+    const char* escaped = "{\"k\\u0065y\": 1, \"other\": 2}";
+    root = json_parse_projected(escaped, strlen(escaped), projection);
+    passed &= (assertEquals((int)json_object_size(root), 1) == 0);
+    passed &= (assertDoubleEquals(json_get_number(json_object_get(root, "key")), 1.0) == 0);
+    json_free(root);
+    root = json_parse_projected("42", 2, projection);
+    passed &= (assertDoubleEquals(json_get_number(root), 42.0) == 0);
+    json_free(root);
+    json_projection_free(projection);
+
+    const char* everything[] = { "$.vendor", "$" };
+    projection = json_projection_compile(everything, 2);
+    root = json_parse_projected(payload, strlen(payload), projection);
+    passed &= (assertEquals((int)json_object_size(root), 5) == 0);
+    json_free(root);
+    json_projection_free(projection);
+
+    // Test 4: Errors
+    printf("Test 4: Invalid paths and input\n");
+    const char* invalid[] = { "$.a", "$[" };
+    passed &= (assertNull(json_projection_compile(invalid, 2)) == 0);
+    projection = json_projection_compile(fields, 2);
+    passed &= (assertNull(json_parse_projected("{\"invoice\": {\"id\": tru}}", 24, projection)) == 0);
+    passed &= (assertNull(json_parse_projected("{\"skipped\": [1, 2}", 18, projection)) == 0);
+    passed &= (assertNull(json_parse_projected("{\"skipped\": [1, 2]", 18, projection)) == 0);
+    json_projection_free(projection);
+
+    printf("✓ Projected Parsing Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_string_escaping() {
+    printf("=== String Escaping Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Every kind of escape, in keys and values
+    printf("Test 1: Escape sequences\n");
+    json_value_t* root = json_parse("{\"k\\\"\\\\\": \"\\b\\f\\n\\r\\t\\u0001\\u001f/\\u00e9\"}");
+    char* json = json_serialize(root);
+    passed &= (assertNotNull(json) == 0);
+    if (json) {
+        passed &= (assertStringsMatch(json, "{\"k\\\"\\\\\":\"\\b\\f\\n\\r\\t\\u0001\\u001f/\xc3\xa9\"}") == 0);
+        free(json);
+    }
+    json_free(root);
+
+    // Test 2: Escapes on either side of every 16-byte boundary round-trip
+    printf("Test 2: Escapes around vector boundaries\n");
+    int intact = 1;
+    for (size_t offset = 0; offset < 40; offset++) {
+        char text[96];
+        memset(text, 'x', sizeof(text));
+        text[0] = '"';
+        memcpy(text + 1 + offset, "\\\"\\u0002\\\\", 10);
+        memcpy(text + 1 + offset + 10, "\"", 2);
+
+        json_value_t* value = json_parse(text);
+        char* serialized = json_serialize(value);
+        intact &= serialized != NULL && strcmp(serialized, text) == 0;
+        free(serialized);
+        json_free(value);
+    }
+    passed &= (assertTrue(intact) == 0);
+
+    // Test 3: A long run with nothing to escape
+    printf("Test 3: Escape-free strings\n");
+    size_t length = 100000;
+    char* text = malloc(length + 3);
+    text[0] = '"';
+    for (size_t i = 1; i <= length; i++) {
+        text[i] = (char)('a' + i % 26);
+    }
+    text[length + 1] = '"';
+    text[length + 2] = '\0';
+    root = json_parse(text);
+    json = json_serialize(root);
+    passed &= (assertTrue(json != NULL && strcmp(json, text) == 0) == 0);
+    free(json);
+    json_free(root);
+    free(text);
+
+    printf("✓ String Escaping Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+void test_number_formatting() {
+    printf("=== Number Formatting Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Shortest text, integers and values outside the int64 range
+    printf("Test 1: Shortest representations\n");
+    json_value_t* root = json_parse("[0.1, 0.30000000000000004, 1e21, 1e300, -0.0, 5e-324, 1.7976931348623157e308,"
+        " 123.456, 1e-7, 0.000001, 2.5e-3, 4.0, 100, -9223372036854775808, 18446744073709551615]");
+    char* json = json_serialize(root);
+    passed &= (assertNotNull(json) == 0);
+    if (json) {
+        passed &= (assertStringsMatch(json, "[0.1,0.30000000000000004,1e+21,1e+300,-0,5e-324,1.7976931348623157e+308,"
+            "123.456,1e-7,0.000001,0.0025,4,100,-9223372036854775808,18446744073709551615]") == 0);
+        free(json);
+    }
+    json_free(root);
+
+    // Test 2: Every double survives a round trip
+    printf("Test 2: Round trip\n");
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    int exact = 1;
+    for (int i = 0; i < 2000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        double expected;
+        uint64_t bits = state & 0x7FEFFFFFFFFFFFFFULL;
+        memcpy(&expected, &bits, sizeof(expected));
+
+        char text[64];
+        snprintf(text, sizeof(text), "[%.17e]", expected);
+        json_value_t* value = json_parse(text);
+        char* serialized = json_serialize(value);
+        json_value_t* reparsed = serialized ? json_parse(serialized) : NULL;
+        double actual = json_get_number(json_array_get(reparsed, 0));
+        exact &= reparsed != NULL && memcmp(&actual, &expected, sizeof(actual)) == 0;
+
+        json_free(reparsed);
+        free(serialized);
+        json_free(value);
+    }
+    passed &= (assertTrue(exact) == 0);
+
+    printf("✓ Number Formatting Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t pieces;
+    size_t longest;
+} sink_collector_t;
+
+static int collect_output(void* ctx, const char* data, size_t length) {
+    sink_collector_t* collector = ctx;
+    char* grown = realloc(collector->data, collector->length + length + 1);
+    if (!grown) return 0;
+    memcpy(grown + collector->length, data, length);
+    collector->data = grown;
+    collector->length += length;
+    collector->data[collector->length] = '\0';
+    collector->pieces++;
+    if (length > collector->longest) collector->longest = length;
+    return 1;
+}
+
+static int refuse_output(void* ctx, const char* data, size_t length) {
+    (void)ctx;
+    (void)data;
+    (void)length;
+    return 0;
+}
+
+void test_sink_serialization() {
+    printf("=== Sink Serialization Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Long strings and many records so the output spans several staging buffers
+    size_t long_length = 40000;
+    char* text = malloc(long_length + 4096 * 48 + 64);
+    size_t pos = (size_t)sprintf(text, "{\"long\": \"");
+    for (size_t i = 0; i < long_length; i++) {
+        text[pos++] = (i % 1000 == 999) ? '\\' : (char)('a' + i % 26);
+        if (text[pos - 1] == '\\') text[pos++] = 'n';
+    }
+    pos += (size_t)sprintf(text + pos, "\", \"items\": [");
+    for (int i = 0; i < 4096; i++) {
+        pos += (size_t)sprintf(text + pos, "%s{\"id\": %d, \"v\": %d.5}", i ? "," : "", i, i);
+    }
+    strcpy(text + pos, "]}");
+    json_value_t* root = json_parse(text);
+    free(text);
+    char* compact = json_serialize(root);
+    char* pretty = json_serialize_pretty(root);
+    passed &= (assertNotNull(compact) == 0);
+    passed &= (assertNotNull(pretty) == 0);
+    if (!compact || !pretty) {
+        free(compact);
+        free(pretty);
+        json_free(root);
+        printf("✓ Sink Serialization Test: FAILED\n\n");
+        return;
+    }
+
+    // Test 1: A callback receives the same text in bounded pieces
+    printf("Test 1: Callback sink\n");
+    sink_collector_t collector = { 0 };
+    json_sink_t sink = json_sink_callback(collect_output, &collector);
+    passed &= (assertTrue(json_serialize_to_sink(root, &sink)) == 0);
+    passed &= (assertStringsMatch(collector.data, compact) == 0);
+    passed &= (assertTrue(sink.length == strlen(compact)) == 0);
+    passed &= (assertGreaterThan((int)collector.pieces, 1) == 0);
+    passed &= (assertTrue(collector.longest <= 16 * 1024) == 0);
+    free(collector.data);
+
+    memset(&collector, 0, sizeof(collector));
+    sink = json_sink_callback(collect_output, &collector);
+    sink.pretty = 1;
+    passed &= (assertTrue(json_serialize_to_sink(root, &sink)) == 0);
+    passed &= (assertStringsMatch(collector.data, pretty) == 0);
+    free(collector.data);
+
+    // Test 2: The precomputed size fits a buffer exactly
+    printf("Test 2: Size precomputation\n");
+    size_t size = json_serialized_size(root);
+    passed &= (assertTrue(size == strlen(compact)) == 0);
+    char* exact = malloc(size + 1);
+    sink = json_sink_buffer(exact, size + 1);
+    passed &= (assertTrue(json_serialize_to_sink(root, &sink)) == 0);
+    passed &= (assertStringsMatch(exact, compact) == 0);
+    free(exact);
+
+    // Test 3: A short buffer keeps a terminated prefix and reports the size
+    printf("Test 3: Buffer overflow\n");
+    char small[64];
+    sink = json_sink_buffer(small, sizeof(small));
+    passed &= (assertFalse(json_serialize_to_sink(root, &sink)) == 0);
+    passed &= (assertTrue(sink.length == size) == 0);
+    passed &= (assertTrue(strlen(small) < sizeof(small)) == 0);
+    passed &= (assertTrue(strncmp(small, compact, strlen(small)) == 0) == 0);
+    passed &= (assertTrue(strlen(small) > 0) == 0);
+
+    json_value_t* number = json_parse("[1.5]");
+    sink = json_sink_buffer(small, sizeof(small));
+    passed &= (assertTrue(json_serialize_to_sink(number, &sink)) == 0);
+    passed &= (assertStringsMatch(small, "[1.5]") == 0);
+    passed &= (assertTrue(json_serialized_size(number) == 5) == 0);
+    json_free(number);
+
+    // Test 4: Streams and file descriptors
+    printf("Test 4: File sinks\n");
+    const char* path = "sink_test.json";
+    passed &= (assertTrue(json_serialize_file(root, path)) == 0);
+    json_value_t* reread = json_parse_file(path);
+    char* reserialized = json_serialize(reread);
+    passed &= (assertNotNull(reserialized) == 0);
+    if (reserialized) {
+        passed &= (assertStringsMatch(reserialized, compact) == 0);
+    }
+    free(reserialized);
+    json_free(reread);
+    remove(path);
+
+    FILE* file = tmpfile();
+    passed &= (assertNotNull(file) == 0);
+    if (file) {
+        sink = json_sink_fd(fileno(file));
+        passed &= (assertTrue(json_serialize_to_sink(root, &sink)) == 0);
+        char* written = malloc(size + 1);
+        rewind(file);
+        size_t read = fread(written, 1, size + 1, file);
+        written[read < size ? read : size] = '\0';
+        passed &= (assertTrue(read == size) == 0);
+        passed &= (assertStringsMatch(written, compact) == 0);
+        free(written);
+        fclose(file);
+    }
+
+    // Test 5: A failing sink stops serialization
+    printf("Test 5: Sink failure\n");
+    sink = json_sink_callback(refuse_output, NULL);
+    passed &= (assertFalse(json_serialize_to_sink(root, &sink)) == 0);
+    passed &= (assertFalse(json_serialize_to_sink(NULL, &sink)) == 0);
+
+    free(compact);
+    free(pretty);
+    json_free(root);
+
+    printf("✓ Sink Serialization Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
+static int write_record(json_writer_t* writer, int64_t id, const char* name, double score) {
+    int ok = json_writer_begin_object(writer);
+    ok &= json_writer_key(writer, "id");
+    ok &= json_writer_write_int(writer, id);
+    ok &= json_writer_key(writer, "name");
+    ok &= json_writer_write_string(writer, name);
+    ok &= json_writer_key(writer, "score");
+    ok &= json_writer_write_double(writer, score);
+    ok &= json_writer_key(writer, "tags");
+    ok &= json_writer_begin_array(writer);
+    ok &= json_writer_write_bool(writer, id % 2 == 0);
+    ok &= json_writer_write_null(writer);
+    ok &= json_writer_write_uint(writer, UINT64_MAX);
+    ok &= json_writer_end_array(writer);
+    ok &= json_writer_key(writer, "empty");
+    ok &= json_writer_begin_object(writer);
+    ok &= json_writer_end_object(writer);
+    ok &= json_writer_end_object(writer);
+    return ok;
+}
+
+void test_json_writer() {
+    printf("=== JSON Writer Test ===\n");
+    reset_test_counter();
+
+    int passed = 1;
+
+    // Test 1: Records written into a caller buffer
+    printf("Test 1: Buffer output\n");
+    char buffer[512];
+    json_sink_t sink = json_sink_buffer(buffer, sizeof(buffer));
+    json_writer_t* writer = json_writer_create(&sink);
+    passed &= (assertNotNull(writer) == 0);
+    passed &= (assertTrue(json_writer_begin_array(writer)) == 0);
+    passed &= (assertTrue(write_record(writer, -42, "a \"quoted\"\nname", 0.1)) == 0);
+    passed &= (assertTrue(write_record(writer, 7, "", 1e21)) == 0);
+    passed &= (assertTrue(json_writer_end_array(writer)) == 0);
+    passed &= (assertTrue(json_writer_finish(writer)) == 0);
+    passed &= (assertStringsMatch(buffer,
+        "[{\"id\":-42,\"name\":\"a \\\"quoted\\\"\\nname\",\"score\":0.1,"
+        "\"tags\":[true,null,18446744073709551615],\"empty\":{}},"
+        "{\"id\":7,\"name\":\"\",\"score\":1e+21,\"tags\":[false,null,18446744073709551615],\"empty\":{}}]") == 0);
+    passed &= (assertTrue(sink.length == strlen(buffer)) == 0);
+    json_writer_free(writer);
+
+    // Test 2: Pretty output matches the serializer
+    printf("Test 2: Pretty output\n");
+    json_value_t* root = json_parse(buffer);
+    char* expected = json_serialize_pretty(root);
+    char pretty[1024];
+    sink = json_sink_buffer(pretty, sizeof(pretty));
+    sink.pretty = 1;
+    writer = json_writer_create(&sink);
+    json_writer_begin_array(writer);
+    write_record(writer, -42, "a \"quoted\"\nname", 0.1);
+    write_record(writer, 7, "", 1e21);
+    json_writer_end_array(writer);
+    passed &= (assertTrue(json_writer_finish(writer)) == 0);
+    passed &= (assertNotNull(expected) == 0);
+    if (expected) {
+        passed &= (assertStringsMatch(pretty, expected) == 0);
+    }
+    free(expected);
+    json_free(root);
+    json_writer_free(writer);
+
+    // Test 3: Calls that break the nesting are refused
+    printf("Test 3: Nesting checks\n");
+    sink = json_sink_buffer(buffer, sizeof(buffer));
+    writer = json_writer_create(&sink);
+    json_writer_begin_array(writer);
+    passed &= (assertFalse(json_writer_key(writer, "k")) == 0);
+    passed &= (assertFalse(json_writer_write_int(writer, 1)) == 0);
+    json_writer_free(writer);
+
+    writer = json_writer_create(&sink);
+    json_writer_begin_object(writer);
+    passed &= (assertFalse(json_writer_write_string(writer, "no key")) == 0);
+    json_writer_free(writer);
+
+    writer = json_writer_create(&sink);
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "k");
+    passed &= (assertFalse(json_writer_end_object(writer)) == 0);
+    json_writer_free(writer);
+
+    writer = json_writer_create(&sink);
+    json_writer_begin_object(writer);
+    passed &= (assertFalse(json_writer_end_array(writer)) == 0);
+    json_writer_free(writer);
+
+    writer = json_writer_create(&sink);
+    passed &= (assertTrue(json_writer_write_int(writer, 1)) == 0);
+    passed &= (assertFalse(json_writer_write_int(writer, 2)) == 0);
+    passed &= (assertFalse(json_writer_finish(writer)) == 0);
+    json_writer_free(writer);
+
+    writer = json_writer_create(&sink);
+    json_writer_begin_array(writer);
+    passed &= (assertFalse(json_writer_finish(writer)) == 0);
+    json_writer_free(writer);
+
+    writer = json_writer_create(&sink);
+    int depth_ok = 1;
+    for (int i = 0; i < 1024; i++) {
+        depth_ok &= json_writer_begin_array(writer);
+    }
+    passed &= (assertTrue(depth_ok) == 0);
+    passed &= (assertFalse(json_writer_begin_array(writer)) == 0);
+    json_writer_free(writer);
+
+    // Test 4: Many records streamed through a callback
+    printf("Test 4: Streaming export\n");
+    sink_collector_t collector = { 0 };
+    sink = json_sink_callback(collect_output, &collector);
+    writer = json_writer_create(&sink);
+    int ok = json_writer_begin_array(writer);
+    for (int i = 0; i < 20000; i++) {
+        ok &= write_record(writer, i, "record", i * 0.25);
+    }
+    ok &= json_writer_end_array(writer);
+    passed &= (assertTrue(ok && json_writer_finish(writer)) == 0);
+    passed &= (assertGreaterThan((int)collector.pieces, 1) == 0);
+    json_value_t* records = collector.data ? json_parse(collector.data) : NULL;
+    passed &= (assertNotNull(records) == 0);
+    passed &= (assertEquals((int)json_get_array_size(records), 20000) == 0);
+    passed &= (assertDoubleEquals(json_get_number(json_object_get(json_array_get(records, 19999), "score")), 19999 * 0.25) == 0);
+    json_free(records);
+    free(collector.data);
+    json_writer_free(writer);
+
+    printf("✓ JSON Writer Test: %s\n\n", passed ? "PASSED" : "FAILED");
+}
+
 int main() {
     printf("Starting Comprehensive JSON Tests\n\n");
     
@@ -666,6 +2755,31 @@ int main() {
 	test_large_array_performance();
 	test_object_with_many_keys();
 	test_complex_serialization_roundtrip();
+	test_document_reuse();
+	test_structural_index();
+	test_insitu_parsing();
+	test_number_parsing();
+	test_ondemand();
+	test_sax_parsing();
+	test_push_parsing();
+	test_parse_lines_parallel();
+	test_object_index();
+	test_key_pool();
+	test_length_aware_parsing();
+	test_tape();
+	test_json_path();
+	test_depth_limit();
+	test_parse_parallel();
+	test_bind();
+	test_compact_values();
+	test_memory_reuse();
+	test_validate();
+	test_string_decoding();
+	test_projected_parsing();
+	test_string_escaping();
+	test_number_formatting();
+	test_sink_serialization();
+	test_json_writer();
     
     printf("=== All Tests Completed ===\n");
     return 0;